@@ -68,6 +68,8 @@ DEFINES += "VL_QTC_VER=$$VL_COMPAT_VER_MAJ$$VL_COMPAT_VER_MIN" # 0304
 
 DEFINES -= QT_NO_CAST_FROM_ASCII
 
+QT += concurrent
+
 # VerilogCreator files
 
 CONFIG(debug, debug|release) {
@@ -99,7 +101,17 @@ SOURCES += \
     VlSymbolLocator.cpp \
     VlVerilogEditor.cpp \
     VlProjectEditor.cpp \
-    VlSdfEditor.cpp
+    VlSdfEditor.cpp \
+    VlCodeIndex.cpp \
+    VlUsagesSearch.cpp \
+    VlMappedFiles.cpp \
+    VlSymbolIndex.cpp \
+    VlHierarchyLocator.cpp \
+    VlJobRunner.cpp \
+    VlMatrixStep.cpp \
+    VlBuildFingerprint.cpp \
+    VlSdfIndex.cpp \
+    VlLargeFileViewer.cpp
 
 HEADERS += \
     verilogcreator_global.h \
@@ -125,7 +137,17 @@ HEADERS += \
     VlSymbolLocator.h \
     VlVerilogEditor.h \
     VlProjectEditor.h \
-    VlSdfEditor.h
+    VlSdfEditor.h \
+    VlCodeIndex.h \
+    VlUsagesSearch.h \
+    VlMappedFiles.h \
+    VlSymbolIndex.h \
+    VlHierarchyLocator.h \
+    VlJobRunner.h \
+    VlMatrixStep.h \
+    VlBuildFingerprint.h \
+    VlSdfIndex.h \
+    VlLargeFileViewer.h
 
 include (../Verilog/Verilog.pri )
 include (../Sdf/Sdf.pri )
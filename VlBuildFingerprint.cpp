@@ -0,0 +1,135 @@
+/*
+* Copyright 2019 Rochus Keller <mailto:me@rochus-keller.ch>
+*
+* This file is part of the VerilogCreator plugin.
+*
+* The following is the license that applies to this copy of the
+* plugin. For a license to use the plugin under conditions
+* other than those described here, please email to me@rochus-keller.ch.
+*
+* GNU General Public License Usage
+* This file may be used under the terms of the GNU General Public
+* License (GPL) versions 2.0 or 3.0 as published by the Free Software
+* Foundation and appearing in the file LICENSE.GPL included in
+* the packaging of this file. Please review the following information
+* to ensure GNU General Public Licensing requirements will be met:
+* http://www.fsf.org/licensing/licenses/info/GPLv2.html and
+* http://www.gnu.org/copyleft/gpl.html.
+*/
+
+
+#include "VlBuildFingerprint.h"
+#include <QCryptographicHash>
+#include <QFileInfo>
+#include <QDir>
+#include <QSet>
+#include <QtConcurrent/QtConcurrentMap>
+using namespace Vl;
+
+static QByteArray hashFile(const QString& path)
+{
+    QFile f(path);
+    if( !f.open(QIODevice::ReadOnly) )
+        return QByteArray();
+    QCryptographicHash h(QCryptographicHash::Sha1);
+    const qint64 size = f.size();
+    uchar* mem = size > 0 ? f.map( 0, size ) : 0;
+    if( mem )
+    {
+        h.addData( (const char*)mem, size );
+        f.unmap(mem);
+    }else
+        h.addData( f.readAll() );
+    return h.result();
+}
+
+static QString findInclude( const QString& name, const QString& includer, const QStringList& incDirs )
+{
+    QFileInfo info( QFileInfo(includer).dir(), name );
+    if( info.exists() )
+        return info.absoluteFilePath();
+    foreach( const QString& dir, incDirs )
+    {
+        info = QFileInfo( QDir(dir), name );
+        if( info.exists() )
+            return info.absoluteFilePath();
+    }
+    return QString();
+}
+
+static QStringList includeClosure( const QStringList& files, const QStringList& incDirs )
+{
+    QStringList res;
+    QSet<QString> seen;
+    QStringList todo = files;
+    QRegExp inc("`include\\s*\"([^\"]+)\"");
+    while( !todo.isEmpty() )
+    {
+        const QString file = todo.takeLast();
+        if( seen.contains(file) )
+            continue;
+        seen.insert(file);
+        res.append(file);
+        QFile f(file);
+        if( !f.open(QIODevice::ReadOnly) )
+            continue;
+        const QString text = QString::fromLatin1( f.readAll() );
+        int pos = 0;
+        while( ( pos = inc.indexIn( text, pos ) ) != -1 )
+        {
+            const QString path = findInclude( inc.cap(1), file, incDirs );
+            if( !path.isEmpty() && !seen.contains(path) )
+                todo.append( path );
+            pos += inc.matchedLength();
+        }
+    }
+    return res;
+}
+
+QByteArray BuildFingerprint::compute(const QStringList& files, const QStringList& incDirs, const QByteArray& config)
+{
+    QStringList all = includeClosure( files, incDirs );
+    all.sort(); // the order of the list must not change the fingerprint
+    const QList<QByteArray> hashes = QtConcurrent::blockingMapped<QList<QByteArray> >( all, hashFile );
+
+    QCryptographicHash h(QCryptographicHash::Sha1);
+    h.addData( config );
+    for( int i = 0; i < all.size(); i++ )
+    {
+        h.addData( all[i].toUtf8() );
+        h.addData( hashes[i] ); // empty if missing; the tool will complain
+    }
+    return h.result().toHex();
+}
+
+QByteArray BuildFingerprint::load(const QString& path)
+{
+    QFile f(path);
+    if( !f.open(QIODevice::ReadOnly) )
+        return QByteArray();
+    return f.readAll().trimmed();
+}
+
+bool BuildFingerprint::save(const QString& path, const QByteArray& fp)
+{
+    QFile f(path);
+    if( !f.open(QIODevice::WriteOnly) )
+        return false;
+    f.write( fp );
+    f.write( "\n" );
+    return true;
+}
+
+bool BuildFingerprint::writeIfChanged(const QString& path, const QByteArray& content)
+{
+    QFile f(path);
+    if( f.open(QIODevice::ReadOnly) )
+    {
+        if( f.size() == content.size() && f.readAll() == content )
+            return true;
+        f.close();
+    }
+    if( !f.open(QIODevice::WriteOnly) )
+        return false;
+    return f.write( content ) == content.size();
+}
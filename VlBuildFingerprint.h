@@ -0,0 +1,45 @@
+#ifndef VLBUILDFINGERPRINT_H
+#define VLBUILDFINGERPRINT_H
+
+/*
+* Copyright 2019 Rochus Keller <mailto:me@rochus-keller.ch>
+*
+* This file is part of the VerilogCreator plugin.
+*
+* The following is the license that applies to this copy of the
+* plugin. For a license to use the plugin under conditions
+* other than those described here, please email to me@rochus-keller.ch.
+*
+* GNU General Public License Usage
+* This file may be used under the terms of the GNU General Public
+* License (GPL) versions 2.0 or 3.0 as published by the Free Software
+* Foundation and appearing in the file LICENSE.GPL included in
+* the packaging of this file. Please review the following information
+* to ensure GNU General Public Licensing requirements will be met:
+* http://www.fsf.org/licensing/licenses/info/GPLv2.html and
+* http://www.gnu.org/copyleft/gpl.html.
+*/
+
+#include <QStringList>
+
+namespace Vl
+{
+    // Decides whether a tool step has to run again. The fingerprint covers the content of the source
+    // files and of everything they `include (transitively), plus the configuration, i.e. the command
+    // file, the tool and its arguments. It is stored in the build directory after a successful run.
+    // compute() only touches the file system, not the model, so it can run in the build thread.
+    class BuildFingerprint
+    {
+    public:
+        // an `include is looked up relative to the including file first, then in incDirs in order
+        static QByteArray compute( const QStringList& files, const QStringList& incDirs, const QByteArray& config );
+
+        static QByteArray load( const QString& path );
+        static bool save( const QString& path, const QByteArray& );
+
+        // leaves the file and its time stamp untouched if it already has this content
+        static bool writeIfChanged( const QString& path, const QByteArray& content );
+    };
+}
+
+#endif // VLBUILDFINGERPRINT_H
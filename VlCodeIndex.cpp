@@ -0,0 +1,351 @@
+/*
+* Copyright 2019 Rochus Keller <mailto:me@rochus-keller.ch>
+*
+* This file is part of the VerilogCreator plugin.
+*
+* The following is the license that applies to this copy of the
+* plugin. For a license to use the plugin under conditions
+* other than those described here, please email to me@rochus-keller.ch.
+*
+* GNU General Public License Usage
+* This file may be used under the terms of the GNU General Public
+* License (GPL) versions 2.0 or 3.0 as published by the Free Software
+* Foundation and appearing in the file LICENSE.GPL included in
+* the packaging of this file. Please review the following information
+* to ensure GNU General Public Licensing requirements will be met:
+* http://www.fsf.org/licensing/licenses/info/GPLv2.html and
+* http://www.gnu.org/copyleft/gpl.html.
+*/
+
+#include "VlCodeIndex.h"
+#include <algorithm>
+#include <limits.h>
+using namespace Vl;
+
+CodeIndex::CodeIndex(CrossRefModel* mdl):QObject(mdl),d_mdl(mdl),d_logFrom(0)
+{
+    Q_ASSERT( mdl != 0 );
+    connect( mdl, SIGNAL(sigFileUpdated(QString)), this, SLOT(onFileUpdated(QString)) );
+}
+
+CrossRefModel::TreePath CodeIndex::findSymbolBySourcePos(const QString& file, quint32 line, quint16 col,
+                                                         bool onlyIdents, bool hitEmpty)
+{
+    const File& f = fetch(file);
+    int hit = onlyIdents ? findSpan( f.d_spans, line, col, true ) : findSpan( f.d_tokens, line, col, false );
+    if( hit == -1 && hitEmpty )
+        hit = findArea( f, line, col );
+    CrossRefModel::TreePath res;
+    if( hit != -1 )
+        res = pathOf( f, hit );
+    return res;
+}
+
+CrossRefModel::IdentDeclRef CodeIndex::findDeclarationOfSymbolAtSourcePos(const QString& file, quint32 line, quint16 col)
+{
+    CrossRefModel::TreePath path = findSymbolBySourcePos( file, line, col );
+    if( path.isEmpty() )
+        return CrossRefModel::IdentDeclRef();
+    return d_mdl->findDeclarationOfSymbol( path.first().data() );
+}
+
+CrossRefModel::SymRefList CodeIndex::findReferencingSymbolsByFile(const CrossRefModel::Symbol* decl, const QString& file)
+{
+    CrossRefModel::SymRefList res;
+    if( decl == 0 )
+        return res;
+    File& f = fetch(file);
+    const Uses& u = resolve( f, decl->tok().d_val );
+    QHash<const CrossRefModel::Symbol*,Refs>::const_iterator i = u.d_refs.find(decl);
+    if( i == u.d_refs.end() )
+        return res;
+    foreach( int n, i.value().d_nodes )
+    {
+        if( f.d_nodes[n].d_sym->tok().d_sourcePath == file )
+            res.append( f.d_nodes[n].d_sym );
+    }
+    return res;
+}
+
+CrossRefModel::SymRefList CodeIndex::findAllReferencingSymbols(const CrossRefModel::Symbol* decl)
+{
+    if( decl == 0 )
+        return CrossRefModel::SymRefList();
+    QSet<QString> files = d_known;
+    foreach( const CrossRefModel::IdentDeclRef& id, d_mdl->getGlobalNames() )
+        files.insert( id->tok().d_sourcePath );
+
+    CrossRefModel::SymRefList res;
+    QSet<const CrossRefModel::Symbol*> seen; // included files show up in the tree of each includer
+    foreach( const QString& file, files )
+    {
+        File& f = fetch(file);
+        const Uses& u = resolve( f, decl->tok().d_val );
+        QHash<const CrossRefModel::Symbol*,Refs>::const_iterator i = u.d_refs.find(decl);
+        if( i == u.d_refs.end() )
+            continue;
+        foreach( int n, i.value().d_nodes )
+        {
+            const CrossRefModel::SymRef& sym = f.d_nodes[n].d_sym;
+            if( !seen.contains(sym.data()) )
+            {
+                seen.insert(sym.data());
+                res.append(sym);
+            }
+        }
+    }
+    return res;
+}
+
+static bool lessThan( const CodeIndex::Name& lhs, const CodeIndex::Name& rhs )
+{
+    return lhs.d_key < rhs.d_key;
+}
+
+CodeIndex::NameTable CodeIndex::getNames(const CrossRefModel::ScopeRef& scope, bool withOuter)
+{
+    if( scope.constData() == 0 )
+        return NameTable();
+    const NamesKey key( scope.constData(), withOuter );
+    {
+        QMutexLocker lock(&d_namesLock);
+        QHash<NamesKey,Names>::const_iterator i = d_names.find(key);
+        if( i != d_names.end() )
+            return i.value().d_table;
+    }
+    // built outside of the lock; if two threads race, both build the same table
+    Names n;
+    n.d_scope = scope;
+    const CrossRefModel::Scope::Names2 names = scope->getNames2(withOuter);
+    n.d_table.reserve( names.size() );
+    for( auto i = names.begin(); i != names.end(); ++i )
+    {
+        Name name;
+        name.d_name = QString::fromLatin1( i.key() );
+        name.d_key = name.d_name.toLower();
+        name.d_declType = i.value()->decl()->tok().d_type;
+        n.d_table.append( name );
+    }
+    std::sort( n.d_table.begin(), n.d_table.end(), lessThan );
+    QMutexLocker lock(&d_namesLock);
+    d_names[key] = n;
+    return n.d_table;
+}
+
+QPair<int,int> CodeIndex::findPrefix(const CodeIndex::NameTable& table, const QString& prefix)
+{
+    Name n;
+    n.d_key = prefix.toLower();
+    NameTable::const_iterator from = std::lower_bound( table.begin(), table.end(), n, lessThan );
+    NameTable::const_iterator to = from;
+    while( to != table.end() && to->d_key.startsWith(n.d_key) )
+        ++to;
+    return qMakePair( int( from - table.begin() ), int( to - table.begin() ) );
+}
+
+bool CodeIndex::getUpdatedSince(int generation, QSet<QString>& files) const
+{
+    QMutexLocker lock(&d_logLock);
+    if( generation < d_logFrom )
+        return false;
+    for( int i = d_log.size() - 1; i >= 0 && d_log[i].first > generation; i-- )
+        files.insert( d_log[i].second );
+    return true;
+}
+
+void CodeIndex::clear()
+{
+    const int gen = d_generation.fetchAndAddOrdered(1) + 1;
+    {
+        QMutexLocker lock(&d_logLock);
+        d_log.clear();
+        d_logFrom = gen;
+    }
+    d_files.clear();
+    d_known.clear();
+    QMutexLocker lock(&d_namesLock);
+    d_names.clear();
+}
+
+void CodeIndex::onFileUpdated(const QString& file)
+{
+    const int gen = d_generation.fetchAndAddOrdered(1) + 1;
+    {
+        QMutexLocker lock(&d_logLock);
+        d_log.append( qMakePair( gen, file ) );
+        if( d_log.size() > 4096 )
+            d_logFrom = d_log.takeFirst().first;
+    }
+    {
+        QMutexLocker lock(&d_namesLock);
+        QHash<NamesKey,Names>::iterator i = d_names.begin();
+        while( i != d_names.end() )
+        {
+            if( i.key().second || i.value().d_scope->tok().d_sourcePath == file )
+                i = d_names.erase(i);
+            else
+                ++i;
+        }
+    }
+    d_known.insert(file);
+    d_files.remove(file);
+
+    // the uses of a name in other files are resolved again if they could now resolve differently: they
+    // resolved into the file, some of them didn't resolve at all, or the file (now) declares the name globally
+    QSet<QByteArray> globals;
+    foreach( const CrossRefModel::IdentDeclRef& id, d_mdl->getGlobalNames(file) )
+        globals.insert( id->tok().d_val );
+    QHash<QString,File>::iterator i;
+    for( i = d_files.begin(); i != d_files.end(); ++i )
+    {
+        QHash<QByteArray,Uses>::iterator j = i.value().d_uses.begin();
+        while( j != i.value().d_uses.end() )
+        {
+            if( j.value().d_unresolved || j.value().d_declFiles.contains(file) || globals.contains(j.key()) )
+                j = i.value().d_uses.erase(j);
+            else
+                ++j;
+        }
+    }
+}
+
+const CodeIndex::Uses&CodeIndex::resolve(CodeIndex::File& f, const QByteArray& name)
+{
+    // only the identifiers spelled like the declaration can refer to it; the others are never resolved
+    QHash<QByteArray,Uses>::iterator i = f.d_uses.find(name);
+    if( i != f.d_uses.end() )
+        return i.value();
+    Uses& u = f.d_uses[name];
+    foreach( int n, f.d_byName.value(name) )
+    {
+        const CrossRefModel::SymRef& sym = f.d_nodes[n].d_sym;
+        CrossRefModel::IdentDeclRef decl = d_mdl->findDeclarationOfSymbol( sym.data() );
+        if( decl.data() == 0 )
+        {
+            u.d_unresolved = true;
+            continue;
+        }
+        if( decl.data() == sym.data() )
+            continue; // the declaration itself is not a use
+        Refs& r = u.d_refs[decl.data()];
+        r.d_decl = decl;
+        r.d_nodes.append(n);
+        u.d_declFiles.insert( decl->tok().d_sourcePath );
+    }
+    return u;
+}
+
+int CodeIndex::findSpan(const QVector<Span>& spans, quint32 line, quint16 col, bool disjoint)
+{
+    // candidates are the spans sharing the start of the last span at or before the position (the same
+    // identifier can appear more than once in the tree), and the identifier right before them in case
+    // the cursor sits between two adjacent ones; the walk would hit the lowest node
+    Span key;
+    key.d_line = line;
+    key.d_col = col;
+    key.d_end = col;
+    key.d_node = INT_MAX;
+    QVector<Span>::const_iterator i = std::upper_bound( spans.begin(), spans.end(), key );
+    int hit = -1;
+    int start = -1;
+    while( i != spans.begin() )
+    {
+        --i;
+        if( i->d_line != line )
+            break;
+        if( disjoint && i->d_col != start && i->d_end < col && start != -1 )
+            break; // identifiers on a line don't overlap; everything further left ends before the cursor
+        start = i->d_col;
+        if( i->d_col <= col && col <= i->d_end && ( hit == -1 || i->d_node < hit ) )
+            hit = i->d_node;
+    }
+    return hit;
+}
+
+int CodeIndex::findArea(const CodeIndex::File& f, quint32 line, quint16 col)
+{
+    // the symbol starting last at or before the position is in the subtree of the innermost one enclosing it
+    Span key;
+    key.d_line = line;
+    key.d_col = col;
+    key.d_end = col;
+    key.d_node = INT_MAX;
+    QVector<Span>::const_iterator i = std::upper_bound( f.d_tokens.begin(), f.d_tokens.end(), key );
+    if( i == f.d_tokens.begin() )
+        return -1;
+    --i;
+    int n = i->d_node;
+    while( f.d_nodes[n].d_parent != -1 && ( f.d_nodes[n].d_endLine < line ||
+                                            ( f.d_nodes[n].d_endLine == line && f.d_nodes[n].d_endCol < col ) ) )
+        n = f.d_nodes[n].d_parent;
+    return n;
+}
+
+CodeIndex::File&CodeIndex::fetch(const QString& file)
+{
+    QHash<QString,File>::iterator i = d_files.find(file);
+    if( i != d_files.end() )
+        return i.value();
+    File& f = d_files[file];
+    foreach( const CrossRefModel::SymRef& sym, d_mdl->getGlobalSyms(file) )
+        fill( f, file, sym, -1 );
+    // children follow their parent, so the ends of the subtrees propagate upwards in one backward pass
+    for( int i = f.d_nodes.size() - 1; i >= 0; i-- )
+    {
+        const Node& n = f.d_nodes[i];
+        if( n.d_parent == -1 )
+            continue;
+        Node& p = f.d_nodes[n.d_parent];
+        if( n.d_endLine > p.d_endLine || ( n.d_endLine == p.d_endLine && n.d_endCol > p.d_endCol ) )
+        {
+            p.d_endLine = n.d_endLine;
+            p.d_endCol = n.d_endCol;
+        }
+    }
+    std::stable_sort( f.d_spans.begin(), f.d_spans.end() );
+    std::stable_sort( f.d_tokens.begin(), f.d_tokens.end() );
+    f.d_nodes.squeeze();
+    f.d_spans.squeeze();
+    f.d_tokens.squeeze();
+    return f;
+}
+
+void CodeIndex::fill(CodeIndex::File& f, const QString& file, const CrossRefModel::SymRef& sym, int parent)
+{
+    const int me = f.d_nodes.size();
+    Node n;
+    n.d_sym = sym;
+    n.d_parent = parent;
+    n.d_endLine = 0;
+    n.d_endCol = 0;
+    const Token& t = sym->tok();
+    if( t.d_type == Tok_Ident )
+        f.d_byName[t.d_val].append(me);
+    if( t.d_sourcePath == file && t.d_lineNr > 0 )
+    {
+        Span s;
+        s.d_line = t.d_lineNr;
+        s.d_col = t.d_colNr;
+        s.d_end = t.d_colNr + t.d_len;
+        s.d_node = me;
+        f.d_tokens.append( s );
+        if( t.d_type == Tok_Ident )
+            f.d_spans.append( s );
+        n.d_endLine = s.d_line;
+        n.d_endCol = s.d_end;
+    }
+    f.d_nodes.append( n );
+    foreach( const CrossRefModel::SymRef& sub, sym->children() )
+        fill( f, file, sub, me );
+}
+
+CrossRefModel::TreePath CodeIndex::pathOf(const CodeIndex::File& f, int node) const
+{
+    CrossRefModel::TreePath res;
+    while( node != -1 )
+    {
+        res.append( f.d_nodes[node].d_sym );
+        node = f.d_nodes[node].d_parent;
+    }
+    return res;
+}
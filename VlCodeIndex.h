@@ -0,0 +1,145 @@
+#ifndef VLCODEINDEX_H
+#define VLCODEINDEX_H
+
+/*
+* Copyright 2019 Rochus Keller <mailto:me@rochus-keller.ch>
+*
+* This file is part of the VerilogCreator plugin.
+*
+* The following is the license that applies to this copy of the
+* plugin. For a license to use the plugin under conditions
+* other than those described here, please email to me@rochus-keller.ch.
+*
+* GNU General Public License Usage
+* This file may be used under the terms of the GNU General Public
+* License (GPL) versions 2.0 or 3.0 as published by the Free Software
+* Foundation and appearing in the file LICENSE.GPL included in
+* the packaging of this file. Please review the following information
+* to ensure GNU General Public Licensing requirements will be met:
+* http://www.fsf.org/licensing/licenses/info/GPLv2.html and
+* http://www.gnu.org/copyleft/gpl.html.
+*/
+
+#include <QObject>
+#include <QHash>
+#include <QVector>
+#include <QSet>
+#include <QMutex>
+#include <QAtomicInt>
+#include <Verilog/VlCrossRefModel.h>
+
+namespace Vl
+{
+    // Per file position index over the syntax tree of a CrossRefModel. The identifier spans of a file
+    // are kept in a flat array sorted by (line,col), so a position lookup is a binary search instead of
+    // a tree walk. A file is indexed on first use and dropped as soon as the model reparses it.
+    // The identifiers of a file are also grouped by name. The uses of a declaration are resolved on demand
+    // for its name only and then kept in a declaration -> uses map per file and name, until the file is
+    // reparsed or a reparse of another file could change how the name resolves.
+    class CodeIndex : public QObject
+    {
+        Q_OBJECT
+    public:
+        explicit CodeIndex(CrossRefModel*);
+
+        // same result as CrossRefModel::findSymbolBySourcePos(file,line,col) with default arguments; with
+        // onlyIdents false the tokens of all symbols are hit. With hitEmpty a position between tokens hits the
+        // innermost symbol whose area contains it; an area ends with the last token of the subtree, only top
+        // level symbols extend to the next one.
+        CrossRefModel::TreePath findSymbolBySourcePos( const QString& file, quint32 line, quint16 col,
+                                                       bool onlyIdents = true, bool hitEmpty = false );
+        CrossRefModel::IdentDeclRef findDeclarationOfSymbolAtSourcePos( const QString& file, quint32 line, quint16 col );
+
+        // same result as the CrossRefModel functions of the same name
+        CrossRefModel::SymRefList findReferencingSymbolsByFile( const CrossRefModel::Symbol* decl, const QString& file );
+        CrossRefModel::SymRefList findAllReferencingSymbols( const CrossRefModel::Symbol* decl );
+
+        struct Name
+        {
+            QString d_name;
+            QString d_key; // lower case; the table is sorted by it
+            int d_declType;
+        };
+        typedef QVector<Name> NameTable;
+        // the names of Scope::getNames2(withOuter), sorted; cached until the file of the scope is reparsed
+        // (any file if withOuter). Thread-safe, unlike the rest of the index.
+        NameTable getNames( const CrossRefModel::ScopeRef&, bool withOuter );
+        // returns the range [first,second) of names starting with prefix, case insensitive
+        static QPair<int,int> findPrefix( const NameTable&, const QString& prefix );
+
+        // incremented whenever a file of the model is reparsed; may be read from any thread
+        int getGeneration() const { return d_generation.load(); }
+        // adds the files reparsed after the given generation; false if that is no longer known, i.e. all
+        // files have to be assumed changed. Thread-safe.
+        bool getUpdatedSince( int generation, QSet<QString>& files ) const;
+
+        void clear();
+    protected slots:
+        void onFileUpdated( const QString& );
+    private:
+        struct Node
+        {
+            CrossRefModel::SymRef d_sym;
+            int d_parent; // index into File::d_nodes, -1 for top level symbols
+            quint32 d_endLine; // end of the last token of the subtree in the file; 0 if none
+            quint16 d_endCol;
+        };
+        struct Span
+        {
+            quint32 d_line;
+            quint16 d_col;
+            quint16 d_end; // d_col + d_len, inclusive; the cursor may sit right after the identifier
+            int d_node;
+            bool operator<( const Span& rhs ) const
+            {
+                return d_line < rhs.d_line || ( d_line == rhs.d_line &&
+                        ( d_col < rhs.d_col || ( d_col == rhs.d_col && d_node < rhs.d_node ) ) );
+            }
+        };
+        struct Refs
+        {
+            CrossRefModel::IdentDeclRef d_decl; // keeps the key alive so its address cannot be reused
+            QVector<int> d_nodes;
+        };
+        struct Uses // the resolved identifiers of one name
+        {
+            QHash<const CrossRefModel::Symbol*,Refs> d_refs;
+            QSet<QString> d_declFiles; // files the identifiers were resolved to
+            bool d_unresolved; // some identifiers had no declaration when resolved
+            Uses():d_unresolved(false){}
+        };
+        struct File
+        {
+            QVector<Node> d_nodes; // pre-order
+            QVector<Span> d_spans; // identifiers
+            QVector<Span> d_tokens; // all symbols
+            QHash<QByteArray,QVector<int> > d_byName; // identifier nodes
+            QHash<QByteArray,Uses> d_uses; // resolved on demand
+        };
+        static int findSpan( const QVector<Span>&, quint32 line, quint16 col, bool disjoint );
+        static int findArea( const File&, quint32 line, quint16 col );
+        File& fetch( const QString& file );
+        const Uses& resolve( File&, const QByteArray& name );
+        void fill( File&, const QString& file, const CrossRefModel::SymRef&, int parent );
+        CrossRefModel::TreePath pathOf( const File&, int node ) const;
+
+        struct Names
+        {
+            CrossRefModel::ScopeRef d_scope; // keeps the key alive
+            NameTable d_table;
+        };
+        typedef QPair<const CrossRefModel::Scope*,bool> NamesKey;
+
+        CrossRefModel* d_mdl;
+        QHash<QString,File> d_files;
+        QMutex d_namesLock;
+        QHash<NamesKey,Names> d_names;
+        QAtomicInt d_generation;
+        mutable QMutex d_logLock;
+        QList<QPair<int,QString> > d_log; // (generation, file) of the recent reparses
+        int d_logFrom; // all reparses after this generation are in d_log
+        QSet<QString> d_known; // all files reported by the model
+    };
+}
+
+#endif // VLCODEINDEX_H
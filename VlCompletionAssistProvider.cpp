@@ -20,6 +20,7 @@
 #include "VlCompletionAssistProvider.h"
 #include "VlConstants.h"
 #include "VlModelManager.h"
+#include "VlCodeIndex.h"
 #include <texteditor/codeassist/iassistproposal.h>
 #include <texteditor/codeassist/assistinterface.h>
 #include <texteditor/codeassist/iassistprocessor.h>
@@ -29,6 +30,7 @@
 #include <coreplugin/id.h>
 #include <QTextBlock>
 #include <QTextDocument>
+#include <QThread>
 #include <QtDebug>
 #include <Verilog/VlCrossRefModel.h>
 #include <Verilog/VlPpSymbols.h>
@@ -39,7 +41,91 @@ namespace Vl
     class CompletionAssistProcessor : public TextEditor::IAssistProcessor
     {
     public:
-        CompletionAssistProcessor() {}
+        enum What { Nothing, PlainIdent, MacroUse, DotExpand };
+        CompletionAssistProcessor( const CompletionAssistProvider* provider, const QIcon& iMod, const QIcon& iVar,
+                                   const QIcon& iFunc ):
+            d_provider(provider),d_iMod(iMod),d_iVar(iVar),d_iFunc(iFunc) {}
+
+        static What classify( const QString& seq, int& prefixPos )
+        {
+            prefixPos = CompletionAssistProvider::checkSequence(seq,0);
+            if( prefixPos > 0 )
+                return Nothing;
+            if( seq.size() + prefixPos - 1 >= 0 )
+            {
+                switch( seq[ seq.size() + prefixPos - 1 ].toLatin1() )
+                {
+                case '.':
+                    return DotExpand;
+                case '`':
+                    return MacroUse;
+                }
+            }
+            return PlainIdent;
+        }
+
+        struct Query // answered in the GUI thread on behalf of perform()
+        {
+            QString d_file;
+            int d_line;
+            int d_col;
+            What d_what;
+            CodeIndex::NameTable d_names;
+            QByteArrayList d_macros;
+        };
+
+        // runs in the GUI thread; the model and the index are only safe to use there
+        static void collect( Query& q )
+        {
+            CrossRefModel* mdl = ModelManager::instance()->getModelForCurrentProject();
+            if( mdl == 0 )
+                return;
+            if( q.d_what == MacroUse )
+            {
+                q.d_macros = mdl->getSyms()->getNames();
+                return;
+            }
+            // PlainIdent or DotExpand
+            CodeIndex* index = ModelManager::instance()->getIndex(mdl);
+            CrossRefModel::TreePath p = index->findSymbolBySourcePos( q.d_file, q.d_line, q.d_col, false, true );
+            if( p.isEmpty() )
+                return;
+
+//            foreach( const CrossRefModel::SymRef& sym, p )
+//                qDebug() << SynTree::rToStr( sym->tok().d_type ) << sym->tok().d_lineNr << sym->tok().d_colNr;
+
+            if( q.d_what == DotExpand )
+            {
+                CrossRefModel::ScopeRef module;
+                const CrossRefModel::Branch* branch = CrossRefModel::closestBranch(p);
+                if( branch && branch->tok().d_type == SynTree::R_module_or_udp_instantiation_ )
+                {
+                    CrossRefModel::SymRef sym = mdl->findGlobal(branch->tok().d_val);
+                    if( sym.constData() )
+                        module = sym->toScope();
+                }else if( branch && branch->tok().d_type == SynTree::R_module_or_udp_instance_ )
+                {
+                    CrossRefModel::SymRef sym = mdl->findGlobal(branch->super()->tok().d_val);
+                    if( sym.constData() )
+                        module = sym->toScope();
+                }
+                if( module.constData() )
+                {
+                    //qDebug() << "fetching symbols of" << module->tok().d_val;
+                    q.d_names = index->getNames( module, false );
+                }
+
+            }else // PlainIdent
+            {
+                CrossRefModel::ScopeRef scope( CrossRefModel::closestScope(p) );
+                if( scope.constData() )
+                {
+                    //qDebug() << "fetching symbols of" << scope->tok().d_val;
+                    q.d_names = index->getNames( scope, true );
+                }
+            }
+        }
+
         TextEditor::IAssistProposal* perform(const TextEditor::AssistInterface *ai)
         {
             m_interface.reset(ai);
@@ -50,43 +136,40 @@ namespace Vl
             const int curPos = ai->position();
 
             const QTextBlock block = ai->textDocument()->findBlock(curPos);
-            const int lineNr = block.blockNumber() + 1;
             const int colNr = curPos - block.position() + 1;
-            const QString seq = QChar(' ') + ai->textDocument()->findBlock(curPos).text().left(colNr-1);
+            const QString seq = QChar(' ') + block.text().left(colNr-1);
             //const QString seq = ai->textAt(curPos, -CompletionAssistProvider::SeqLen );
-            const QString fileName = ai->fileName();
 
-            CrossRefModel* mdl = ModelManager::instance()->getModelForCurrentProject();
-            if( mdl == 0 )
-                return 0;
-
-            const int prefixPos = CompletionAssistProvider::checkSequence(seq,0);
-            if( prefixPos > 0 )
+            int prefixPos;
+            Query q;
+            q.d_what = classify( seq, prefixPos );
+            if( q.d_what == Nothing )
                 return 0;
-
-            enum { PlainIdent, MacroUse, DotExpand } what = PlainIdent;
-            if( seq.size() + prefixPos - 1 >= 0 )
-            {
-                switch( seq[ seq.size() + prefixPos - 1 ].toLatin1() )
-                {
-                case '.':
-                    what = DotExpand;
-                    break;
-                case '`':
-                    what = MacroUse;
-                    break;
-                }
-            }
-            //const QString prefix = seq.right(-prefixPos);
+            q.d_file = ai->fileName();
+            q.d_line = block.blockNumber() + 1;
+            q.d_col = colNr;
+            CompletionAssistProvider* provider = const_cast<CompletionAssistProvider*>( d_provider );
+            if( QThread::currentThread() == provider->thread() )
+                collect( q );
+            else
+                QMetaObject::invokeMethod( provider, "collect", Qt::BlockingQueuedConnection,
+                                           Q_ARG( void*, &q ) );
+            const QString prefix = seq.right(-prefixPos);
             //qDebug() << prefix << what << seq;
 
+            // the proposal model filters while typing, also fuzzy and by CamelCase humps; all of its
+            // matches start with the first typed character, so only that is used to narrow down here
+            const QString first = prefix.left(1);
+
             QList<TextEditor::AssistProposalItem *> proposals;
 
-            if( what == MacroUse )
+            if( q.d_what == MacroUse )
             {
-                const QByteArrayList names = mdl->getSyms()->getNames();
-                for( auto i = names.begin(); i != names.end(); ++i )
+                const QChar c = first.isEmpty() ? QChar() : first[0].toLower();
+                for( auto i = q.d_macros.begin(); i != q.d_macros.end(); ++i )
                 {
+                    if( !c.isNull() && ( i->isEmpty() || QChar::fromLatin1( i->at(0) ).toLower() != c ) )
+                        continue;
                     auto proposal = new TextEditor::AssistProposalItem();
                     proposal->setText(QString::fromLatin1((*i)));
                     //proposal->setIcon(icon);
@@ -97,80 +180,28 @@ namespace Vl
 
             }else // PlainIdent or DotExpand
             {
-                CrossRefModel::TreePath p = mdl->findSymbolBySourcePos( fileName, lineNr, colNr, false, true );
-                if( p.isEmpty() )
-                    return 0;
-
-//                foreach( const CrossRefModel::SymRef& sym, p )
-//                    qDebug() << SynTree::rToStr( sym->tok().d_type ) << sym->tok().d_lineNr << sym->tok().d_colNr;
-//                if( p.size() > 1 )
-//                {
-//                    CrossRefModel::dump(p[1].constData(), 0, false);
-//                    CrossRefModel::dump(p[0].constData(), 1, false);
-//                    //qDebug() << SynTree::rToStr( p[0]->tok().d_type ) << p[0]->tok().d_lineNr << p[0]->tok().d_colNr;
-//                }
-//                if( !p.isEmpty() )
-//                    CrossRefModel::dump(p.first().constData(), 0, true);
-
-                CrossRefModel::Scope::Names2 names;
-
-                if( what == DotExpand )
-                {
-                    CrossRefModel::ScopeRef module;
-                    const CrossRefModel::Branch* branch = CrossRefModel::closestBranch(p);
-                    if( branch && branch->tok().d_type == SynTree::R_module_or_udp_instantiation_ )
-                    {
-                        CrossRefModel::SymRef sym = mdl->findGlobal(branch->tok().d_val);
-                        if( sym.constData() )
-                            module = sym->toScope();
-                    }else if( branch && branch->tok().d_type == SynTree::R_module_or_udp_instance_ )
-                    {
-                        CrossRefModel::SymRef sym = mdl->findGlobal(branch->super()->tok().d_val);
-                        if( sym.constData() )
-                            module = sym->toScope();
-                    }
-                    if( module.constData() )
-                    {
-                        //qDebug() << "fetching symbols of" << module->tok().d_val;
-                        names = module->getNames2(false);
-                    }
-
-                }else // PlainIdent
-                {
-                    CrossRefModel::ScopeRef scope( CrossRefModel::closestScope(p) );
-                    if( scope.constData() )
-                    {
-                        //qDebug() << "fetching symbols of" << scope->tok().d_val;
-                        names = scope->getNames2();
-                    }
-                }
-
-                QPixmap iMod(":/verilogcreator/images/block.png");
-                QPixmap iVar(":/verilogcreator/images/var.png");
-                QPixmap iFunc(":/verilogcreator/images/func.png");
-
-                for( auto i = names.begin(); i != names.end(); ++i )
+                const QPair<int,int> range = CodeIndex::findPrefix( q.d_names, first );
+                proposals.reserve( range.second - range.first );
+                for( int i = range.first; i < range.second; i++ )
                 {
+                    const CodeIndex::Name& n = q.d_names[i];
                     auto proposal = new TextEditor::AssistProposalItem();
-                    proposal->setText(QString::fromLatin1(i.key()));
-                    const int declType = i.value()->decl()->tok().d_type;
-                    proposal->setDetail( SynTree::rToStr( declType ) );
-                    QPixmap icon;
-                    switch(declType)
+                    proposal->setText(n.d_name);
+                    proposal->setDetail( SynTree::rToStr( n.d_declType ) );
+                    switch(n.d_declType)
                     {
                     case SynTree::R_module_declaration:
                     case SynTree::R_udp_declaration:
-                        icon = iMod;
+                        proposal->setIcon(d_iMod);
                         break;
                     case SynTree::R_task_declaration:
                     case SynTree::R_function_declaration:
-                        icon = iFunc;
+                        proposal->setIcon(d_iFunc);
                         break;
                     default:
-                        icon = iVar;
+                        proposal->setIcon(d_iVar);
                         break;
                     }
-                    proposal->setIcon(icon);
                     //proposal->setOrder(order);
                     proposals << proposal;
 
@@ -187,11 +218,20 @@ namespace Vl
         }
     private:
         QScopedPointer<const TextEditor::AssistInterface> m_interface;
+        const CompletionAssistProvider* d_provider;
+        QIcon d_iMod, d_iVar, d_iFunc;
     };
 }
 
 using namespace Vl;
 
+CompletionAssistProvider::CompletionAssistProvider():
+    d_iMod(QPixmap(":/verilogcreator/images/block.png")),
+    d_iVar(QPixmap(":/verilogcreator/images/var.png")),
+    d_iFunc(QPixmap(":/verilogcreator/images/func.png"))
+{
+}
+
 static inline bool isInIdentChar( QChar c )
 {
     return c.isLetterOrNumber() || c == '_' || c == '$';
@@ -250,7 +290,7 @@ int CompletionAssistProvider::checkSequence(const QString& s, int minLen )
 
 TextEditor::IAssistProvider::RunType CompletionAssistProvider::runType() const
 {
-    return TextEditor::IAssistProvider::Synchronous;
+    return TextEditor::IAssistProvider::Asynchronous;
 }
 
 bool CompletionAssistProvider::supportsEditor(Core::Id editorId) const
@@ -260,7 +300,12 @@ bool CompletionAssistProvider::supportsEditor(Core::Id editorId) const
 
 TextEditor::IAssistProcessor*CompletionAssistProvider::createProcessor() const
 {
-    return new CompletionAssistProcessor();
+    return new CompletionAssistProcessor( this, d_iMod, d_iVar, d_iFunc );
+}
+
+void CompletionAssistProvider::collect(void* query) const
+{
+    CompletionAssistProcessor::collect( *static_cast<CompletionAssistProcessor::Query*>(query) );
 }
 
 bool CompletionAssistProvider::isActivationCharSequence(const QString& s) const
@@ -23,6 +23,7 @@
 #include <texteditor/codeassist/assistenums.h>
 #include <texteditor/codeassist/completionassistprovider.h>
 #include <Verilog/VlToken.h>
+#include <QIcon>
 
 namespace Vl
 {
@@ -32,6 +33,8 @@ namespace Vl
     public:
         enum { SeqLen = 4 };
 
+        CompletionAssistProvider();
+
         static int checkSequence(const QString& , int minLen = 1 );
 
         // overrides
@@ -41,6 +44,12 @@ namespace Vl
         int activationCharSequenceLength() const { return SeqLen; }
         bool isActivationCharSequence(const QString &sequence) const;
         bool isContinuationChar(const QChar &c) const;
+
+        // called by the processors through a blocking queued call; query is a CompletionAssistProcessor::Query
+        Q_INVOKABLE void collect( void* query ) const;
+    private:
+        // perform() runs in a worker thread; pixmaps may only be loaded here in the GUI thread
+        QIcon d_iMod, d_iVar, d_iFunc;
     };
 }
 
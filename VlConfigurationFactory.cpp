@@ -23,6 +23,7 @@
 #include "VlVerilatorConfiguration.h"
 #include "VlYosysConfiguration.h"
 #include "VlTclConfiguration.h"
+#include "VlMatrixStep.h"
 #include <projectexplorer/buildsteplist.h>
 #include <projectexplorer/target.h>
 #include <projectexplorer/buildinfo.h>
@@ -187,7 +188,8 @@ MakeStepFactory::MakeStepFactory(QObject* parent):
 bool MakeStepFactory::canCreate(ProjectExplorer::BuildStepList* parent, Core::Id id) const
 {
     Q_UNUSED(parent);
-    if( id == TclStep::ID )
+    if( id == TclStep::ID || id == MatrixStep::ID || id == IcarusRegressionStep::ID ||
+            id == VerilatorCompileStep::ID )
         return true;
     return false;
 }
@@ -198,6 +200,12 @@ ProjectExplorer::BuildStep* MakeStepFactory::create(ProjectExplorer::BuildStepLi
     //qDebug() << "MakeStepFactory::create" << id.toString();
     if( id == TclStep::ID )
         return new TclStep(parent);
+    else if( id == MatrixStep::ID )
+        return new MatrixStep(parent);
+    else if( id == IcarusRegressionStep::ID )
+        return new IcarusRegressionStep(parent);
+    else if( id == VerilatorCompileStep::ID )
+        return new VerilatorCompileStep(parent);
     else
         return 0;
 }
@@ -216,9 +224,9 @@ bool MakeStepFactory::canRestore(ProjectExplorer::BuildStepList* parent, const Q
 {
     Q_UNUSED(parent);
     const Core::Id id = ProjectExplorer::idFromMap(map);
-    return id == IcarusMakeStep::ID || id == IcarusCleanStep::ID ||
-            id == VerilatorMakeStep::ID || id == VerilatorCleanStep::ID ||
-            id == TclStep::ID ||
+    return id == IcarusMakeStep::ID || id == IcarusCleanStep::ID || id == IcarusRegressionStep::ID ||
+            id == VerilatorMakeStep::ID || id == VerilatorCleanStep::ID || id == VerilatorCompileStep::ID ||
+            id == TclStep::ID || id == MatrixStep::ID ||
             id == YosysMakeStep::ID || id == YosysCleanStep::ID;
 }
 
@@ -242,6 +250,12 @@ ProjectExplorer::BuildStep* MakeStepFactory::restore(ProjectExplorer::BuildStepL
         bs = new YosysMakeStep(parent);
     else if( id == YosysCleanStep::ID )
         bs = new YosysCleanStep(parent);
+    else if( id == MatrixStep::ID )
+        bs = new MatrixStep(parent);
+    else if( id == IcarusRegressionStep::ID )
+        bs = new IcarusRegressionStep(parent);
+    else if( id == VerilatorCompileStep::ID )
+        bs = new VerilatorCompileStep(parent);
     if( bs && bs->fromMap(map) )
         return bs;
     if( bs )
@@ -255,7 +269,7 @@ QList<Core::Id> MakeStepFactory::availableCreationIds(ProjectExplorer::BuildStep
     // Die hier angegebenen Steps erscheinen in der Create-Liste der Steps
     // canCreate wird dann gar nicht mehr abgefragt, sondern direkt create aufgerufen
     QList<Core::Id> result;
-    result << TclStep::ID;
+    result << TclStep::ID << MatrixStep::ID << IcarusRegressionStep::ID << VerilatorCompileStep::ID;
     return result;
 }
 
@@ -264,6 +278,12 @@ QString MakeStepFactory::displayNameForId(Core::Id id) const
     Q_UNUSED(id);
     if( id == TclStep::ID )
         return tr("TCL Step");
+    else if( id == MatrixStep::ID )
+        return tr("Matrix Step");
+    else if( id == IcarusRegressionStep::ID )
+        return tr("Icarus Regression Step");
+    else if( id == VerilatorCompileStep::ID )
+        return tr("Verilator Compile Step");
     return QString();
 }
 
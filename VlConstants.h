@@ -29,6 +29,10 @@ namespace Vl
         const char LangSdf[] = "Sdf";
         const char EditorId1[] = "Verilog.Editor";
         const char TaskId[] = "Verilog.TaskId";
+        const char ParseTaskId[] = "Verilog.ParseTask";
+        const char SdfIndexTaskId[] = "Verilog.SdfIndexTask";
+        const char LineIndexTaskId[] = "Verilog.LineIndexTask";
+        const char LargeFileSearchTaskId[] = "Verilog.LargeFileSearchTask";
         const char EditorDisplayName1[] = "Verilog Editor";
         const char EditorId2[] = "Verilog.Project.Editor";
         const char EditorDisplayName2[] = "Verilog Project Editor";
@@ -37,6 +41,8 @@ namespace Vl
         const char EditorId3[] = "Verilog.Sdf.Editor";
         const char EditorDisplayName3[] = "Sdf Editor";
         const char SdfMimeType[] = "text/x-verilogcreator-sdf";
+        const char LargeFileEditorId[] = "Verilog.LargeFile.Viewer";
+        const char LargeFileDisplayName[] = "Large File Viewer";
         const char SettingsId[] = "Verilog.Settings";
         const char EditorContextMenuId1[] = "VerilogEditor.ContextMenu";
         const char EditorContextMenuId2[] = "VerilogProjectEditor.ContextMenu";
@@ -44,6 +50,12 @@ namespace Vl
         const char FindUsagesCmd[] = "VerilogEditor.FindUsages";
         const char GotoOuterBlockCmd[] = "VerilogEditor.GotoOuterBlockCmd";
         const char ReloadProjectCmd[] = "VerilogEditor.ReloadProjectCmd";
+        const char CacheStatsCmd[] = "VerilogEditor.CacheStatsCmd";
+        const char SdfDelaysCmd[] = "VerilogEditor.SdfDelaysCmd";
+        const char LazyLinesKey[] = "VerilogCreator/LazySemanticsLineThreshold"; // 0 switches lazy mode off
+        const int LazyLinesDefault = 50000;
+        const char LargeFileKey[] = "VerilogCreator/LargeFileThresholdMB"; // 0 switches the large file viewer off
+        const int LargeFileDefault = 64;
     }
 }
 
@@ -0,0 +1,486 @@
+/*
+* Copyright 2019 Rochus Keller <mailto:me@rochus-keller.ch>
+*
+* This file is part of the VerilogCreator plugin.
+*
+* The following is the license that applies to this copy of the
+* plugin. For a license to use the plugin under conditions
+* other than those described here, please email to me@rochus-keller.ch.
+*
+* GNU General Public License Usage
+* This file may be used under the terms of the GNU General Public
+* License (GPL) versions 2.0 or 3.0 as published by the Free Software
+* Foundation and appearing in the file LICENSE.GPL included in
+* the packaging of this file. Please review the following information
+* to ensure GNU General Public Licensing requirements will be met:
+* http://www.fsf.org/licensing/licenses/info/GPLv2.html and
+* http://www.gnu.org/copyleft/gpl.html.
+*/
+
+#include "VlHierarchyLocator.h"
+#include "VlModelManager.h"
+#include "VlCodeIndex.h"
+#include "VlProject.h"
+#include <Verilog/VlSynTree.h>
+#include <coreplugin/editormanager/editormanager.h>
+#include <projectexplorer/projecttree.h>
+#include <algorithm>
+using namespace Vl;
+
+static const int s_maxDepth = 256; // protects the stack of expandNode
+static const int s_maxNodes = 1000000; // the tree grows exponentially with the depth
+
+HierarchyIndex::HierarchyIndex():d_mdl(0),d_generation(0),d_valid(false)
+{
+}
+
+bool HierarchyIndex::update(CrossRefModel* mdl, CodeIndex* index, const QStringList& tops, QFutureInterfaceBase& future)
+{
+    QMutexLocker lock(&d_lock);
+    const int gen = index ? index->getGeneration() : 0;
+    if( d_valid && d_mdl == mdl && d_generation == gen && d_tops == tops )
+        return true;
+    if( d_mdl != mdl )
+    {
+        d_strings.clear();
+        d_lower.clear();
+        d_ids.clear();
+        d_modules.clear();
+    }
+    const bool wasValid = d_valid;
+    d_valid = false;
+    d_mdl = mdl;
+    if( mdl == 0 )
+    {
+        d_nodes.clear();
+        d_nodesByModule.clear();
+        return true;
+    }
+
+    // only modules with a new declaration are read again, and only those whose instances changed need
+    // their subtrees expanded again; an added or removed module can change the whole tree
+    bool all = !wasValid || d_tops != tops || d_nodes.isEmpty();
+    QSet<int> changed;
+    QSet<int> present;
+    foreach( const CrossRefModel::IdentDeclRef& id, mdl->getGlobalNames() )
+    {
+        if( future.isCanceled() )
+            return false;
+        const CrossRefModel::Symbol* decl = id->decl();
+        if( decl == 0 || ( decl->tok().d_type != SynTree::R_module_declaration &&
+                           decl->tok().d_type != SynTree::R_udp_declaration ) )
+            continue;
+        const int name = intern( id->tok().d_val );
+        present.insert(name);
+        Module& m = d_modules[name];
+        if( m.d_decl.constData() == decl )
+            continue;
+        const bool added = m.d_decl.constData() == 0;
+        const QVector<Inst> insts = m.d_insts;
+        m = Module();
+        m.d_decl = CrossRefModel::SymRef(decl);
+        readModule( m, decl );
+        if( added )
+            all = true;
+        else if( m.d_insts != insts )
+            changed.insert(name);
+    }
+    QHash<int,Module>::iterator i = d_modules.begin();
+    while( i != d_modules.end() )
+    {
+        if( !present.contains(i.key()) )
+        {
+            i = d_modules.erase(i);
+            all = true;
+        }else
+            ++i;
+    }
+    d_tops = tops;
+    if( !all && findRoots( tops ) != d_roots )
+        all = true;
+    if( all )
+    {
+        if( !expand( future ) )
+            return false;
+    }else if( !changed.isEmpty() && !reexpand( changed, future ) )
+        return false;
+    d_generation = gen;
+    d_valid = true;
+    return true;
+}
+
+static inline int score( const QString& lower, const QString& q )
+{
+    const int pos = lower.indexOf(q);
+    if( pos == -1 )
+        return -1;
+    if( pos == 0 )
+        return lower.size() == q.size() ? 0 : 1;
+    return 2;
+}
+
+HierarchyIndex::HitList HierarchyIndex::find(const QString& query, int maxHits, QFutureInterfaceBase& future) const
+{
+    QMutexLocker lock(&d_lock);
+    HitList res;
+    QStringList parts = query.toLower().split( QChar('.') );
+    const QString last = parts.takeLast();
+    if( last.isEmpty() && parts.isEmpty() )
+        return res;
+
+    struct Cand
+    {
+        int d_score;
+        int d_node;
+        const Local* d_local;
+        bool operator<( const Cand& rhs ) const
+        {
+            return d_score < rhs.d_score || ( d_score == rhs.d_score && d_node < rhs.d_node );
+        }
+    };
+    QVector<Cand> cands;
+    const int maxCands = maxHits * 4;
+    for( QHash<int,Module>::const_iterator m = d_modules.begin(); m != d_modules.end(); ++m )
+    {
+        if( future.isCanceled() )
+            return res;
+        const QVector<int> nodes = d_nodesByModule.value( m.key() );
+        if( nodes.isEmpty() )
+            continue;
+        foreach( const Local& l, m.value().d_locals )
+        {
+            const int s = score( d_lower[l.d_name], last );
+            if( s < 0 )
+                continue;
+            foreach( int n, nodes )
+            {
+                if( !parts.isEmpty() && !matchesPath( n, parts ) )
+                    continue;
+                Cand c;
+                c.d_score = s;
+                c.d_node = n;
+                c.d_local = &l;
+                cands.append(c);
+                if( cands.size() > maxCands )
+                {
+                    // keep the best ones only; a module may have a huge number of instances
+                    std::sort( cands.begin(), cands.end() );
+                    cands.resize( maxHits );
+                }
+            }
+        }
+    }
+    std::sort( cands.begin(), cands.end() );
+    for( int i = 0; i < cands.size() && i < maxHits; i++ )
+    {
+        Hit h;
+        h.d_path = pathOf( cands[i].d_node ) + QChar('.') + QString::fromLatin1( d_strings[cands[i].d_local->d_name] );
+        h.d_declType = cands[i].d_local->d_declType;
+        h.d_sym = cands[i].d_local->d_sym;
+        res.append(h);
+    }
+    return res;
+}
+
+void HierarchyIndex::clear()
+{
+    QMutexLocker lock(&d_lock);
+    d_valid = false;
+    d_mdl = 0;
+    d_strings.clear();
+    d_lower.clear();
+    d_ids.clear();
+    d_modules.clear();
+    d_nodes.clear();
+    d_nodesByModule.clear();
+}
+
+int HierarchyIndex::intern(const QByteArray& str)
+{
+    QHash<QByteArray,int>::const_iterator i = d_ids.find(str);
+    if( i != d_ids.end() )
+        return i.value();
+    const int id = d_strings.size();
+    d_strings.append(str);
+    d_lower.append( QString::fromLatin1(str).toLower() );
+    d_ids.insert( str, id );
+    return id;
+}
+
+void HierarchyIndex::readModule(HierarchyIndex::Module& m, const CrossRefModel::Symbol* decl)
+{
+    QSet<int> names;
+    const CrossRefModel::Scope* s = decl->toScope();
+    if( s )
+    {
+        foreach( const CrossRefModel::IdentDeclRef& id, s->getNames() )
+        {
+            Local l;
+            l.d_name = intern( id->tok().d_val );
+            l.d_declType = id->decl() ? id->decl()->tok().d_type : 0;
+            l.d_sym = CrossRefModel::SymRef( id.constData() );
+            m.d_locals.append(l);
+            names.insert( l.d_name );
+        }
+    }
+    if( decl->toBranch() )
+        collectInsts( m, decl->toBranch(), names );
+    m.d_locals.squeeze();
+    m.d_insts.squeeze();
+}
+
+void HierarchyIndex::collectInsts(HierarchyIndex::Module& m, const CrossRefModel::Branch* b, QSet<int>& names)
+{
+    foreach( const CrossRefModel::SymRef& sub, b->children() )
+    {
+        const CrossRefModel::Branch* b2 = sub->toBranch();
+        if( sub->tok().d_type == SynTree::R_module_or_udp_instance_ && !sub->tok().d_val.isEmpty() &&
+                b2 && b2->super() )
+        {
+            Inst i;
+            i.d_name = intern( sub->tok().d_val );
+            i.d_type = intern( b2->super()->tok().d_val );
+            m.d_insts.append(i);
+            if( !names.contains( i.d_name ) )
+            {
+                // instances are not necessarily declared as names of the module scope
+                Local l;
+                l.d_name = i.d_name;
+                l.d_declType = SynTree::R_module_or_udp_instance_;
+                l.d_sym = sub;
+                m.d_locals.append(l);
+                names.insert( i.d_name );
+            }
+        }
+        if( b2 )
+            collectInsts( m, b2, names );
+    }
+}
+
+QList<int> HierarchyIndex::findRoots(const QStringList& tops) const
+{
+    QList<int> roots;
+    if( tops.isEmpty() )
+    {
+        QSet<int> used;
+        for( QHash<int,Module>::const_iterator m = d_modules.begin(); m != d_modules.end(); ++m )
+            foreach( const Inst& i, m.value().d_insts )
+                used.insert( i.d_type );
+        for( QHash<int,Module>::const_iterator m = d_modules.begin(); m != d_modules.end(); ++m )
+            if( !used.contains( m.key() ) )
+                roots.append( m.key() );
+        std::sort( roots.begin(), roots.end() );
+    }else
+    {
+        foreach( const QString& top, tops )
+        {
+            QHash<QByteArray,int>::const_iterator i = d_ids.find( top.toLatin1() );
+            if( i != d_ids.end() && d_modules.contains( i.value() ) )
+                roots.append( i.value() );
+        }
+    }
+    return roots;
+}
+
+bool HierarchyIndex::expand(QFutureInterfaceBase& future)
+{
+    d_roots = findRoots( d_tops );
+    d_nodes.clear();
+    d_nodesByModule.clear();
+    foreach( int r, d_roots )
+    {
+        if( !expandNode( d_nodes, -1, r, r, 0, future ) )
+            return false;
+    }
+    finishNodes();
+    return true;
+}
+
+bool HierarchyIndex::reexpand(const QSet<int>& modules, QFutureInterfaceBase& future)
+{
+    // copy the tree in pre-order, replacing the subtrees of the nodes of the given modules
+    QVector<Node> out;
+    out.reserve( d_nodes.size() );
+    QVector<int> remap( d_nodes.size(), -1 );
+    int i = 0;
+    while( i < d_nodes.size() )
+    {
+        const Node& n = d_nodes[i];
+        const int parent = n.d_parent == -1 ? -1 : remap[n.d_parent];
+        if( modules.contains( n.d_module ) )
+        {
+            if( !expandNode( out, parent, n.d_name, n.d_module, n.d_depth, future ) )
+                return false;
+            i = n.d_end;
+        }else
+        {
+            remap[i] = out.size();
+            out.append(n);
+            out.last().d_parent = parent;
+            i++;
+        }
+    }
+    d_nodes.swap(out);
+    d_nodesByModule.clear();
+    finishNodes();
+    return true;
+}
+
+bool HierarchyIndex::expandNode(QVector<Node>& out, int parent, int name, int module, int depth,
+                                QFutureInterfaceBase& future) const
+{
+    const int me = out.size();
+    Node n;
+    n.d_parent = parent;
+    n.d_name = name;
+    n.d_module = module;
+    n.d_depth = depth;
+    n.d_end = me + 1;
+    out.append(n);
+    if( ( out.size() & 0xfff ) == 0 && future.isCanceled() )
+        return false;
+    if( depth >= s_maxDepth || out.size() >= s_maxNodes )
+        return true;
+    // a module instantiating itself, directly or not, is listed once but not expanded again
+    for( int p = parent; p != -1; p = out[p].d_parent )
+    {
+        if( out[p].d_module == module )
+            return true;
+    }
+    QHash<int,Module>::const_iterator m = d_modules.find(module);
+    if( m == d_modules.end() )
+        return true;
+    foreach( const Inst& i, m.value().d_insts )
+    {
+        if( !d_modules.contains( i.d_type ) )
+            continue; // primitive or unknown module
+        if( out.size() >= s_maxNodes )
+            break;
+        if( !expandNode( out, me, i.d_name, i.d_type, depth + 1, future ) )
+            return false;
+    }
+    return true;
+}
+
+void HierarchyIndex::finishNodes()
+{
+    // children follow their parent, so the subtree ends propagate upwards in one backward pass
+    for( int i = 0; i < d_nodes.size(); i++ )
+        d_nodes[i].d_end = i + 1;
+    for( int i = d_nodes.size() - 1; i >= 0; i-- )
+    {
+        const Node& n = d_nodes[i];
+        if( n.d_parent != -1 )
+            d_nodes[n.d_parent].d_end = qMax( d_nodes[n.d_parent].d_end, n.d_end );
+    }
+    for( int i = 0; i < d_nodes.size(); i++ )
+        d_nodesByModule[ d_nodes[i].d_module ].append(i);
+    d_nodes.squeeze();
+}
+
+QString HierarchyIndex::pathOf(int node) const
+{
+    QStringList parts;
+    while( node != -1 )
+    {
+        parts.prepend( QString::fromLatin1( d_strings[d_nodes[node].d_name] ) );
+        node = d_nodes[node].d_parent;
+    }
+    return parts.join( QChar('.') );
+}
+
+bool HierarchyIndex::matchesPath(int node, const QStringList& parts) const
+{
+    // the query parts must match the closest enclosing instances, from the inside out
+    for( int i = parts.size() - 1; i >= 0; i-- )
+    {
+        if( node == -1 )
+            return false;
+        if( !d_lower[ d_nodes[node].d_name ].contains( parts[i] ) )
+            return false;
+        node = d_nodes[node].d_parent;
+    }
+    return true;
+}
+
+HierarchyLocator::HierarchyLocator():
+    d_iMod(QPixmap(":/verilogcreator/images/block.png")),
+    d_iVar(QPixmap(":/verilogcreator/images/var.png")),
+    d_iFunc(QPixmap(":/verilogcreator/images/func.png"))
+{
+    setId("VerilogHierarchy");
+    setDisplayName(tr("Verilog symbols in design hierarchy"));
+    setShortcutString(QString(QLatin1Char('h')));
+    setIncludedByDefault(false);
+}
+
+void HierarchyLocator::prepareSearch(const QString&)
+{
+    CrossRefModel* mdl = ModelManager::instance()->getModelForCurrentProject();
+    QStringList tops;
+    Project* p = qobject_cast<Project*>( ProjectExplorer::ProjectTree::currentProject() );
+    if( p )
+        tops = p->getTopMod().split( QRegExp("\\s+"), QString::SkipEmptyParts );
+    QMutexLocker lock(&d_lock);
+    d_mdl = mdl;
+    d_codeIndex = mdl ? ModelManager::instance()->getIndex(mdl) : 0;
+    d_tops = tops;
+}
+
+QList<Core::LocatorFilterEntry> HierarchyLocator::matchesFor(QFutureInterface<Core::LocatorFilterEntry>& future,
+                                                             const QString& entry)
+{
+    QList<Core::LocatorFilterEntry> res;
+
+    d_lock.lock();
+    CrossRefModel* mdl = d_mdl;
+    CodeIndex* index = d_codeIndex;
+    const QStringList tops = d_tops;
+    d_lock.unlock();
+    if( mdl == 0 )
+        return res;
+
+    if( !d_index.update( mdl, index, tops, future ) )
+        return res;
+    const HierarchyIndex::HitList l = d_index.find( entry, 1000, future );
+
+    foreach( const HierarchyIndex::Hit& h, l )
+    {
+        QIcon icon;
+        switch( h.d_declType )
+        {
+        case SynTree::R_task_declaration:
+        case SynTree::R_function_declaration:
+            icon = d_iFunc;
+            break;
+        case SynTree::R_module_or_udp_instance_:
+            icon = d_iMod;
+            break;
+        default:
+            icon = d_iVar;
+            break;
+        }
+        res << Core::LocatorFilterEntry( this, h.d_path, QVariant::fromValue(h.d_sym), icon );
+        res.back().extraInfo = QString("(%1)").arg( SynTree::rToStr( h.d_declType ) );
+    }
+    return res;
+}
+
+void HierarchyLocator::accept(Core::LocatorFilterEntry selection) const
+{
+    CrossRefModel::SymRef sym = selection.internalData.value<CrossRefModel::SymRef>();
+    Core::EditorManager::openEditorAt( sym->tok().d_sourcePath,
+                                       sym->tok().d_lineNr - 1, sym->tok().d_colNr + 0 );
+}
+
+void HierarchyLocator::refresh(QFutureInterface<void>& future)
+{
+    d_lock.lock();
+    CrossRefModel* mdl = d_mdl;
+    CodeIndex* index = d_codeIndex;
+    const QStringList tops = d_tops;
+    d_lock.unlock();
+    d_index.clear();
+    if( mdl )
+        d_index.update( mdl, index, tops, future );
+}
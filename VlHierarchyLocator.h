@@ -0,0 +1,134 @@
+#ifndef VLHIERARCHYLOCATOR_H
+#define VLHIERARCHYLOCATOR_H
+
+/*
+* Copyright 2019 Rochus Keller <mailto:me@rochus-keller.ch>
+*
+* This file is part of the VerilogCreator plugin.
+*
+* The following is the license that applies to this copy of the
+* plugin. For a license to use the plugin under conditions
+* other than those described here, please email to me@rochus-keller.ch.
+*
+* GNU General Public License Usage
+* This file may be used under the terms of the GNU General Public
+* License (GPL) versions 2.0 or 3.0 as published by the Free Software
+* Foundation and appearing in the file LICENSE.GPL included in
+* the packaging of this file. Please review the following information
+* to ensure GNU General Public Licensing requirements will be met:
+* http://www.fsf.org/licensing/licenses/info/GPLv2.html and
+* http://www.gnu.org/copyleft/gpl.html.
+*/
+
+#include <coreplugin/locator/ilocatorfilter.h>
+#include <Verilog/VlCrossRefModel.h>
+#include <QMutex>
+#include <QSet>
+#include <QIcon>
+#include <QPointer>
+
+namespace Vl
+{
+    class CodeIndex;
+
+    // Instance tree of the elaborated design with the names declared in each module. Names are interned;
+    // per module type only the local names and the instances are stored, and the tree nodes refer to
+    // module types, so a name declared in a module is not duplicated per instance. Modules are only
+    // reread when their declaration changed; only the subtrees of modules whose instances changed are
+    // expanded again, the whole tree only if modules were added or removed. Instantiation cycles are cut
+    // where a module reappears on its own path, and the tree is capped at a million nodes.
+    class HierarchyIndex
+    {
+    public:
+        struct Hit
+        {
+            QString d_path; // top.u_cpu.u_alu.carry
+            int d_declType;
+            CrossRefModel::SymRef d_sym;
+        };
+        typedef QList<Hit> HitList;
+
+        HierarchyIndex();
+        // tops empty means all modules which are not instantiated; returns false if canceled. The CodeIndex
+        // of the model provides the generation; the caller resolves it in the GUI thread.
+        bool update( CrossRefModel*, CodeIndex*, const QStringList& tops, QFutureInterfaceBase& );
+        // case insensitive; the part after the last '.' is matched against the names, the parts
+        // before against the closest enclosing instance names
+        HitList find( const QString& query, int maxHits, QFutureInterfaceBase& ) const;
+        void clear();
+    private:
+        struct Local
+        {
+            int d_name;
+            int d_declType;
+            CrossRefModel::SymRef d_sym;
+        };
+        struct Inst
+        {
+            int d_name;
+            int d_type; // module name
+            bool operator==( const Inst& rhs ) const { return d_name == rhs.d_name && d_type == rhs.d_type; }
+        };
+        struct Module
+        {
+            CrossRefModel::SymRef d_decl;
+            QVector<Local> d_locals;
+            QVector<Inst> d_insts;
+        };
+        struct Node // in pre-order
+        {
+            int d_parent;
+            int d_name;   // instance name, or module name for tops
+            int d_module;
+            int d_depth;
+            int d_end;    // one past the last node of the subtree
+        };
+        int intern( const QByteArray& );
+        void readModule( Module&, const CrossRefModel::Symbol* decl );
+        void collectInsts( Module&, const CrossRefModel::Branch*, QSet<int>& names );
+        QList<int> findRoots( const QStringList& tops ) const;
+        bool expand( QFutureInterfaceBase& );
+        bool reexpand( const QSet<int>& modules, QFutureInterfaceBase& );
+        bool expandNode( QVector<Node>&, int parent, int name, int module, int depth, QFutureInterfaceBase& ) const;
+        void finishNodes();
+        QString pathOf( int node ) const;
+        bool matchesPath( int node, const QStringList& parts ) const;
+
+        mutable QMutex d_lock;
+        CrossRefModel* d_mdl;
+        int d_generation;
+        QStringList d_tops;
+        QList<int> d_roots;
+        bool d_valid;
+        QVector<QByteArray> d_strings;
+        QVector<QString> d_lower;
+        QHash<QByteArray,int> d_ids;
+        QHash<int,Module> d_modules;
+        QVector<Node> d_nodes;
+        QHash<int,QVector<int> > d_nodesByModule;
+    };
+
+    class HierarchyLocator : public Core::ILocatorFilter
+    {
+        Q_OBJECT
+    public:
+        HierarchyLocator();
+
+        // overrides
+        void prepareSearch(const QString &entry);
+        QList<Core::LocatorFilterEntry> matchesFor(QFutureInterface<Core::LocatorFilterEntry> &future,
+                                                   const QString &entry);
+        void accept(Core::LocatorFilterEntry selection) const;
+        void refresh(QFutureInterface<void> &future);
+    private:
+        HierarchyIndex d_index;
+        QIcon d_iMod, d_iVar, d_iFunc;
+        // matchesFor and refresh run in a worker; these are taken in prepareSearch in the GUI thread
+        QMutex d_lock; // guards the three below
+        QPointer<CrossRefModel> d_mdl;
+        QPointer<CodeIndex> d_codeIndex;
+        QStringList d_tops;
+    };
+}
+
+#endif // VLHIERARCHYLOCATOR_H
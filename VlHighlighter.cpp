@@ -19,7 +19,6 @@
 
 #include "VlHighlighter.h"
 #include "VlModelManager.h"
-#include <Verilog/VlPpLexer.h>
 #include <texteditor/textdocumentlayout.h>
 #include <QBuffer>
 using namespace Vl;
@@ -60,6 +59,18 @@ QTextCharFormat VerilogHighlighter::formatForCategory(int c) const
     return d_format[c];
 }
 
+const QTextCharFormat&VerilogHighlighter::formatFor(int category, int tokenType)
+{
+    // setProperty detaches the shared format; do it once per combination instead of once per token
+    QTextCharFormat& f = d_formats[ ( quint32(category) << 16 ) | quint32(tokenType) ];
+    if( !f.isValid() )
+    {
+        f = formatForCategory(category);
+        f.setProperty( TokenProp, tokenType );
+    }
+    return f;
+}
+
 void VerilogHighlighter::highlightBlock(const QString& text)
 {
     const int previousBlockState_ = previousBlockState();
@@ -83,8 +94,7 @@ void VerilogHighlighter::highlightBlock(const QString& text)
     {
         // wir sind in einem Multi Line Comment
         // suche das Ende
-        QTextCharFormat f = formatForCategory(C_Cmt);
-        f.setProperty( TokenProp, int(Tok_Comment) );
+        const QTextCharFormat& f = formatFor( C_Cmt, Tok_Comment );
         int pos = text.indexOf("*/");
         if( pos == -1 )
         {
@@ -108,6 +118,8 @@ void VerilogHighlighter::highlightBlock(const QString& text)
     Parentheses parentheses;
     parentheses.reserve(20);
 
+    // a fresh lexer per block; PpLexer has no way to reset the state (defines, conditionals) it
+    // collects, which must not leak from one block into the next
     PpLexer lex;
     lex.setIgnoreAttrs(false);
     lex.setPackAttrs(false);
@@ -117,42 +129,45 @@ void VerilogHighlighter::highlightBlock(const QString& text)
     if( ModelManager::instance()->getLastUsed() )
         lex.setCache( ModelManager::instance()->getLastUsed()->getFcache() );
 
-    const QList<Token> tokens =  lex.tokens(text.mid(start));
+    // the token columns are relative to the lexed string; no copy of the block if it is lexed as a whole
+    const int off = start;
+    const QList<Token> tokens = lex.tokens( start == 0 ? text : text.mid(start) );
     for( int i = 0; i < tokens.size(); ++i )
     {
         const Token &t = tokens.at(i);
+        const int col = off + t.d_colNr - 1; // position in text
 
         if( t.d_substituted )
             continue;
 
-        QTextCharFormat f;
+        int c = -1;
         if( t.d_type == Tok_Comment )
-            f = formatForCategory(C_Cmt); // one line comment
+            c = C_Cmt; // one line comment
         else if( t.d_type == Tok_Section )
         {
             braceDepth++;
-            f = formatForCategory(C_Section);
+            c = C_Section;
             //f.setFontOverline(true);
             // setExtraAdditionalFormats funktioniert nicht
         }else if( t.d_type == Tok_SectionEnd )
         {
             braceDepth--;
-            f = formatForCategory(C_Section);
+            c = C_Section;
             // f.setFontUnderline(true);
         }else if( t.d_type == Tok_Lcmt )
         {
             braceDepth++;
-            f = formatForCategory(C_Cmt);
+            c = C_Cmt;
             lexerState = 1;
         }else if( t.d_type == Tok_Rcmt )
         {
             braceDepth--;
-            f = formatForCategory(C_Cmt);
+            c = C_Cmt;
             lexerState = 0;
         }else if( t.d_type == Tok_Str )
-            f = formatForCategory(C_Str);
+            c = C_Str;
         else if( tokenIsNumber(t.d_type) )
-            f = formatForCategory(C_Num);
+            c = C_Num;
         else if( tokenIsDelimiter(t.d_type) )
         {
             switch( t.d_type )
@@ -161,27 +176,27 @@ void VerilogHighlighter::highlightBlock(const QString& text)
             case Tok_Lbrack:
             case Tok_Lbrace:
             //case Tok_Latt:
-                parentheses.append(Parenthesis(Parenthesis::Opened, text[t.d_colNr-1], t.d_colNr-1 ));
+                parentheses.append(Parenthesis(Parenthesis::Opened, text[col], col ));
                 break;
             case Tok_Rpar:
             case Tok_Rbrack:
             case Tok_Rbrace:
             //case Tok_Ratt:
-                parentheses.append(Parenthesis(Parenthesis::Closed, text[t.d_colNr-1], t.d_colNr-1 ));
+                parentheses.append(Parenthesis(Parenthesis::Closed, text[col], col ));
                 break;
             }
             if( t.d_type == Tok_LineCont )
-                f = formatForCategory(C_Pp);
+                c = C_Pp;
             else
             //if( tokenIsOperator(t.d_type) )
-                f = formatForCategory(C_Op);
+                c = C_Op;
 //            else if( tokenIsBracket(t.d_type) )
 //                f = formatForCategory(C_Brack);
         }else if( tokenIsReservedWord(t.d_type) )
         {
             if( tokenIsBlockBegin(t.d_type) )
             {
-                parentheses.append(Parenthesis(Parenthesis::Opened, text[t.d_colNr-1], t.d_colNr-1 ));
+                parentheses.append(Parenthesis(Parenthesis::Opened, text[col], col ));
                 ++braceDepth;
                 // if a folding block opens at the beginning of a line, treat the entire line
                 // as if it were inside the folding block
@@ -192,7 +207,7 @@ void VerilogHighlighter::highlightBlock(const QString& text)
                 }
             }else if( tokenIsBlockEnd(t.d_type) )
             {
-                const int pos = t.d_colNr-1 + ::strlen(tokenToString(t.d_type))-1;
+                const int pos = col + ::strlen(tokenToString(t.d_type))-1;
                 parentheses.append(Parenthesis(Parenthesis::Closed, text[pos], pos ));
                 --braceDepth;
                 if (braceDepth < foldingIndent) {
@@ -204,13 +219,13 @@ void VerilogHighlighter::highlightBlock(const QString& text)
                 }
             }
             if( tokenIsType(t.d_type) )
-                f = formatForCategory(C_Type);
+                c = C_Type;
             else
-                f = formatForCategory(C_Kw);
+                c = C_Kw;
         }else if( t.d_type == Tok_Ident )
-            f = formatForCategory(C_Ident);
+            c = C_Ident;
         else if( t.d_type == Tok_SysName )
-            f = formatForCategory(C_Kw);
+            c = C_Kw;
         else if( t.d_type == Tok_CoDi )
         {
             Directive di = matchDirective(t.d_val);
@@ -231,14 +246,11 @@ void VerilogHighlighter::highlightBlock(const QString& text)
                 break;
             }
 
-            f = formatForCategory(C_Pp);
+            c = C_Pp;
         }
 
-        if( f.isValid() )
-        {
-            f.setProperty( TokenProp, int(t.d_type) );
-            setFormat( t.d_colNr-1, t.d_len, f );
-        }
+        if( c != -1 )
+            setFormat( col, t.d_len, formatFor( c, t.d_type ) );
     }
 
     TextDocumentLayout::setParentheses(currentBlock(), parentheses);
@@ -22,6 +22,7 @@
 
 #include <texteditor/textdocumentlayout.h>
 #include <texteditor/syntaxhighlighter.h>
+#include <Verilog/VlPpLexer.h>
 
 namespace Vl
 {
@@ -33,6 +34,7 @@ namespace Vl
 
     protected:
         QTextCharFormat formatForCategory(int) const;
+        const QTextCharFormat& formatFor(int category, int tokenType);
 
         // overrides
         void highlightBlock(const QString &text);
@@ -40,6 +42,7 @@ namespace Vl
     private:
         enum Category { C_Num, C_Str, C_Kw, C_Type, C_Ident, C_Op, C_Pp, C_Cmt, C_Section, C_Brack, C_Max };
         QTextCharFormat d_format[C_Max];
+        QHash<quint32,QTextCharFormat> d_formats; // (category, token type) -> format incl. TokenProp
     };
 
 }
@@ -19,6 +19,7 @@
 
 #include "VlHoverHandler.h"
 #include "VlModelManager.h"
+#include "VlCodeIndex.h"
 #include <Verilog/VlCrossRefModel.h>
 #include <Verilog/VlPpSymbols.h>
 #include <Verilog/VlIncludes.h>
@@ -123,7 +124,7 @@ void VerilogHoverHandler::identifyMatch(TextEditor::TextEditorWidget* editorWidg
                 setToolTip( prettyPrint(d) );
         }else if( t.d_type == Tok_Ident )
         {
-            CrossRefModel::TreePath path = mdl->findSymbolBySourcePos( file, line, col );
+            CrossRefModel::TreePath path = ModelManager::instance()->getIndex(mdl)->findSymbolBySourcePos( file, line, col );
             if( path.isEmpty() )
                 return;
             CrossRefModel::IdentDeclRef decl = mdl->findDeclarationOfSymbol(path.first().data());
@@ -19,6 +19,10 @@
 
 #include "VlIcarusConfiguration.h"
 #include "VlProject.h"
+#include "VlModelManager.h"
+#include "VlJobRunner.h"
+#include "VlBuildFingerprint.h"
+#include <Verilog/VlSynTree.h>
 #include <projectexplorer/buildinfo.h>
 #include <projectexplorer/projectexplorerconstants.h>
 #include <projectexplorer/projectexplorer.h>
@@ -32,16 +36,25 @@
 #include <QFormLayout>
 #include <QLabel>
 #include <QLineEdit>
+#include <QSpinBox>
+#include <QXmlStreamWriter>
+#include <QDateTime>
+#include <QElapsedTimer>
 using namespace Vl;
 
 const char* IcarusBuildConfig::ID = "VerilogCreator.Icarus.BuildConfig";
 const char* IcarusMakeStep::ID = "VerilogCreator.Icarus.MakeStep";
 const char* IcarusCleanStep::ID = "VerilogCreator.Icarus.CleanStep";
+const char* IcarusRegressionStep::ID = "VerilogCreator.Icarus.RegressionStep";
 const char* IcarusRunConfiguration::ID = "VerilogCreator.Icarus.RunConfig";
 const char* IcarusRunConfiguration::Name = "Icarus Verilog";
 static const char* s_cmdFileName = "cmdfile.txt";
 static const char* s_compiledFileName = "compiled.vvp";
 static const char* s_defaultBuildDir = "icarus_build";
+static const char* s_fingerprintFileName = "fingerprint.txt";
+static const char* s_regressionDir = "regression";
+static const char* s_junitFileName = "junit.xml";
+static const int s_maxLogLines = 200;
 
 IcarusBuildConfig::IcarusBuildConfig(ProjectExplorer::Target* parent)
     : ProjectExplorer::BuildConfiguration(parent,ID)
@@ -132,7 +145,7 @@ void IcarusBuildConfigWidget::environmentChanged()
 }
 
 IcarusMakeStep::IcarusMakeStep(ProjectExplorer::BuildStepList* parent):
-    AbstractProcessStep(parent, ID)
+    AbstractProcessStep(parent, ID),d_prune(false)
 {
     setDefaultDisplayName(tr("iverilog") );
 }
@@ -167,27 +180,62 @@ bool IcarusMakeStep::init()
             return false;
         }
     }
-    QFile cmdfile( buildDir.absoluteFilePath(s_cmdFileName) );
-    if( !cmdfile.open(QIODevice::WriteOnly) )
+    QStringList srcFiles = p->getSrcFiles();
+    QStringList libFiles = p->getLibFiles();
+    if( d_prune )
+        p->getUsedFiles( srcFiles, libFiles );
+    const QString cmdPath = buildDir.absoluteFilePath(s_cmdFileName);
+    const QByteArray cmd = cmdFile(p, srcFiles, libFiles);
+    if( !BuildFingerprint::writeIfChanged( cmdPath, cmd ) )
     {
         emit addTask(ProjectExplorer::Task(ProjectExplorer::Task::Error,
-                       tr("Unable to create the file %1.").arg( QDir::toNativeSeparators(cmdfile.fileName())),
+                       tr("Unable to create the file %1.").arg( QDir::toNativeSeparators(cmdPath)),
                        Utils::FileName(), -1,
                        ProjectExplorer::Constants::TASK_CATEGORY_BUILDSYSTEM) );
         return false;
     }
 
-    cmdfile.write("# this file is automatically generated; do not edit\n");
-    foreach( const QString& f, p->getSrcFiles() )
+    QString args;
+    const QString topmodule = p->getTopMod().trimmed();
+    if( !topmodule.isEmpty() )
+        args += QString("-s %1 ").arg( topmodule );
+    args += QString("-c %1 ").arg( Utils::QtcProcess::quoteArg( cmdPath ) );
+    args += QString("-o %1 ").arg( Utils::QtcProcess::quoteArg( buildDir.absoluteFilePath( s_compiledFileName ) ) );
+    Utils::QtcProcess::addArgs( &args, d_args );
+
+    pp->setArguments( args );
+
+    pp->resolveAll();
+
+    d_fpSources = srcFiles + libFiles;
+    d_fpIncDirs = p->getIncludePath();
+    d_fpConfig = ( pp->effectiveCommand() + " " + pp->effectiveArguments() ).toUtf8() + "\n" + cmd;
+    d_fpFile = buildDir.absoluteFilePath(s_fingerprintFileName);
+    d_compiled = buildDir.absoluteFilePath( s_compiledFileName );
+
+    setIgnoreReturnValue(false);
+
+    // setOutputParser(new ProjectExplorer::GnuMakeParser());
+    if( outputParser() )
+        outputParser()->setWorkingDirectory(pp->effectiveWorkingDirectory());
+
+    return AbstractProcessStep::init();
+}
+
+QByteArray IcarusMakeStep::cmdFile(Project* p, const QStringList& srcFiles, const QStringList& libFiles)
+{
+    QByteArray res;
+    res += "# this file is automatically generated; do not edit\n";
+    foreach( const QString& f, srcFiles )
     {
-        cmdfile.write( f.toUtf8() );
-        cmdfile.write( "\n" );
+        res += f.toUtf8();
+        res += "\n";
     }
-    foreach( const QString& f, p->getLibFiles() )
+    foreach( const QString& f, libFiles )
     {
-        cmdfile.write( "-l " );
-        cmdfile.write( f.toUtf8() );
-        cmdfile.write( "\n" );
+        res += "-l ";
+        res += f.toUtf8();
+        res += "\n";
     }
     QSet<QString> undefs = QSet<QString>::fromList(p->getConfig("BUILD_UNDEFS"));
     foreach( const QString& f, p->getConfig("DEFINES") )
@@ -198,49 +246,49 @@ bool IcarusMakeStep::init()
         const QString val = ( pos == -1 ? QString() : def.mid(pos+1).trimmed() );
         if( !undefs.contains(key) )
         {
-            cmdfile.write( "+define+" );
-            cmdfile.write(key.toUtf8());
+            res += "+define+";
+            res += key.toUtf8();
             if( !val.isEmpty() )
             {
-                cmdfile.write( "=" );
-                cmdfile.write(val.toUtf8());
+                res += "=";
+                res += val.toUtf8();
             }
-            cmdfile.write( "\n" );
+            res += "\n";
         }
     }
     foreach( const QString& f, p->getIncDirs() )
     {
-        cmdfile.write( "+incdir+" );
-        cmdfile.write( f.trimmed().toUtf8() );
-        cmdfile.write( "\n" );
+        res += "+incdir+";
+        res += f.trimmed().toUtf8();
+        res += "\n";
     }
-
-    QString args;
-    const QString topmodule = p->getTopMod().trimmed();
-    if( !topmodule.isEmpty() )
-        args += QString("-s %1 ").arg( topmodule );
-    args += QString("-c %1 ").arg( Utils::QtcProcess::quoteArg( cmdfile.fileName() ) );
-    args += QString("-o %1 ").arg( Utils::QtcProcess::quoteArg( buildDir.absoluteFilePath( s_compiledFileName ) ) );
-    Utils::QtcProcess::addArgs( &args, d_args );
-
-    pp->setArguments( args );
-
-    pp->resolveAll();
-
-    setIgnoreReturnValue(false);
-
-    // setOutputParser(new ProjectExplorer::GnuMakeParser());
-    if( outputParser() )
-        outputParser()->setWorkingDirectory(pp->effectiveWorkingDirectory());
-
-    return AbstractProcessStep::init();
+    return res;
 }
 
 void IcarusMakeStep::run(QFutureInterface<bool>& fi)
 {
+    // nothing to do if neither the sources nor the configuration changed since the last successful run
+    d_fp = BuildFingerprint::compute( d_fpSources, d_fpIncDirs, d_fpConfig );
+    if( QFile::exists( d_compiled ) && BuildFingerprint::load( d_fpFile ) == d_fp )
+    {
+        emit addOutput(tr("Nothing changed since the last build; %1 is up to date").arg(s_compiledFileName),
+                       BuildStep::MessageOutput);
+        fi.reportResult(true);
+        emit finished();
+        return;
+    }
+    QFile::remove( d_fpFile );
     AbstractProcessStep::run(fi);
 }
 
+bool IcarusMakeStep::processSucceeded(int exitCode, QProcess::ExitStatus status)
+{
+    const bool ok = AbstractProcessStep::processSucceeded( exitCode, status );
+    if( ok )
+        BuildFingerprint::save( d_fpFile, d_fp );
+    return ok;
+}
+
 ProjectExplorer::BuildStepConfigWidget* IcarusMakeStep::createConfigWidget()
 {
     return new IcarusMakeStepWidget(this);
@@ -248,6 +296,7 @@ ProjectExplorer::BuildStepConfigWidget* IcarusMakeStep::createConfigWidget()
 
 static const char* MAKE_ARGUMENTS_KEY = "VerilogCreator.Icarus.MakeStep.Args";
 static const char* MAKE_COMMAND_KEY = "VerilogCreator.Icarus.MakeStep.Cmd";
+static const char* MAKE_PRUNE_KEY = "VerilogCreator.Icarus.MakeStep.Prune";
 
 QVariantMap IcarusMakeStep::toMap() const
 {
@@ -255,6 +304,7 @@ QVariantMap IcarusMakeStep::toMap() const
 
     map.insert(QLatin1String(MAKE_ARGUMENTS_KEY), d_args);
     map.insert(QLatin1String(MAKE_COMMAND_KEY), d_cmd);
+    map.insert(QLatin1String(MAKE_PRUNE_KEY), d_prune);
     return map;
 }
 
@@ -262,6 +312,7 @@ bool IcarusMakeStep::fromMap(const QVariantMap& map)
 {
     d_args = map.value(QLatin1String(MAKE_ARGUMENTS_KEY)).toString();
     d_cmd = map.value(QLatin1String(MAKE_COMMAND_KEY)).toString();
+    d_prune = map.value(QLatin1String(MAKE_PRUNE_KEY)).toBool();
 
     return BuildStep::fromMap(map);
 }
@@ -289,6 +340,11 @@ IcarusMakeStepWidget::IcarusMakeStepWidget(IcarusMakeStep* makeStep):d_step(make
     d_args->setText(makeStep->d_args);
     fl->addRow( tr("Additional arguments:"), d_args );
 
+    d_prune = new QCheckBox(this);
+    d_prune->setChecked(makeStep->d_prune);
+    d_prune->setToolTip(tr("Leave out the files of modules not instantiated below TOPMOD"));
+    fl->addRow( tr("Only files used by TOPMOD:"), d_prune );
+
     updateMakeOverrrideLabel();
     updateDetails();
 
@@ -296,6 +352,7 @@ IcarusMakeStepWidget::IcarusMakeStepWidget(IcarusMakeStep* makeStep):d_step(make
             this, &IcarusMakeStepWidget::makeLineEditTextEdited);
     connect( d_args, &QLineEdit::textEdited,
             this, &IcarusMakeStepWidget::makeArgumentsLineEditTextEdited);
+    connect( d_prune, SIGNAL(toggled(bool)), this, SLOT(pruneToggled(bool)) );
 
     connect(ProjectExplorer::ProjectExplorerPlugin::instance(), SIGNAL(settingsChanged()),
             this, SLOT(updateMakeOverrrideLabel()));
@@ -335,6 +392,12 @@ void IcarusMakeStepWidget::makeArgumentsLineEditTextEdited()
     updateDetails();
 }
 
+void IcarusMakeStepWidget::pruneToggled(bool on)
+{
+    d_step->d_prune = on;
+    updateDetails();
+}
+
 void IcarusMakeStepWidget::updateMakeOverrrideLabel()
 {
     ProjectExplorer::BuildConfiguration *bc = d_step->buildConfiguration();
@@ -394,6 +457,7 @@ void IcarusCleanStep::run(QFutureInterface<bool>& fi)
     {
         QFile::remove( buildDir.absoluteFilePath(s_cmdFileName) );
         QFile::remove( buildDir.absoluteFilePath(s_compiledFileName) );
+        QFile::remove( buildDir.absoluteFilePath(s_fingerprintFileName) );
     }
     AbstractProcessStep::run(fi);
 }
@@ -419,6 +483,446 @@ QString IcarusCleanStepWidget::summaryText() const
     return tr("<b>remove</b> %1 and %2").arg(s_cmdFileName).arg(s_compiledFileName);
 }
 
+// the markers are only recognized at the start of a line, so that e.g. a printed variable named
+// error_count or a message quoting "no ERROR expected" doesn't fail the test
+const char* IcarusRegressionStep::s_defaultPass = "^\\s*PASS(ED)?\\b";
+const char* IcarusRegressionStep::s_defaultFail = "^\\s*(FAIL(ED|URE)?|ERROR)\\b";
+
+IcarusRegressionStep::IcarusRegressionStep(ProjectExplorer::BuildStepList* parent):
+    BuildStep(parent, ID),d_patterns("tb_* *_tb test_* *_test"),d_maxJobs(0),d_requirePass(false),
+    d_passPattern(s_defaultPass),d_failPattern(s_defaultFail),d_simulating(false)
+{
+    setDefaultDisplayName(tr("Regression") );
+}
+
+bool IcarusRegressionStep::init()
+{
+    ProjectExplorer::BuildConfiguration *bc = buildConfiguration();
+    if (!bc)
+        bc = target()->activeBuildConfiguration();
+    if (!bc)
+    {
+        emit addTask(ProjectExplorer::Task::buildConfigurationMissingTask());
+        return false;
+    }
+
+    Vl::Project* p = dynamic_cast<Vl::Project*>( project() );
+    Q_ASSERT( p != 0 );
+
+    d_passRe = QRegExp( d_passPattern );
+    d_failRe = QRegExp( d_failPattern );
+    if( !d_passRe.isValid() || !d_failRe.isValid() )
+    {
+        emit addTask(ProjectExplorer::Task(ProjectExplorer::Task::Error,
+                       tr( "Invalid PASS or FAIL marker: %1")
+                       .arg( d_passRe.isValid() ? d_failRe.errorString() : d_passRe.errorString() ),
+                       Utils::FileName(), -1,
+                       ProjectExplorer::Constants::TASK_CATEGORY_BUILDSYSTEM) );
+        return false;
+    }
+
+    d_tests.clear();
+    CrossRefModel* mdl = ModelManager::instance()->getModelForFile( p->projectFilePath().toString() );
+    foreach( const QString& tb, findTestbenches( mdl, d_patterns ) )
+    {
+        Test t;
+        t.d_name = tb;
+        d_tests.append(t);
+    }
+    if( d_tests.isEmpty() )
+    {
+        emit addTask(ProjectExplorer::Task(ProjectExplorer::Task::Warning,
+                       tr( "No testbench found matching %1").arg( d_patterns ),
+                       Utils::FileName(), -1,
+                       ProjectExplorer::Constants::TASK_CATEGORY_BUILDSYSTEM) );
+        return false;
+    }
+
+    QDir buildDir = bc->buildDirectory().toString();
+    d_outDir = buildDir.absoluteFilePath( s_regressionDir );
+    for( int i = 0; i < d_tests.size(); i++ )
+    {
+        d_tests[i].d_dir = QDir( d_outDir ).absoluteFilePath( d_tests[i].d_name );
+        if( !buildDir.mkpath( d_tests[i].d_dir ) )
+        {
+            emit addTask(ProjectExplorer::Task(ProjectExplorer::Task::Error,
+                           tr( "Unable to create the directory %1.").arg( QDir::toNativeSeparators(d_tests[i].d_dir)),
+                           Utils::FileName(), -1,
+                           ProjectExplorer::Constants::TASK_CATEGORY_BUILDSYSTEM) );
+            return false;
+        }
+    }
+
+    // all testbenches share the sources, defines and include dirs of the project
+    QFile cmdfile( QDir( d_outDir ).absoluteFilePath(s_cmdFileName) );
+    if( !cmdfile.open(QIODevice::WriteOnly) )
+    {
+        emit addTask(ProjectExplorer::Task(ProjectExplorer::Task::Error,
+                       tr("Unable to create the file %1.").arg( QDir::toNativeSeparators(cmdfile.fileName())),
+                       Utils::FileName(), -1,
+                       ProjectExplorer::Constants::TASK_CATEGORY_BUILDSYSTEM) );
+        return false;
+    }
+    cmdfile.write( IcarusMakeStep::cmdFile(p, p->getSrcFiles(), p->getLibFiles()) );
+    d_cmdFile = cmdfile.fileName();
+
+    d_env = bc->environment();
+    d_iverilog = d_env.searchInPath("iverilog").toString();
+    d_vvp = d_env.searchInPath("vvp").toString();
+    if( d_iverilog.isEmpty() || d_vvp.isEmpty() )
+    {
+        emit addTask(ProjectExplorer::Task(ProjectExplorer::Task::Error,
+                       tr("iverilog or vvp not found in the build environment"),
+                       Utils::FileName(), -1,
+                       ProjectExplorer::Constants::TASK_CATEGORY_BUILDSYSTEM) );
+        return false;
+    }
+    return true;
+}
+
+void IcarusRegressionStep::run(QFutureInterface<bool>& fi)
+{
+    QElapsedTimer time;
+    time.start();
+
+    // each testbench is compiled once; the simulations of the ones which compiled run afterwards
+    d_simulating = false;
+    d_jobToTest.clear();
+    {
+        JobRunner runner;
+        runner.setMaxJobs( d_maxJobs );
+        for( int i = 0; i < d_tests.size(); i++ )
+        {
+            JobRunner::Job j;
+            j.d_name = d_tests[i].d_name;
+            j.d_cmd = d_iverilog;
+            j.d_args = QString("-s %1 -c %2 -o %3").arg( d_tests[i].d_name )
+                    .arg( Utils::QtcProcess::quoteArg( d_cmdFile ) ).arg( s_compiledFileName );
+            j.d_workDir = d_tests[i].d_dir;
+            j.d_env = d_env;
+            runner.add( j );
+            d_jobToTest.append( i );
+        }
+        connect( &runner, SIGNAL(sigOutput(int,QString,bool)), this, SLOT(onJobOutput(int,QString,bool)),
+                 Qt::DirectConnection );
+        emit addOutput( tr("Compiling %1 testbenches").arg( d_tests.size() ), BuildStep::MessageOutput );
+        runner.run( fi );
+        for( int i = 0; i < runner.getJobCount(); i++ )
+            d_tests[d_jobToTest[i]].d_compiled = runner.getJob(i).succeeded();
+    }
+
+    if( !fi.isCanceled() )
+    {
+        d_simulating = true;
+        d_jobToTest.clear();
+        JobRunner runner;
+        runner.setMaxJobs( d_maxJobs );
+        for( int i = 0; i < d_tests.size(); i++ )
+        {
+            if( !d_tests[i].d_compiled )
+                continue;
+            JobRunner::Job j;
+            j.d_name = d_tests[i].d_name;
+            j.d_cmd = d_vvp;
+            j.d_args = s_compiledFileName;
+            Utils::QtcProcess::addArgs( &j.d_args, d_vvpArgs );
+            j.d_workDir = d_tests[i].d_dir;
+            j.d_env = d_env;
+            runner.add( j );
+            d_jobToTest.append( i );
+        }
+        connect( &runner, SIGNAL(sigOutput(int,QString,bool)), this, SLOT(onJobOutput(int,QString,bool)),
+                 Qt::DirectConnection );
+        emit addOutput( tr("Running %1 simulations, up to %2 at a time").arg( runner.getJobCount() )
+                        .arg( runner.getMaxJobs() ), BuildStep::MessageOutput );
+        runner.run( fi );
+        for( int i = 0; i < runner.getJobCount(); i++ )
+        {
+            Test& t = d_tests[d_jobToTest[i]];
+            t.d_exitCode = runner.getJob(i).d_exitCode;
+            t.d_crashed = runner.getJob(i).d_crashed || !runner.getJob(i).d_done;
+            t.d_ms = runner.getJob(i).d_ms;
+        }
+    }
+
+    if( fi.isCanceled() )
+    {
+        emit addOutput( tr("Canceled"), BuildStep::ErrorMessageOutput );
+        fi.reportResult(false);
+        emit finished();
+        return;
+    }
+
+    int failed = 0;
+    foreach( const Test& t, d_tests )
+    {
+        if( passed(t) )
+            emit addOutput( tr("    PASS %1 (%2 s)").arg( t.d_name ).arg( t.d_ms / 1000.0, 0, 'f', 2 ),
+                            BuildStep::MessageOutput );
+        else
+        {
+            emit addOutput( tr("    FAIL %1: %2").arg( t.d_name ).arg( failure(t) ), BuildStep::ErrorMessageOutput );
+            failed++;
+        }
+    }
+    const QString junit = QDir( d_outDir ).absoluteFilePath( s_junitFileName );
+    if( !writeJUnit( junit, time.elapsed() ) )
+        emit addOutput( tr("Unable to write %1").arg( QDir::toNativeSeparators(junit) ),
+                        BuildStep::ErrorMessageOutput );
+    emit addOutput( tr("Regression: %1 of %2 tests passed in %3 s; report in %4")
+                    .arg( d_tests.size() - failed ).arg( d_tests.size() )
+                    .arg( time.elapsed() / 1000.0, 0, 'f', 1 ).arg( QDir::toNativeSeparators(junit) ),
+                    failed == 0 ? BuildStep::MessageOutput : BuildStep::ErrorMessageOutput );
+
+    fi.reportResult( failed == 0 );
+
+    emit finished();
+}
+
+void IcarusRegressionStep::onJobOutput(int job, const QString& line, bool err)
+{
+    Test& t = d_tests[ d_jobToTest[job] ];
+    if( d_simulating )
+    {
+        // markers printed with $display by the testbench; an empty pattern disables the marker
+        if( !d_failPattern.isEmpty() && line.contains(d_failRe) )
+            t.d_failMark = true;
+        else if( !d_passPattern.isEmpty() && line.contains(d_passRe) )
+            t.d_passMark = true;
+    }
+    t.d_log.append( line );
+    if( t.d_log.size() > s_maxLogLines )
+        t.d_log.removeFirst();
+    emit addOutput( QString("[%1] %2").arg( t.d_name ).arg( line ),
+                    err ? BuildStep::ErrorOutput : BuildStep::NormalOutput );
+}
+
+bool IcarusRegressionStep::passed(const IcarusRegressionStep::Test& t) const
+{
+    return t.d_compiled && !t.d_crashed && t.d_exitCode == 0 && !t.d_failMark &&
+            ( t.d_passMark || !d_requirePass );
+}
+
+QString IcarusRegressionStep::failure(const IcarusRegressionStep::Test& t) const
+{
+    if( !t.d_compiled )
+        return tr("compilation failed");
+    if( t.d_crashed )
+        return tr("simulation crashed");
+    if( t.d_exitCode != 0 )
+        return tr("vvp exit code %1").arg( t.d_exitCode );
+    if( t.d_failMark )
+        return tr("FAIL reported");
+    if( !t.d_passMark && d_requirePass )
+        return tr("no PASS reported");
+    return QString();
+}
+
+bool IcarusRegressionStep::writeJUnit(const QString& path, qint64 ms) const
+{
+    QFile f( path );
+    if( !f.open( QIODevice::WriteOnly ) )
+        return false;
+    int failures = 0;
+    foreach( const Test& t, d_tests )
+    {
+        if( !passed(t) )
+            failures++;
+    }
+    QXmlStreamWriter out( &f );
+    out.setAutoFormatting(true);
+    out.writeStartDocument();
+    out.writeStartElement("testsuite");
+    out.writeAttribute("name", project()->displayName() );
+    out.writeAttribute("tests", QString::number( d_tests.size() ) );
+    out.writeAttribute("failures", QString::number( failures ) );
+    out.writeAttribute("time", QString::number( ms / 1000.0, 'f', 3 ) );
+    out.writeAttribute("timestamp", QDateTime::currentDateTime().toString(Qt::ISODate) );
+    foreach( const Test& t, d_tests )
+    {
+        out.writeStartElement("testcase");
+        out.writeAttribute("name", t.d_name );
+        out.writeAttribute("classname", project()->displayName() );
+        out.writeAttribute("time", QString::number( t.d_ms / 1000.0, 'f', 3 ) );
+        if( !passed(t) )
+        {
+            out.writeStartElement("failure");
+            out.writeAttribute("message", failure(t) );
+            out.writeEndElement();
+        }
+        out.writeTextElement("system-out", t.d_log.join( QChar('\n') ) );
+        out.writeEndElement();
+    }
+    out.writeEndElement();
+    out.writeEndDocument();
+    return !out.hasError();
+}
+
+static void collectInstantiated( const CrossRefModel::Branch* b, QSet<QByteArray>& res )
+{
+    foreach( const CrossRefModel::SymRef& sub, b->children() )
+    {
+        const CrossRefModel::Branch* b2 = sub->toBranch();
+        if( sub->tok().d_type == SynTree::R_module_or_udp_instance_ && b2 && b2->super() )
+            res.insert( b2->super()->tok().d_val );
+        if( b2 )
+            collectInstantiated( b2, res );
+    }
+}
+
+QStringList IcarusRegressionStep::findTestbenches(CrossRefModel* mdl, const QString& patterns)
+{
+    QStringList res;
+    if( mdl == 0 )
+        return res;
+    QList<QRegExp> filter;
+    foreach( const QString& pat, patterns.split( QRegExp("[\\s;,]+"), QString::SkipEmptyParts ) )
+        filter.append( QRegExp( pat, Qt::CaseInsensitive, QRegExp::Wildcard ) );
+
+    QSet<QByteArray> used;
+    QStringList modules;
+    foreach( const CrossRefModel::IdentDeclRef& id, mdl->getGlobalNames() )
+    {
+        const CrossRefModel::Branch* decl = id->decl();
+        if( decl == 0 || decl->tok().d_type != SynTree::R_module_declaration )
+            continue;
+        collectInstantiated( decl, used );
+        modules.append( QString::fromLatin1( id->tok().d_val ) );
+    }
+    foreach( const QString& m, modules )
+    {
+        if( used.contains( m.toLatin1() ) )
+            continue;
+        foreach( const QRegExp& re, filter )
+        {
+            if( re.exactMatch( m ) )
+            {
+                res.append( m );
+                break;
+            }
+        }
+    }
+    res.sort();
+    return res;
+}
+
+ProjectExplorer::BuildStepConfigWidget* IcarusRegressionStep::createConfigWidget()
+{
+    return new IcarusRegressionStepWidget(this);
+}
+
+static const char* REGRESSION_PATTERNS_KEY = "VerilogCreator.Icarus.RegressionStep.Patterns";
+static const char* REGRESSION_VVPARGS_KEY = "VerilogCreator.Icarus.RegressionStep.VvpArgs";
+static const char* REGRESSION_MAXJOBS_KEY = "VerilogCreator.Icarus.RegressionStep.MaxJobs";
+static const char* REGRESSION_REQPASS_KEY = "VerilogCreator.Icarus.RegressionStep.RequirePass";
+static const char* REGRESSION_PASSMARK_KEY = "VerilogCreator.Icarus.RegressionStep.PassMarker";
+static const char* REGRESSION_FAILMARK_KEY = "VerilogCreator.Icarus.RegressionStep.FailMarker";
+
+QVariantMap IcarusRegressionStep::toMap() const
+{
+    QVariantMap map(BuildStep::toMap());
+
+    map.insert(QLatin1String(REGRESSION_PATTERNS_KEY), d_patterns);
+    map.insert(QLatin1String(REGRESSION_VVPARGS_KEY), d_vvpArgs);
+    map.insert(QLatin1String(REGRESSION_MAXJOBS_KEY), d_maxJobs);
+    map.insert(QLatin1String(REGRESSION_REQPASS_KEY), d_requirePass);
+    map.insert(QLatin1String(REGRESSION_PASSMARK_KEY), d_passPattern);
+    map.insert(QLatin1String(REGRESSION_FAILMARK_KEY), d_failPattern);
+    return map;
+}
+
+bool IcarusRegressionStep::fromMap(const QVariantMap& map)
+{
+    d_patterns = map.value(QLatin1String(REGRESSION_PATTERNS_KEY), d_patterns).toString();
+    d_vvpArgs = map.value(QLatin1String(REGRESSION_VVPARGS_KEY)).toString();
+    d_maxJobs = map.value(QLatin1String(REGRESSION_MAXJOBS_KEY)).toInt();
+    d_requirePass = map.value(QLatin1String(REGRESSION_REQPASS_KEY)).toBool();
+    d_passPattern = map.value(QLatin1String(REGRESSION_PASSMARK_KEY), d_passPattern).toString();
+    d_failPattern = map.value(QLatin1String(REGRESSION_FAILMARK_KEY), d_failPattern).toString();
+
+    return BuildStep::fromMap(map);
+}
+
+IcarusRegressionStepWidget::IcarusRegressionStepWidget(IcarusRegressionStep* step):d_step(step)
+{
+    QFormLayout *fl = new QFormLayout(this);
+    fl->setContentsMargins(0, -1, 0, -1);
+    fl->setFieldGrowthPolicy(QFormLayout::ExpandingFieldsGrow);
+
+    d_patterns = new QLineEdit(this);
+    d_patterns->setText(step->d_patterns);
+    d_patterns->setToolTip(tr("Wildcard patterns of the testbench modules; only modules "
+                              "which are not instantiated anywhere are considered"));
+    fl->addRow( tr("Testbenches:"), d_patterns );
+
+    d_vvpArgs = new QLineEdit(this);
+    d_vvpArgs->setText(step->d_vvpArgs);
+    fl->addRow( tr("Additional vvp arguments:"), d_vvpArgs );
+
+    d_maxJobs = new QSpinBox(this);
+    d_maxJobs->setRange( 0, 256 );
+    d_maxJobs->setSpecialValueText(tr("one per core"));
+    d_maxJobs->setValue(step->d_maxJobs);
+    fl->addRow( tr("Parallel jobs:"), d_maxJobs );
+
+    d_requirePass = new QCheckBox(this);
+    d_requirePass->setChecked(step->d_requirePass);
+    fl->addRow( tr("Require PASS output:"), d_requirePass );
+
+    d_passPattern = new QLineEdit(this);
+    d_passPattern->setText(step->d_passPattern);
+    d_passPattern->setPlaceholderText(tr("disabled"));
+    d_passPattern->setToolTip(tr("Regular expression matched against each line of the simulation output; "
+                                 "default %1").arg( IcarusRegressionStep::s_defaultPass ));
+    fl->addRow( tr("PASS marker:"), d_passPattern );
+
+    d_failPattern = new QLineEdit(this);
+    d_failPattern->setText(step->d_failPattern);
+    d_failPattern->setPlaceholderText(tr("disabled"));
+    d_failPattern->setToolTip(tr("Regular expression matched against each line of the simulation output; "
+                                 "default %1").arg( IcarusRegressionStep::s_defaultFail ));
+    fl->addRow( tr("FAIL marker:"), d_failPattern );
+
+    updateDetails();
+
+    connect( d_patterns, SIGNAL(textEdited(QString)), this, SLOT(edited()) );
+    connect( d_vvpArgs, SIGNAL(textEdited(QString)), this, SLOT(edited()) );
+    connect( d_maxJobs, SIGNAL(valueChanged(int)), this, SLOT(edited()) );
+    connect( d_requirePass, SIGNAL(toggled(bool)), this, SLOT(edited()) );
+    connect( d_passPattern, SIGNAL(textEdited(QString)), this, SLOT(edited()) );
+    connect( d_failPattern, SIGNAL(textEdited(QString)), this, SLOT(edited()) );
+    connect(step->target()->project(), &ProjectExplorer::Project::fileListChanged,
+            this, &IcarusRegressionStepWidget::updateDetails);
+}
+
+QString IcarusRegressionStepWidget::displayName() const
+{
+    return tr("Regression");
+}
+
+QString IcarusRegressionStepWidget::summaryText() const
+{
+    return d_summary;
+}
+
+void IcarusRegressionStepWidget::edited()
+{
+    d_step->d_patterns = d_patterns->text();
+    d_step->d_vvpArgs = d_vvpArgs->text();
+    d_step->d_maxJobs = d_maxJobs->value();
+    d_step->d_requirePass = d_requirePass->isChecked();
+    d_step->d_passPattern = d_passPattern->text();
+    d_step->d_failPattern = d_failPattern->text();
+    updateDetails();
+}
+
+void IcarusRegressionStepWidget::updateDetails()
+{
+    d_summary = tr("<b>Regression</b>: compile and run the testbenches matching %1")
+            .arg( d_step->d_patterns.toHtmlEscaped() );
+    emit updateSummary();
+}
+
 
 QWidget*IcarusRunConfiguration::createConfigurationWidget()
 {
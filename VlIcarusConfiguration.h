@@ -25,12 +25,19 @@
 #include <projectexplorer/abstractprocessstep.h>
 #include <projectexplorer/localapplicationrunconfiguration.h>
 #include <utils/pathchooser.h>
+#include <utils/environment.h>
+#include <QRegExp>
 
 class QLabel;
 class QCheckBox;
+class QSpinBox;
 
 namespace Vl
 {
+    class Project;
+    class CrossRefModel;
+    class JobRunner;
+
     class IcarusBuildConfig : public ProjectExplorer::BuildConfiguration
     {
         Q_OBJECT
@@ -79,12 +86,22 @@ namespace Vl
         bool immutable() const { return false; }
         ProjectExplorer::BuildStepConfigWidget* createConfigWidget();
         QVariantMap toMap() const;
+        static QByteArray cmdFile( Project*, const QStringList& srcFiles, const QStringList& libFiles ); // contents of the iverilog -c file
     protected:
         QString makeCommand(const Utils::Environment &environment) const;
         bool fromMap(const QVariantMap &map);
+        bool processSucceeded(int exitCode, QProcess::ExitStatus status);
     private:
         QString d_cmd;
         QString d_args;
+        // the fingerprint is computed in run(), off the GUI thread, from what init() collected
+        QStringList d_fpSources;
+        QStringList d_fpIncDirs;
+        QByteArray d_fpConfig;
+        QString d_fpFile;
+        QByteArray d_fp;
+        QString d_compiled;
+        bool d_prune; // only pass the files used by TOPMOD
         friend class IcarusMakeStepWidget;
     };
 
@@ -100,6 +117,7 @@ namespace Vl
     private slots:
         void makeLineEditTextEdited();
         void makeArgumentsLineEditTextEdited();
+        void pruneToggled(bool);
         void updateMakeOverrrideLabel();
         void updateDetails();
 
@@ -109,6 +127,7 @@ namespace Vl
         QLabel* d_cmdLabel;
         QLineEdit* d_cmd;
         QLineEdit* d_args;
+        QCheckBox* d_prune;
     };
 
     class IcarusCleanStep : public ProjectExplorer::AbstractProcessStep
@@ -135,6 +154,96 @@ namespace Vl
         QString summaryText() const;
     };
 
+    // Compiles every testbench top found in the code model once and runs the simulations in parallel.
+    // A test passes if vvp exits with 0, prints no FAIL marker and, if required, printed a PASS marker.
+    // The markers are regular expressions matched against each output line of the simulation.
+    // The results also go to a JUnit XML file in the build directory.
+    class IcarusRegressionStep : public ProjectExplorer::BuildStep
+    {
+        Q_OBJECT
+    public:
+        static const char* ID;
+        static const char* s_defaultPass;
+        static const char* s_defaultFail;
+
+        explicit IcarusRegressionStep(ProjectExplorer::BuildStepList *parent);
+
+        bool init();
+        void run(QFutureInterface<bool> &fi);
+        bool immutable() const { return false; }
+        ProjectExplorer::BuildStepConfigWidget* createConfigWidget();
+        QVariantMap toMap() const;
+
+        // modules matching one of the wildcard patterns which are not instantiated anywhere
+        static QStringList findTestbenches( CrossRefModel*, const QString& patterns );
+    protected:
+        bool fromMap(const QVariantMap &map);
+    protected slots:
+        void onJobOutput( int, const QString&, bool );
+    private:
+        struct Test
+        {
+            QString d_name;
+            QString d_dir;
+            bool d_compiled;
+            bool d_passMark;
+            bool d_failMark;
+            int d_exitCode;
+            bool d_crashed;
+            qint64 d_ms;
+            QStringList d_log; // the tail of the output for the report
+            Test():d_compiled(false),d_passMark(false),d_failMark(false),d_exitCode(-1),
+                d_crashed(false),d_ms(0){}
+        };
+        bool passed( const Test& ) const;
+        QString failure( const Test& ) const;
+        bool writeJUnit( const QString& path, qint64 ms ) const;
+
+        QString d_patterns;
+        QString d_vvpArgs;
+        int d_maxJobs;
+        bool d_requirePass;
+        QString d_passPattern;
+        QString d_failPattern;
+        // prepared by init()
+        QRegExp d_passRe;
+        QRegExp d_failRe;
+        QList<Test> d_tests;
+        QString d_iverilog;
+        QString d_vvp;
+        QString d_cmdFile;
+        QString d_outDir;
+        Utils::Environment d_env;
+        // only during run()
+        QList<int> d_jobToTest;
+        bool d_simulating;
+        friend class IcarusRegressionStepWidget;
+    };
+
+    class IcarusRegressionStepWidget : public ProjectExplorer::BuildStepConfigWidget
+    {
+        Q_OBJECT
+
+    public:
+        IcarusRegressionStepWidget(IcarusRegressionStep *step);
+        QString displayName() const;
+        QString summaryText() const;
+
+    private slots:
+        void edited();
+        void updateDetails();
+
+    private:
+        IcarusRegressionStep* d_step;
+        QString d_summary;
+        QLineEdit* d_patterns;
+        QLineEdit* d_vvpArgs;
+        QSpinBox* d_maxJobs;
+        QCheckBox* d_requirePass;
+        QLineEdit* d_passPattern;
+        QLineEdit* d_failPattern;
+    };
+
     class IcarusRunConfiguration : public ProjectExplorer::LocalApplicationRunConfiguration
     {
         Q_OBJECT
@@ -0,0 +1,235 @@
+/*
+* Copyright 2019 Rochus Keller <mailto:me@rochus-keller.ch>
+*
+* This file is part of the VerilogCreator plugin.
+*
+* The following is the license that applies to this copy of the
+* plugin. For a license to use the plugin under conditions
+* other than those described here, please email to me@rochus-keller.ch.
+*
+* GNU General Public License Usage
+* This file may be used under the terms of the GNU General Public
+* License (GPL) versions 2.0 or 3.0 as published by the Free Software
+* Foundation and appearing in the file LICENSE.GPL included in
+* the packaging of this file. Please review the following information
+* to ensure GNU General Public Licensing requirements will be met:
+* http://www.fsf.org/licensing/licenses/info/GPLv2.html and
+* http://www.gnu.org/copyleft/gpl.html.
+*/
+
+
+#include "VlJobRunner.h"
+#include <utils/qtcprocess.h>
+#include <QEventLoop>
+#include <QPointer>
+#include <QThread>
+#include <QTimer>
+using namespace Vl;
+
+JobRunner::JobRunner(QObject *parent) : QObject(parent),d_next(0),d_finished(0),d_maxJobs(0),d_loop(0),d_fi(0)
+{
+}
+
+JobRunner::~JobRunner()
+{
+    if( d_loop )
+        d_loop->quit();
+    QHash<QProcess*,Running>::const_iterator i;
+    for( i = d_running.begin(); i != d_running.end(); ++i )
+    {
+        i.key()->disconnect(this);
+        i.key()->kill();
+        i.key()->waitForFinished();
+    }
+    // the processes are children and deleted with the runner
+}
+
+void JobRunner::setMaxJobs(int n)
+{
+    d_maxJobs = qMax( 0, n );
+}
+
+int JobRunner::getMaxJobs() const
+{
+    if( d_maxJobs > 0 )
+        return d_maxJobs;
+    else
+        return qMax( 1, QThread::idealThreadCount() );
+}
+
+int JobRunner::add(const JobRunner::Job& j)
+{
+    d_jobs.append(j);
+    return d_jobs.size() - 1;
+}
+
+int JobRunner::getFailedCount() const
+{
+    int res = 0;
+    foreach( const Job& j, d_jobs )
+    {
+        if( !j.succeeded() )
+            res++;
+    }
+    return res;
+}
+
+bool JobRunner::run(QFutureInterface<bool>& fi)
+{
+    if( d_jobs.isEmpty() )
+        return true;
+    d_fi = &fi;
+    d_next = 0;
+    d_finished = 0;
+    fi.setProgressRange( 0, d_jobs.size() );
+
+    QTimer timer;
+    connect( &timer, SIGNAL(timeout()), this, SLOT(onCheckCanceled()) );
+    timer.start(500);
+
+    const int max = getMaxJobs();
+    for( int i = 0; i < max && d_next < d_jobs.size(); i++ )
+        startNext();
+
+    // the loop dispatches arbitrary events, so this runner may be gone when it returns
+    QPointer<JobRunner> self(this);
+    QEventLoop loop;
+    d_loop = &loop;
+    if( d_finished < d_jobs.size() )
+        loop.exec();
+    if( self.isNull() )
+        return false;
+    d_loop = 0;
+    d_fi = 0;
+    if( fi.isCanceled() )
+        return false;
+    return getFailedCount() == 0;
+}
+
+void JobRunner::startNext()
+{
+    if( d_fi->isCanceled() )
+        return;
+    const int id = d_next++;
+    Job& j = d_jobs[id];
+    Utils::QtcProcess* p = new Utils::QtcProcess(this);
+    p->setWorkingDirectory( j.d_workDir );
+    p->setEnvironment( j.d_env );
+    p->setCommand( j.d_cmd, j.d_args );
+    Running& r = d_running[p];
+    r.d_job = id;
+    r.d_time.start();
+    connect( p, SIGNAL(readyReadStandardOutput()), this, SLOT(onStdOut()) );
+    connect( p, SIGNAL(readyReadStandardError()), this, SLOT(onStdErr()) );
+    connect( p, SIGNAL(finished(int,QProcess::ExitStatus)), this, SLOT(onFinished()) );
+    connect( p, SIGNAL(error(QProcess::ProcessError)), this, SLOT(onError(QProcess::ProcessError)) );
+    emit sigStarted( id );
+    p->start();
+}
+
+void JobRunner::done(QProcess* p, int exitCode, bool crashed)
+{
+    QHash<QProcess*,Running>::iterator i = d_running.find(p);
+    if( i == d_running.end() )
+        return;
+    Running& r = i.value();
+    flush( r, r.d_out, false, true );
+    flush( r, r.d_err, true, true );
+    Job& j = d_jobs[r.d_job];
+    j.d_exitCode = exitCode;
+    j.d_crashed = crashed;
+    j.d_done = true;
+    j.d_ms = r.d_time.elapsed();
+    const int id = r.d_job;
+    d_running.erase(i);
+    d_finished++;
+    d_fi->setProgressValue( d_finished );
+    emit sigFinished( id );
+
+    if( d_next < d_jobs.size() && !d_fi->isCanceled() )
+        startNext();
+    else if( d_running.isEmpty() && d_loop )
+        d_loop->quit();
+}
+
+void JobRunner::flush(JobRunner::Running& r, QByteArray& buf, bool err, bool all)
+{
+    int start = 0;
+    int pos;
+    while( ( pos = buf.indexOf('\n', start) ) != -1 )
+    {
+        int end = pos;
+        if( end > start && buf[end-1] == '\r' )
+            end--;
+        emit sigOutput( r.d_job, QString::fromLocal8Bit( buf.constData() + start, end - start ), err );
+        start = pos + 1;
+    }
+    if( all && start < buf.size() )
+    {
+        emit sigOutput( r.d_job, QString::fromLocal8Bit( buf.constData() + start, buf.size() - start ), err );
+        start = buf.size();
+    }
+    buf.remove( 0, start );
+}
+
+void JobRunner::onStdOut()
+{
+    QProcess* p = static_cast<QProcess*>( sender() );
+    QHash<QProcess*,Running>::iterator i = d_running.find(p);
+    if( i == d_running.end() )
+        return;
+    i.value().d_out += p->readAllStandardOutput();
+    flush( i.value(), i.value().d_out, false, false );
+}
+
+void JobRunner::onStdErr()
+{
+    QProcess* p = static_cast<QProcess*>( sender() );
+    QHash<QProcess*,Running>::iterator i = d_running.find(p);
+    if( i == d_running.end() )
+        return;
+    i.value().d_err += p->readAllStandardError();
+    flush( i.value(), i.value().d_err, true, false );
+}
+
+void JobRunner::onFinished()
+{
+    QProcess* p = static_cast<QProcess*>( sender() );
+    // read what is left; readyRead is not guaranteed to be emitted for it
+    QHash<QProcess*,Running>::iterator i = d_running.find(p);
+    if( i != d_running.end() )
+    {
+        i.value().d_out += p->readAllStandardOutput();
+        i.value().d_err += p->readAllStandardError();
+    }
+    done( p, p->exitCode(), p->exitStatus() == QProcess::CrashExit );
+}
+
+void JobRunner::onError(QProcess::ProcessError e)
+{
+    // only a failed start goes without finished()
+    if( e != QProcess::FailedToStart )
+        return;
+    QProcess* p = static_cast<QProcess*>( sender() );
+    QHash<QProcess*,Running>::iterator i = d_running.find(p);
+    if( i != d_running.end() )
+        emit sigOutput( i.value().d_job, tr("Could not start \"%1\": %2")
+                        .arg( d_jobs[i.value().d_job].d_cmd ).arg( p->errorString() ), true );
+    done( p, -1, true );
+}
+
+void JobRunner::onCheckCanceled()
+{
+    if( d_fi == 0 || !d_fi->isCanceled() )
+        return;
+    QHash<QProcess*,Running>::const_iterator i;
+    for( i = d_running.begin(); i != d_running.end(); ++i )
+    {
+        i.key()->disconnect(this);
+        i.key()->kill();
+        i.key()->waitForFinished();
+    }
+    d_running.clear();
+    if( d_loop )
+        d_loop->quit();
+}
@@ -0,0 +1,103 @@
+#ifndef VLJOBRUNNER_H
+#define VLJOBRUNNER_H
+
+/*
+* Copyright 2019 Rochus Keller <mailto:me@rochus-keller.ch>
+*
+* This file is part of the VerilogCreator plugin.
+*
+* The following is the license that applies to this copy of the
+* plugin. For a license to use the plugin under conditions
+* other than those described here, please email to me@rochus-keller.ch.
+*
+* GNU General Public License Usage
+* This file may be used under the terms of the GNU General Public
+* License (GPL) versions 2.0 or 3.0 as published by the Free Software
+* Foundation and appearing in the file LICENSE.GPL included in
+* the packaging of this file. Please review the following information
+* to ensure GNU General Public Licensing requirements will be met:
+* http://www.fsf.org/licensing/licenses/info/GPLv2.html and
+* http://www.gnu.org/copyleft/gpl.html.
+*/
+
+#include <utils/environment.h>
+#include <QObject>
+#include <QProcess>
+#include <QFutureInterface>
+#include <QElapsedTimer>
+
+class QEventLoop;
+
+namespace Vl
+{
+    // Runs independent tool invocations concurrently, at most getMaxJobs() at a time. Output is delivered
+    // line by line per job, so the caller can prefix and interleave it. run() blocks in a local event loop,
+    // like AbstractProcessStep::run does, so the runner has to live in the thread of the build step.
+    class JobRunner : public QObject
+    {
+        Q_OBJECT
+    public:
+        struct Job
+        {
+            QString d_name;
+            QString d_cmd;
+            QString d_args;
+            QString d_workDir;
+            Utils::Environment d_env;
+            // results
+            int d_exitCode;
+            bool d_crashed; // or did not start at all
+            bool d_done;
+            qint64 d_ms;
+            Job():d_exitCode(-1),d_crashed(false),d_done(false),d_ms(0){}
+            bool succeeded() const { return d_done && !d_crashed && d_exitCode == 0; }
+        };
+
+        explicit JobRunner(QObject *parent = 0);
+        ~JobRunner();
+
+        void setMaxJobs( int ); // 0 means one job per core
+        int getMaxJobs() const;
+        int add( const Job& );
+        int getJobCount() const { return d_jobs.size(); }
+        const Job& getJob( int i ) const { return d_jobs[i]; }
+        int getFailedCount() const;
+
+        // returns true if all jobs succeeded; returns early with false if fi is canceled or the runner
+        // is deleted by an event dispatched in the local loop
+        bool run( QFutureInterface<bool>& fi );
+
+    signals:
+        void sigStarted( int job );
+        void sigOutput( int job, const QString& line, bool err );
+        void sigFinished( int job );
+
+    protected slots:
+        void onStdOut();
+        void onStdErr();
+        void onFinished();
+        void onError( QProcess::ProcessError );
+        void onCheckCanceled();
+
+    private:
+        struct Running
+        {
+            int d_job;
+            QByteArray d_out, d_err; // incomplete last lines
+            QElapsedTimer d_time;
+        };
+        void startNext();
+        void done( QProcess*, int exitCode, bool crashed );
+        void flush( Running&, QByteArray& buf, bool err, bool all );
+
+        QList<Job> d_jobs;
+        QHash<QProcess*,Running> d_running;
+        int d_next;
+        int d_finished;
+        int d_maxJobs;
+        QEventLoop* d_loop;
+        QFutureInterface<bool>* d_fi;
+    };
+}
+
+#endif // VLJOBRUNNER_H
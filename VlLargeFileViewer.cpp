@@ -0,0 +1,1044 @@
+/*
+* Copyright 2019 Rochus Keller <mailto:me@rochus-keller.ch>
+*
+* This file is part of the VerilogCreator plugin.
+*
+* The following is the license that applies to this copy of the
+* plugin. For a license to use the plugin under conditions
+* other than those described here, please email to me@rochus-keller.ch.
+*
+* GNU General Public License Usage
+* This file may be used under the terms of the GNU General Public
+* License (GPL) versions 2.0 or 3.0 as published by the Free Software
+* Foundation and appearing in the file LICENSE.GPL included in
+* the packaging of this file. Please review the following information
+* to ensure GNU General Public Licensing requirements will be met:
+* http://www.fsf.org/licensing/licenses/info/GPLv2.html and
+* http://www.gnu.org/copyleft/gpl.html.
+*/
+
+#include "VlLargeFileViewer.h"
+#include "VlConstants.h"
+#include <Verilog/VlPpLexer.h>
+#include <Sdf/SdfLexer.h>
+#include <coreplugin/icore.h>
+#include <coreplugin/progressmanager/progressmanager.h>
+#include <texteditor/texteditorsettings.h>
+#include <texteditor/fontsettings.h>
+#include <utils/fileutils.h>
+#include <utils/mimetypes/mimedatabase.h>
+#include <aggregation/aggregate.h>
+#include <QtConcurrent/QtConcurrentRun>
+#include <QApplication>
+#include <QByteArrayMatcher>
+#include <QFileInfo>
+#include <QKeyEvent>
+#include <QLabel>
+#include <QPainter>
+#include <QScrollBar>
+#include <QSettings>
+#include <QToolBar>
+#include <algorithm>
+#include <limits.h>
+#include <string.h>
+#ifdef Q_OS_UNIX
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+using namespace Vl;
+
+static const qint64 s_chunk = 4 * 1024 * 1024; // the size, progress and cancel are checked after each chunk
+static const qint64 s_maxBack = 1024 * 1024; // longer lines are split when scrolling backwards
+static const qint64 s_incrementalRange = 64 * 1024 * 1024; // searched while typing
+static const int s_maxLineLen = 4096; // display limit; longer lines are cut
+static const int s_tabWidth = 8;
+static const int s_margin = 4;
+static const int s_assumedLineLen = 40; // bytes; for the scroll bar page step
+
+static char s_empty = 0; // the data of an empty file; it cannot be mapped
+
+static inline char toLowerAscii( char ch )
+{
+    return ch >= 'A' && ch <= 'Z' ? char( ch - 'A' + 'a' ) : ch;
+}
+
+static QByteArray lowered( const char* data, int len )
+{
+    QByteArray res( data, len );
+    char* p = res.data();
+    for( int i = 0; i < len; i++ )
+        p[i] = toLowerAscii( p[i] );
+    return res;
+}
+
+LargeFileDocument::LargeFileDocument():
+#ifdef Q_OS_UNIX
+    d_fd(-1),
+#endif
+    d_data(0),d_size(0),d_fi(0),d_searchFi(0)
+{
+    setId(Constants::LargeFileEditorId);
+    connect( &d_watcher, SIGNAL(finished()), this, SLOT(onIndexed()) );
+    connect( &d_searchWatcher, SIGNAL(finished()), this, SLOT(onSearched()) );
+}
+
+LargeFileDocument::~LargeFileDocument()
+{
+    stopSearch();
+    stopIndexing();
+    unmap();
+}
+
+bool LargeFileDocument::isLarge(const QString& path)
+{
+    const qint64 threshold = Core::ICore::settings()->value( Constants::LargeFileKey,
+                                                             Constants::LargeFileDefault ).toInt();
+    return threshold > 0 && QFileInfo(path).size() > ( threshold << 20 );
+}
+
+qint64 LargeFileDocument::lineStart(quint32 line) const
+{
+    if( !isIndexed() || line == 0 || line > d_index.d_lineCount )
+        return -1;
+    qint64 pos = d_index.d_marks[ ( line - 1 ) / LineStep ];
+    for( quint32 n = ( line - 1 ) % LineStep; n > 0; n-- )
+        pos = nextLine(pos);
+    return pos;
+}
+
+quint32 LargeFileDocument::lineAt(qint64 off) const
+{
+    if( !isIndexed() )
+        return 0;
+    const QVector<qint64>& marks = d_index.d_marks;
+    const int k = int( std::upper_bound( marks.begin(), marks.end(), off ) - marks.begin() ) - 1;
+    if( k < 0 )
+        return 0;
+    quint32 line = quint32(k) * LineStep + 1;
+    qint64 pos = marks[k];
+    for(;;)
+    {
+        const qint64 next = nextLine(pos);
+        if( next > off || next >= d_size )
+            break;
+        pos = next;
+        line++;
+    }
+    return line;
+}
+
+qint64 LargeFileDocument::startOfLine(qint64 off) const
+{
+    off = qBound( qint64(0), off, d_size );
+    const qint64 limit = qMax( qint64(0), off - s_maxBack );
+    while( off > limit && d_data[off-1] != '\n' )
+        off--;
+    return off;
+}
+
+qint64 LargeFileDocument::nextLine(qint64 off) const
+{
+    if( off >= d_size )
+        return d_size;
+    const char* p = (const char*)::memchr( d_data + off, '\n', d_size - off );
+    return p ? p - d_data + 1 : d_size;
+}
+
+qint64 LargeFileDocument::prevLine(qint64 off) const
+{
+    if( off <= 0 )
+        return 0;
+    return startOfLine( off - 1 );
+}
+
+QByteArray LargeFileDocument::line(qint64 start, int maxLen) const
+{
+    if( start < 0 || start >= d_size )
+        return QByteArray();
+    const qint64 len = qMin( qint64(maxLen), d_size - start );
+    const char* p = (const char*)::memchr( d_data + start, '\n', len );
+    qint64 end = p ? p - d_data : start + len;
+    if( end > start && d_data[end-1] == '\r' )
+        end--;
+    return QByteArray( d_data + start, int( end - start ) );
+}
+
+qint64 LargeFileDocument::find(const QByteArray& pattern, qint64 from, bool backward, bool caseSensitive,
+                               qint64 maxLen, QFutureInterfaceBase* fi) const
+{
+    // chunk by chunk, each searched as a whole; case-insensitive on a lowered copy of the chunk
+    const int n = pattern.size();
+    if( n == 0 || d_size < n )
+        return -1;
+    const QByteArray pat = caseSensitive ? pattern : lowered( pattern.constData(), n );
+    if( backward )
+    {
+        const qint64 limit = maxLen < 0 ? 0 : qMax( qint64(0), from - maxLen );
+        qint64 hi = qMin( from, d_size - n ); // last start in the chunk
+        while( hi >= limit )
+        {
+            const qint64 lo = qMax( limit, hi - s_chunk + 1 );
+            if( ( fi && fi->isCanceled() ) || !isIntact() )
+                return -1;
+            const int len = int( hi - lo + n );
+            const QByteArray chunk = caseSensitive ? QByteArray::fromRawData( d_data + lo, len ) :
+                                                     lowered( d_data + lo, len );
+            const int i = chunk.lastIndexOf( pat );
+            if( i >= 0 )
+                return lo + i;
+            if( fi )
+                fi->setProgressValue( fi->progressValue() + int( ( hi - lo + 1 ) >> 20 ) );
+            hi = lo - 1;
+        }
+        return -1;
+    }
+    QByteArrayMatcher m(pat);
+    qint64 pos = qMax( from, qint64(0) );
+    const qint64 end = maxLen < 0 ? d_size : qMin( d_size, pos + maxLen + n - 1 );
+    while( pos + n <= end )
+    {
+        if( ( fi && fi->isCanceled() ) || !isIntact() )
+            return -1;
+        const int len = int( qMin( s_chunk + n - 1, end - pos ) );
+        const int i = caseSensitive ? m.indexIn( d_data + pos, len ) :
+                                      m.indexIn( lowered( d_data + pos, len ) );
+        if( i >= 0 )
+            return pos + i;
+        if( fi )
+            fi->setProgressValue( fi->progressValue() + int( ( len - n + 1 ) >> 20 ) );
+        pos += len - n + 1;
+    }
+    return -1;
+}
+
+bool LargeFileDocument::checkSize()
+{
+    if( isIntact() )
+        return true;
+    load( 0, filePath().toString() );
+    emit sigReloaded();
+    return false;
+}
+
+void LargeFileDocument::startSearch(const QByteArray& pattern, qint64 from, bool backward, bool caseSensitive)
+{
+    stopSearch();
+    d_searchFi = new QFutureInterface<void>();
+    d_searchFi->reportStarted();
+    Core::ProgressManager::addTask( d_searchFi->future(), tr("Searching %1").arg(filePath().fileName()),
+                                    Constants::LargeFileSearchTaskId );
+    d_searchWatcher.setFuture( QtConcurrent::run( this, &LargeFileDocument::search, pattern, from, backward,
+                                                  caseSensitive, static_cast<QFutureInterfaceBase*>(d_searchFi) ) );
+}
+
+void LargeFileDocument::stopSearch()
+{
+    d_found = Hit();
+    if( d_searchFi == 0 )
+        return;
+    d_searchFi->cancel();
+    d_searchWatcher.waitForFinished(); // the worker reads the mapping
+    d_searchFi->reportFinished();
+    delete d_searchFi;
+    d_searchFi = 0;
+}
+
+Core::IDocument::OpenResult LargeFileDocument::open(QString* errorString, const QString& fileName,
+                                                    const QString& realFileName)
+{
+    if( !load( errorString, realFileName ) )
+        return OpenResult::ReadError;
+    setFilePath( Utils::FileName::fromString(fileName) );
+    setMimeType( Utils::MimeDatabase().mimeTypeForFile(fileName).name() );
+    emit sigReloaded();
+    return OpenResult::Success;
+}
+
+bool LargeFileDocument::save(QString* errorString, const QString& fileName, bool autoSave)
+{
+    Q_UNUSED(fileName);
+    Q_UNUSED(autoSave);
+    if( errorString )
+        *errorString = tr("The large file viewer is read-only");
+    return false;
+}
+
+QString LargeFileDocument::defaultPath() const
+{
+    return filePath().toFileInfo().absolutePath();
+}
+
+QString LargeFileDocument::suggestedFileName() const
+{
+    return filePath().fileName();
+}
+
+Core::IDocument::ReloadBehavior LargeFileDocument::reloadBehavior(ChangeTrigger state, ChangeType type) const
+{
+    Q_UNUSED(state);
+    Q_UNUSED(type);
+    return BehaviorSilent; // nothing to lose
+}
+
+bool LargeFileDocument::reload(QString* errorString, ReloadFlag flag, ChangeType type)
+{
+    if( flag == FlagIgnore || type == TypePermissions )
+        return true;
+    const bool ok = load( errorString, filePath().toString() );
+    emit sigReloaded();
+    return ok;
+}
+
+void LargeFileDocument::onIndexed()
+{
+    if( d_fi == 0 )
+        return;
+    const bool canceled = d_fi->isCanceled();
+    d_fi->reportFinished();
+    delete d_fi;
+    d_fi = 0;
+    if( canceled )
+        return;
+    const Index idx = d_watcher.result();
+    if( idx.d_lineCount == 0 )
+    {
+        // the file was truncated while indexing
+        load( 0, filePath().toString() );
+        emit sigReloaded();
+        return;
+    }
+    d_index = idx;
+    emit sigIndexed();
+}
+
+void LargeFileDocument::onSearched()
+{
+    if( d_searchFi == 0 )
+        return;
+    const bool canceled = d_searchFi->isCanceled();
+    d_searchFi->reportFinished();
+    delete d_searchFi;
+    d_searchFi = 0;
+    if( !canceled && checkSize() )
+        d_found = d_searchWatcher.result();
+}
+
+LargeFileDocument::Index LargeFileDocument::buildIndex(QFutureInterfaceBase* fi) const
+{
+    Index idx;
+    idx.d_marks.reserve( int( d_size / ( s_assumedLineLen * LineStep ) ) + 1 );
+    idx.d_marks.append(0);
+    fi->setProgressRange( 0, int( d_size >> 20 ) );
+    quint32 line = 1;
+    qint64 pos = 0;
+    while( pos < d_size )
+    {
+        if( fi->isCanceled() || !isIntact() )
+            return Index();
+        const qint64 end = qMin( d_size, pos + s_chunk );
+        while( pos < end )
+        {
+            const char* p = (const char*)::memchr( d_data + pos, '\n', end - pos );
+            if( p == 0 )
+            {
+                pos = end;
+                break;
+            }
+            pos = p - d_data + 1;
+            // a line end at the end of the file starts no further line
+            if( ( line++ % LineStep ) == 0 && pos < d_size )
+                idx.d_marks.append(pos);
+        }
+        fi->setProgressValue( int( pos >> 20 ) );
+    }
+    idx.d_lineCount = d_size > 0 && d_data[d_size-1] == '\n' ? line - 1 : line;
+    return idx;
+}
+
+LargeFileDocument::Hit LargeFileDocument::search(const QByteArray& pattern, qint64 from, bool backward,
+                                                 bool caseSensitive, QFutureInterfaceBase* fi) const
+{
+    fi->setProgressRange( 0, int( d_size >> 20 ) );
+    Hit hit;
+    hit.d_pos = find( pattern, from, backward, caseSensitive, -1, fi );
+    if( hit.d_pos >= 0 || fi->isCanceled() )
+        return hit;
+    // wrap around to the part not yet searched
+    if( backward && from + 1 < d_size )
+        hit.d_pos = find( pattern, d_size, true, caseSensitive, d_size - from - 1, fi );
+    else if( !backward && from > 0 )
+        hit.d_pos = find( pattern, 0, false, caseSensitive, from, fi );
+    hit.d_wrapped = hit.d_pos >= 0;
+    return hit;
+}
+
+bool LargeFileDocument::isIntact() const
+{
+#ifdef Q_OS_UNIX
+    // the descriptor refers to the mapped file even if it was replaced in the meantime
+    struct stat st;
+    return d_fd == -1 || ( ::fstat( d_fd, &st ) == 0 && st.st_size >= d_size );
+#else
+    return true; // Windows doesn't truncate a mapped file
+#endif
+}
+
+bool LargeFileDocument::load(QString* errorString, const QString& path)
+{
+    stopSearch();
+    stopIndexing();
+    unmap();
+    d_index = Index();
+    bool ok = false;
+#ifdef Q_OS_UNIX
+    d_fd = ::open( QFile::encodeName(path).constData(), O_RDONLY );
+    struct stat st;
+    if( d_fd != -1 && ::fstat( d_fd, &st ) == 0 )
+    {
+        d_size = st.st_size;
+        if( d_size == 0 )
+            d_data = &s_empty;
+        else
+        {
+            void* p = ::mmap( 0, d_size, PROT_READ, MAP_PRIVATE, d_fd, 0 );
+            if( p != MAP_FAILED )
+                d_data = (const char*)p;
+        }
+        ok = d_data != 0;
+    }
+#else
+    d_file.setFileName(path);
+    if( d_file.open(QIODevice::ReadOnly) )
+    {
+        d_size = d_file.size();
+        d_data = d_size == 0 ? &s_empty : (const char*)d_file.map( 0, d_size );
+        ok = d_data != 0;
+    }
+#endif
+    if( !ok )
+    {
+        unmap();
+        if( errorString )
+            *errorString = tr("Cannot read %1").arg(path);
+        return false;
+    }
+    d_fi = new QFutureInterface<void>();
+    d_fi->reportStarted();
+    Core::ProgressManager::addTask( d_fi->future(), tr("Indexing lines of %1").arg(QFileInfo(path).fileName()),
+                                    Constants::LineIndexTaskId );
+    d_watcher.setFuture( QtConcurrent::run( this, &LargeFileDocument::buildIndex,
+                                            static_cast<QFutureInterfaceBase*>(d_fi) ) );
+    return true;
+}
+
+void LargeFileDocument::unmap()
+{
+#ifdef Q_OS_UNIX
+    if( d_data != 0 && d_data != &s_empty )
+        ::munmap( (void*)d_data, d_size );
+    if( d_fd != -1 )
+        ::close(d_fd);
+    d_fd = -1;
+#else
+    if( d_data != 0 && d_data != &s_empty )
+        d_file.unmap( (uchar*)d_data );
+    d_file.close();
+#endif
+    d_data = 0;
+    d_size = 0;
+}
+
+void LargeFileDocument::stopIndexing()
+{
+    if( d_fi == 0 )
+        return;
+    d_fi->cancel();
+    d_watcher.waitForFinished(); // the worker reads the mapping
+    d_fi->reportFinished();
+    delete d_fi;
+    d_fi = 0;
+}
+
+LargeFileView::LargeFileView(LargeFileDocument* doc):d_doc(doc),d_top(0),d_cur(-1),d_hit(-1),d_hitLen(0),
+    d_shift(0),d_left(0),d_sdf(false)
+{
+    setFont( TextEditor::TextEditorSettings::fontSettings().font() );
+    setFocusPolicy( Qt::StrongFocus );
+    setVerticalScrollBarPolicy( Qt::ScrollBarAlwaysOn );
+
+    // the same colors as the highlighters of the editors
+    d_color[C_Plain] = Qt::black;
+    d_color[C_Num] = QColor(0, 153, 153);
+    d_color[C_Str] = QColor(208, 16, 64);
+    d_color[C_Cmt] = QColor(153, 153, 136);
+    d_color[C_Kw] = QColor(68, 85, 136);
+    d_color[C_Type] = QColor(153, 0, 115);
+    d_color[C_Op] = QColor(153, 0, 0);
+    d_color[C_Pp] = QColor(0, 134, 179);
+
+    connect( verticalScrollBar(), SIGNAL(actionTriggered(int)), this, SLOT(onScrollAction(int)) );
+    connect( verticalScrollBar(), SIGNAL(valueChanged(int)), this, SLOT(onScrolled(int)) );
+    connect( horizontalScrollBar(), SIGNAL(valueChanged(int)), this, SLOT(onScrolled(int)) );
+    connect( doc, SIGNAL(sigReloaded()), this, SLOT(onReloaded()) );
+    connect( doc, SIGNAL(sigIndexed()), viewport(), SLOT(update()) );
+}
+
+void LargeFileView::setCurrent(qint64 off, bool center)
+{
+    d_doc->checkSize();
+    d_cur = d_doc->startOfLine(off);
+    const int lines = visibleLines();
+    qint64 bottom = d_top;
+    for( int i = 1; i < lines; i++ )
+        bottom = d_doc->nextLine(bottom);
+    if( d_cur < d_top || d_cur > bottom )
+    {
+        d_top = d_cur;
+        scrollLines( center ? -lines / 2 : 0 );
+    }
+    updateScrollBars();
+    viewport()->update();
+}
+
+void LargeFileView::showHit(qint64 off, int len)
+{
+    d_hit = off;
+    d_hitLen = len;
+    setCurrent( off, true );
+    const int col = expandTabs( d_doc->line( d_cur, int( off - d_cur ) ) ).size();
+    const int cols = ( viewport()->width() - gutterWidth() ) / qMax( 1, fontMetrics().width(QLatin1Char('x')) );
+    if( col < d_left || col + len > d_left + cols )
+        horizontalScrollBar()->setValue( qMax( 0, col - cols / 2 ) );
+}
+
+void LargeFileView::clearHit()
+{
+    d_hit = -1;
+    viewport()->update();
+}
+
+void LargeFileView::paintEvent(QPaintEvent*)
+{
+    // a truncated file is reloaded here and onReloaded moves d_top into it; a truncation between this check
+    // and the reads below remains possible but needs a rewrite in the same instant
+    d_doc->checkSize();
+    QPainter p( viewport() );
+    const QRect r = viewport()->rect();
+    p.fillRect( r, Qt::white );
+    const QFontMetrics fm = fontMetrics();
+    const int lh = fm.height();
+    const int cw = fm.width(QLatin1Char('x'));
+    const int gw = gutterWidth();
+    const int x0 = gw + s_margin - d_left * cw;
+    QFont bold = font();
+    bold.setBold(true);
+    p.fillRect( QRect( 0, 0, gw, r.height() ), QColor(240, 240, 240) );
+
+    quint32 nr = d_doc->lineAt( d_top );
+    qint64 off = d_top;
+    for( int y = 0; y < r.height() && off < d_doc->size(); y += lh )
+    {
+        const QByteArray bytes = d_doc->line( off, s_maxLineLen );
+        p.setClipping(false);
+        if( nr != 0 )
+        {
+            p.setFont( font() );
+            p.setPen( Qt::gray );
+            p.drawText( QRect( 0, y, gw - s_margin, lh ), Qt::AlignRight | Qt::AlignVCenter, QString::number(nr++) );
+        }
+        p.setClipRect( QRect( gw, 0, r.width() - gw, r.height() ) );
+        if( off == d_cur )
+            p.fillRect( QRect( gw, y, r.width() - gw, lh ), QColor(232, 232, 255) );
+        if( d_hit >= off && d_hit < off + bytes.size() )
+        {
+            const int col = int( d_hit - off );
+            const int start = expandTabs( bytes.left(col) ).size();
+            const int end = expandTabs( bytes.left( col + d_hitLen ) ).size();
+            p.fillRect( QRect( x0 + start * cw, y, ( end - start ) * cw, lh ), QColor(255, 239, 11) );
+        }
+
+        const QString text = expandTabs( bytes );
+        const int base = y + fm.ascent();
+        int col = 0;
+        foreach( const Span& s, highlight(text) )
+        {
+            if( s.d_col < col )
+                continue;
+            if( s.d_col > col )
+            {
+                p.setFont( font() );
+                p.setPen( d_color[C_Plain] );
+                p.drawText( x0 + col * cw, base, text.mid( col, s.d_col - col ) );
+            }
+            p.setFont( s.d_cat == C_Kw || s.d_cat == C_Type || s.d_cat == C_Op || s.d_cat == C_Pp ? bold : font() );
+            p.setPen( d_color[s.d_cat] );
+            p.drawText( x0 + s.d_col * cw, base, text.mid( s.d_col, s.d_len ) );
+            col = s.d_col + s.d_len;
+        }
+        if( col < text.size() )
+        {
+            p.setFont( font() );
+            p.setPen( d_color[C_Plain] );
+            p.drawText( x0 + col * cw, base, text.mid( col ) );
+        }
+        off = d_doc->nextLine( off );
+    }
+}
+
+void LargeFileView::resizeEvent(QResizeEvent* e)
+{
+    QAbstractScrollArea::resizeEvent(e);
+    updateScrollBars();
+}
+
+void LargeFileView::wheelEvent(QWheelEvent* e)
+{
+    if( e->orientation() == Qt::Horizontal )
+    {
+        QAbstractScrollArea::wheelEvent(e);
+        return;
+    }
+    scrollLines( -e->delta() / 40 ); // three lines per notch
+    verticalScrollBar()->setValue( int( d_top >> d_shift ) );
+    e->accept();
+}
+
+void LargeFileView::keyPressEvent(QKeyEvent* e)
+{
+    const int page = qMax( 1, visibleLines() - 1 );
+    switch( e->key() )
+    {
+    case Qt::Key_Up:
+        scrollLines(-1);
+        break;
+    case Qt::Key_Down:
+        scrollLines(1);
+        break;
+    case Qt::Key_PageUp:
+        scrollLines(-page);
+        break;
+    case Qt::Key_PageDown:
+        scrollLines(page);
+        break;
+    case Qt::Key_Home:
+        if( e->modifiers() & Qt::ControlModifier )
+            setTop(0);
+        horizontalScrollBar()->setValue(0);
+        break;
+    case Qt::Key_End:
+        if( e->modifiers() & Qt::ControlModifier )
+        {
+            setTop( d_doc->size() );
+            scrollLines(-page);
+        }
+        break;
+    case Qt::Key_Left:
+        horizontalScrollBar()->triggerAction(QAbstractSlider::SliderSingleStepSub);
+        break;
+    case Qt::Key_Right:
+        horizontalScrollBar()->triggerAction(QAbstractSlider::SliderSingleStepAdd);
+        break;
+    default:
+        QAbstractScrollArea::keyPressEvent(e);
+        return;
+    }
+    verticalScrollBar()->setValue( int( d_top >> d_shift ) );
+    e->accept();
+}
+
+void LargeFileView::mousePressEvent(QMouseEvent* e)
+{
+    d_doc->checkSize();
+    qint64 off = d_top;
+    for( int n = e->pos().y() / fontMetrics().height(); n > 0 && off < d_doc->size(); n-- )
+        off = d_doc->nextLine(off);
+    if( off < d_doc->size() )
+        d_cur = off;
+    viewport()->update();
+    QAbstractScrollArea::mousePressEvent(e);
+}
+
+void LargeFileView::onScrollAction(int action)
+{
+    const int page = qMax( 1, visibleLines() - 1 );
+    switch( action )
+    {
+    case QAbstractSlider::SliderSingleStepAdd:
+        scrollLines(1);
+        break;
+    case QAbstractSlider::SliderSingleStepSub:
+        scrollLines(-1);
+        break;
+    case QAbstractSlider::SliderPageStepAdd:
+        scrollLines(page);
+        break;
+    case QAbstractSlider::SliderPageStepSub:
+        scrollLines(-page);
+        break;
+    default:
+        return; // moves of the slider arrive in onScrolled
+    }
+    verticalScrollBar()->setSliderPosition( int( d_top >> d_shift ) );
+}
+
+void LargeFileView::onScrolled(int)
+{
+    d_doc->checkSize();
+    d_left = horizontalScrollBar()->value();
+    const int v = verticalScrollBar()->value();
+    if( ( d_top >> d_shift ) != v )
+    {
+        if( v == verticalScrollBar()->maximum() )
+        {
+            // show the last page instead of only the last line
+            d_top = d_doc->size();
+            scrollLines( -qMax( 1, visibleLines() - 1 ) );
+        }else
+            d_top = d_doc->startOfLine( qint64(v) << d_shift );
+    }
+    viewport()->update();
+}
+
+void LargeFileView::onReloaded()
+{
+    d_sdf = d_doc->mimeType() == QLatin1String(Constants::SdfMimeType);
+    d_top = d_doc->startOfLine( d_top );
+    d_cur = -1;
+    d_hit = -1;
+    updateScrollBars();
+    viewport()->update();
+}
+
+QList<LargeFileView::Span> LargeFileView::highlight(const QString& text) const
+{
+    QList<Span> res;
+    if( d_sdf )
+    {
+        Sdf::Lexer lex;
+        lex.setIgnoreComments(false);
+        lex.setPackComments(false);
+        foreach( const Sdf::Token& t, lex.tokens(text) )
+        {
+            Span s;
+            s.d_col = t.d_colNr - 1;
+            s.d_len = t.d_len;
+            if( t.d_type == Sdf::Tok_Comment || t.d_type == Sdf::Tok_Lcmt || t.d_type == Sdf::Tok_Rcmt )
+                s.d_cat = C_Cmt;
+            else if( t.d_type == Sdf::Tok_Str )
+                s.d_cat = C_Str;
+            else if( t.d_type == Sdf::Tok_Int || t.d_type == Sdf::Tok_Real )
+                s.d_cat = C_Num;
+            else if( Sdf::tokenTypeIsLiteral(t.d_type) )
+                s.d_cat = C_Op;
+            else if( Sdf::tokenTypeIsKeyword(t.d_type) )
+                s.d_cat = C_Kw;
+            else
+                continue;
+            res.append(s);
+        }
+        return res;
+    }
+    // each line on its own; a line within a multi line comment is only recognized as such by its delimiters
+    PpLexer lex;
+    lex.setIgnoreAttrs(false);
+    lex.setPackAttrs(false);
+    lex.setIgnoreComments(false);
+    lex.setPackComments(false);
+    foreach( const Token& t, lex.tokens(text) )
+    {
+        if( t.d_substituted )
+            continue;
+        Span s;
+        s.d_col = t.d_colNr - 1;
+        s.d_len = t.d_len;
+        if( t.d_type == Tok_Comment || t.d_type == Tok_Lcmt || t.d_type == Tok_Rcmt )
+            s.d_cat = C_Cmt;
+        else if( t.d_type == Tok_Str )
+            s.d_cat = C_Str;
+        else if( tokenIsNumber(t.d_type) )
+            s.d_cat = C_Num;
+        else if( tokenIsDelimiter(t.d_type) )
+            s.d_cat = t.d_type == Tok_LineCont ? C_Pp : C_Op;
+        else if( tokenIsReservedWord(t.d_type) )
+            s.d_cat = tokenIsType(t.d_type) ? C_Type : C_Kw;
+        else if( t.d_type == Tok_SysName )
+            s.d_cat = C_Kw;
+        else if( t.d_type == Tok_CoDi )
+            s.d_cat = C_Pp;
+        else
+            continue;
+        res.append(s);
+    }
+    return res;
+}
+
+QString LargeFileView::expandTabs(const QByteArray& bytes)
+{
+    QString res;
+    res.reserve( bytes.size() );
+    for( int i = 0; i < bytes.size(); i++ )
+    {
+        if( bytes[i] == '\t' )
+            res += QString( s_tabWidth - res.size() % s_tabWidth, QLatin1Char(' ') );
+        else
+            res += QLatin1Char( bytes[i] );
+    }
+    return res;
+}
+
+void LargeFileView::scrollLines(int n)
+{
+    d_doc->checkSize();
+    qint64 top = d_top;
+    for( ; n > 0; n-- )
+    {
+        const qint64 next = d_doc->nextLine(top);
+        if( next >= d_doc->size() )
+            break;
+        top = next;
+    }
+    for( ; n < 0 && top > 0; n++ )
+        top = d_doc->prevLine(top);
+    d_top = top;
+    viewport()->update();
+}
+
+void LargeFileView::setTop(qint64 off)
+{
+    d_doc->checkSize();
+    d_top = d_doc->startOfLine(off);
+    viewport()->update();
+}
+
+void LargeFileView::updateScrollBars()
+{
+    d_shift = 0;
+    while( ( d_doc->size() >> d_shift ) > INT_MAX / 2 )
+        d_shift++;
+    QScrollBar* v = verticalScrollBar();
+    v->setRange( 0, int( d_doc->size() >> d_shift ) );
+    v->setPageStep( qMax( 1, int( ( qint64(visibleLines()) * s_assumedLineLen ) >> d_shift ) ) );
+    v->setValue( int( d_top >> d_shift ) );
+    const int cw = qMax( 1, fontMetrics().width(QLatin1Char('x')) );
+    const int cols = ( viewport()->width() - gutterWidth() ) / cw;
+    QScrollBar* h = horizontalScrollBar();
+    h->setRange( 0, qMax( 0, s_maxLineLen - cols ) );
+    h->setPageStep( qMax( 1, cols ) );
+}
+
+int LargeFileView::visibleLines() const
+{
+    return qMax( 1, viewport()->height() / fontMetrics().height() );
+}
+
+int LargeFileView::gutterWidth() const
+{
+    const int digits = d_doc->isIndexed() ? QString::number( d_doc->lineCount() ).size() : 0;
+    return digits == 0 ? s_margin : fontMetrics().width( QString( digits, QLatin1Char('9') ) ) + 2 * s_margin;
+}
+
+LargeFileFind::LargeFileFind(LargeFileView* view):d_view(view),d_incrementalStart(-1)
+{
+
+}
+
+Core::FindFlags LargeFileFind::supportedFindFlags() const
+{
+    return Core::FindBackward | Core::FindCaseSensitively;
+}
+
+void LargeFileFind::resetIncrementalSearch()
+{
+    d_incrementalStart = -1;
+}
+
+void LargeFileFind::clearHighlights()
+{
+    if( d_view )
+        d_view->clearHit();
+}
+
+Core::IFindSupport::Result LargeFileFind::findIncremental(const QString& txt, Core::FindFlags findFlags)
+{
+    if( d_view == 0 )
+        return NotFound;
+    if( d_incrementalStart < 0 )
+        d_incrementalStart = qMax( d_view->getCurrent(), d_view->getTop() );
+    // only a limited range while typing; the whole file is searched by findStep
+    return find( txt, findFlags & ~Core::FindBackward, d_incrementalStart, s_incrementalRange );
+}
+
+Core::IFindSupport::Result LargeFileFind::findStep(const QString& txt, Core::FindFlags findFlags)
+{
+    if( d_view == 0 )
+        return NotFound;
+    LargeFileDocument* doc = d_view->getDocument();
+    const QByteArray pattern = txt.toLatin1();
+    const Core::FindFlags flags = findFlags & supportedFindFlags();
+    if( !d_stepPattern.isEmpty() )
+    {
+        if( pattern == d_stepPattern && flags == d_stepFlags )
+        {
+            // the find tool bar calls again while NotYetFound is returned
+            if( doc->isSearching() )
+                return NotYetFound;
+            d_stepPattern.clear();
+            const LargeFileDocument::Hit hit = doc->getSearchResult();
+            if( hit.d_pos < 0 )
+            {
+                d_view->clearHit();
+                return NotFound;
+            }
+            if( hit.d_wrapped )
+                showWrapIndicator( d_view );
+            d_view->showHit( hit.d_pos, pattern.size() );
+            d_incrementalStart = hit.d_pos;
+            return Found;
+        }
+        doc->stopSearch(); // the search text or the direction changed
+        d_stepPattern.clear();
+    }
+    if( pattern.isEmpty() )
+    {
+        d_view->clearHit();
+        return NotFound;
+    }
+    doc->checkSize();
+    // continue next to the last hit, otherwise at the current line
+    const qint64 hit = d_view->getHit();
+    const qint64 cur = hit >= 0 ? hit : qMax( d_view->getCurrent(), d_view->getTop() );
+    qint64 from = cur;
+    if( flags & Core::FindBackward )
+        from = cur - 1;
+    else if( hit >= 0 )
+        from = cur + 1;
+    doc->startSearch( pattern, from, flags & Core::FindBackward, flags & Core::FindCaseSensitively );
+    d_stepPattern = pattern;
+    d_stepFlags = flags;
+    return NotYetFound;
+}
+
+Core::IFindSupport::Result LargeFileFind::find(const QString& txt, Core::FindFlags flags, qint64 from, qint64 limit)
+{
+    const QByteArray pattern = txt.toLatin1();
+    if( pattern.isEmpty() )
+    {
+        d_view->clearHit();
+        return NotFound;
+    }
+    LargeFileDocument* doc = d_view->getDocument();
+    doc->checkSize();
+    QApplication::setOverrideCursor(Qt::WaitCursor);
+    const qint64 pos = doc->find( pattern, from, flags & Core::FindBackward, flags & Core::FindCaseSensitively,
+                                  limit );
+    QApplication::restoreOverrideCursor();
+    if( pos < 0 )
+    {
+        // not NotYetFound, the find tool bar would repeat the same search every 50 ms
+        d_view->clearHit();
+        return NotFound;
+    }
+    d_view->showHit( pos, pattern.size() );
+    return Found;
+}
+
+LargeFileEditor::LargeFileEditor():d_toolBar(0),d_status(0),d_pendingLine(0)
+{
+    d_doc = new LargeFileDocument();
+    d_view = new LargeFileView(d_doc);
+    // the find tool bar looks for an IFindSupport in the aggregate of the focus widget
+    Aggregation::Aggregate* agg = new Aggregation::Aggregate();
+    agg->add( d_view );
+    agg->add( new LargeFileFind(d_view) );
+    setWidget( d_view );
+    setContext( Core::Context(Constants::LargeFileEditorId) );
+    connect( d_doc, SIGNAL(sigIndexed()), this, SLOT(onIndexed()) );
+    connect( d_doc, SIGNAL(sigReloaded()), this, SLOT(updateStatus()) );
+}
+
+LargeFileEditor::~LargeFileEditor()
+{
+    delete d_toolBar;
+    delete d_view; // and with it the aggregate
+    delete d_doc;
+}
+
+QByteArray LargeFileEditor::saveState() const
+{
+    return QByteArray::number( qMax( d_view->getCurrent(), d_view->getTop() ) );
+}
+
+bool LargeFileEditor::restoreState(const QByteArray& state)
+{
+    bool ok;
+    const qint64 off = state.toLongLong(&ok);
+    if( ok && off < d_doc->size() )
+        d_view->setCurrent( off, false );
+    return ok;
+}
+
+int LargeFileEditor::currentLine() const
+{
+    d_doc->checkSize();
+    return d_doc->lineAt( qMax( d_view->getCurrent(), d_view->getTop() ) );
+}
+
+void LargeFileEditor::gotoLine(int line, int column, bool centerLine)
+{
+    Q_UNUSED(column);
+    d_doc->checkSize(); // a reload restarts the index
+    if( !d_doc->isIndexed() )
+    {
+        d_pendingLine = line;
+        return;
+    }
+    const qint64 off = d_doc->lineStart( line );
+    if( off >= 0 )
+        d_view->setCurrent( off, centerLine );
+}
+
+QWidget*LargeFileEditor::toolBar()
+{
+    if( d_toolBar == 0 )
+    {
+        d_toolBar = new QToolBar();
+        d_status = new QLabel(d_toolBar);
+        d_toolBar->addWidget(d_status);
+        updateStatus();
+    }
+    return d_toolBar;
+}
+
+void LargeFileEditor::onIndexed()
+{
+    if( d_pendingLine > 0 )
+        gotoLine( d_pendingLine );
+    d_pendingLine = 0;
+    updateStatus();
+}
+
+void LargeFileEditor::updateStatus()
+{
+    if( d_status == 0 )
+        return;
+    const QString mb = QString::number( double( d_doc->size() ) / 1024.0 / 1024.0, 'f', 1 );
+    if( d_doc->isIndexed() )
+        d_status->setText( tr("%1 MB, %2 lines, read-only").arg(mb).arg(d_doc->lineCount()) );
+    else
+        d_status->setText( tr("%1 MB, counting lines..., read-only").arg(mb) );
+}
+
+LargeFileEditorFactory::LargeFileEditorFactory()
+{
+    setId(Constants::LargeFileEditorId);
+    setDisplayName(qApp->translate("OpenWith::Editors", Constants::LargeFileDisplayName));
+    addMimeType(Constants::MimeType);
+    addMimeType(Constants::SdfMimeType);
+}
+
+Core::IEditor*LargeFileEditorFactory::createEditor()
+{
+    return new LargeFileEditor();
+}
@@ -0,0 +1,241 @@
+#ifndef VLLARGEFILEVIEWER_H
+#define VLLARGEFILEVIEWER_H
+
+/*
+* Copyright 2019 Rochus Keller <mailto:me@rochus-keller.ch>
+*
+* This file is part of the VerilogCreator plugin.
+*
+* The following is the license that applies to this copy of the
+* plugin. For a license to use the plugin under conditions
+* other than those described here, please email to me@rochus-keller.ch.
+*
+* GNU General Public License Usage
+* This file may be used under the terms of the GNU General Public
+* License (GPL) versions 2.0 or 3.0 as published by the Free Software
+* Foundation and appearing in the file LICENSE.GPL included in
+* the packaging of this file. Please review the following information
+* to ensure GNU General Public Licensing requirements will be met:
+* http://www.fsf.org/licensing/licenses/info/GPLv2.html and
+* http://www.gnu.org/copyleft/gpl.html.
+*/
+
+#include <coreplugin/editormanager/ieditor.h>
+#include <coreplugin/editormanager/ieditorfactory.h>
+#include <coreplugin/find/ifindsupport.h>
+#include <coreplugin/idocument.h>
+#include <QAbstractScrollArea>
+#include <QFutureWatcher>
+#include <QFile>
+#include <QPointer>
+
+class QLabel;
+class QToolBar;
+
+namespace Vl
+{
+    // Read-only access to a file too large for the text editors, e.g. a gate-level netlist or an SDF file of
+    // several GB. The document maps the file itself, privately and only while it is open; a sparse index with
+    // the offset of every LineStep'th line is built in the background and maps between line numbers and
+    // offsets. Until it is complete the file can already be viewed, only line numbers are not yet known.
+    // Reading a mapping beyond the end of a truncated file is fatal; the size is therefore checked before
+    // each painted page and each chunk of the background jobs, and a shrunk file is reloaded.
+    class LargeFileDocument : public Core::IDocument
+    {
+        Q_OBJECT
+    public:
+        enum { LineStep = 256 };
+        struct Index
+        {
+            QVector<qint64> d_marks; // offset of line 1, 1 + LineStep, 1 + 2 * LineStep, ...
+            quint32 d_lineCount;
+            Index():d_lineCount(0){}
+        };
+        struct Hit
+        {
+            qint64 d_pos; // -1 if not found
+            bool d_wrapped;
+            Hit():d_pos(-1),d_wrapped(false){}
+        };
+
+        LargeFileDocument();
+        ~LargeFileDocument();
+
+        static bool isLarge( const QString& path ); // above the threshold in the settings
+
+        qint64 size() const { return d_size; }
+        bool isIndexed() const { return d_index.d_lineCount != 0; }
+        quint32 lineCount() const { return d_index.d_lineCount; } // 0 until indexed
+        qint64 lineStart( quint32 line ) const; // 1-based; -1 if not indexed or out of range
+        quint32 lineAt( qint64 off ) const; // 1-based line containing the offset; 0 if not indexed
+        qint64 startOfLine( qint64 off ) const;
+        qint64 nextLine( qint64 off ) const; // start of the line after the one containing off; size() if none
+        qint64 prevLine( qint64 off ) const;
+        QByteArray line( qint64 start, int maxLen ) const; // without line end
+        // offset of the next match starting at or before/after from; -1 if none; maxLen < 0 searches to the end
+        qint64 find( const QByteArray& pattern, qint64 from, bool backward, bool caseSensitive,
+                     qint64 maxLen = -1, QFutureInterfaceBase* = 0 ) const;
+        // false if the file was truncated; it is reloaded then
+        bool checkSize();
+        // searches the whole file in the background, wrapping around; the result is ready when isSearching is false
+        void startSearch( const QByteArray& pattern, qint64 from, bool backward, bool caseSensitive );
+        void stopSearch();
+        bool isSearching() const { return d_searchFi != 0; }
+        Hit getSearchResult() const { return d_found; } // of the last completed search
+
+        // overrides
+        OpenResult open(QString *errorString, const QString &fileName, const QString &realFileName) Q_DECL_OVERRIDE;
+        bool save(QString *errorString, const QString &fileName, bool autoSave) Q_DECL_OVERRIDE;
+        QString defaultPath() const Q_DECL_OVERRIDE;
+        QString suggestedFileName() const Q_DECL_OVERRIDE;
+        bool isModified() const Q_DECL_OVERRIDE { return false; }
+        bool isSaveAsAllowed() const Q_DECL_OVERRIDE { return false; }
+        ReloadBehavior reloadBehavior(ChangeTrigger state, ChangeType type) const Q_DECL_OVERRIDE;
+        bool reload(QString *errorString, ReloadFlag flag, ChangeType type) Q_DECL_OVERRIDE;
+
+    signals:
+        void sigReloaded();
+        void sigIndexed();
+
+    protected slots:
+        void onIndexed();
+        void onSearched();
+    private:
+        // run in a worker; the mapping stays valid until they are finished
+        Index buildIndex( QFutureInterfaceBase* ) const;
+        Hit search( const QByteArray& pattern, qint64 from, bool backward, bool caseSensitive,
+                    QFutureInterfaceBase* ) const;
+        bool isIntact() const;
+        bool load( QString* errorString, const QString& path );
+        void unmap();
+        void stopIndexing();
+#ifdef Q_OS_UNIX
+        int d_fd; // kept open to check the size
+#else
+        QFile d_file; // the mapping is only valid while the file is open
+#endif
+        const char* d_data;
+        qint64 d_size;
+        Index d_index;
+        QFutureInterface<void>* d_fi;
+        QFutureWatcher<Index> d_watcher;
+        QFutureInterface<void>* d_searchFi;
+        QFutureWatcher<Hit> d_searchWatcher;
+        Hit d_found;
+    };
+
+    // Paints only the visible lines and highlights them one by one, so neither the size of the file nor the
+    // number of lines matter. The scroll bar works on byte offsets and thus covers the whole file from the start.
+    class LargeFileView : public QAbstractScrollArea
+    {
+        Q_OBJECT
+    public:
+        explicit LargeFileView( LargeFileDocument* );
+
+        LargeFileDocument* getDocument() const { return d_doc; }
+        qint64 getTop() const { return d_top; }
+        qint64 getCurrent() const { return d_cur; }
+        qint64 getHit() const { return d_hit; }
+        void setCurrent( qint64 off, bool center ); // scrolls the line containing off into view
+        void showHit( qint64 off, int len );
+        void clearHit();
+
+    protected:
+        void paintEvent(QPaintEvent *) Q_DECL_OVERRIDE;
+        void resizeEvent(QResizeEvent *) Q_DECL_OVERRIDE;
+        void wheelEvent(QWheelEvent *) Q_DECL_OVERRIDE;
+        void keyPressEvent(QKeyEvent *) Q_DECL_OVERRIDE;
+        void mousePressEvent(QMouseEvent *) Q_DECL_OVERRIDE;
+
+    protected slots:
+        void onScrollAction(int);
+        void onScrolled(int);
+        void onReloaded();
+    private:
+        enum Category { C_Plain, C_Num, C_Str, C_Kw, C_Type, C_Op, C_Pp, C_Cmt, C_Max };
+        struct Span
+        {
+            int d_col;
+            int d_len;
+            quint8 d_cat;
+        };
+        QList<Span> highlight( const QString& ) const;
+        static QString expandTabs( const QByteArray& );
+        void scrollLines( int );
+        void setTop( qint64 );
+        void updateScrollBars();
+        int visibleLines() const;
+        int gutterWidth() const;
+        LargeFileDocument* d_doc;
+        QColor d_color[C_Max];
+        qint64 d_top;  // start of the first visible line
+        qint64 d_cur;  // start of the current line
+        qint64 d_hit;  // search hit or -1
+        int d_hitLen;
+        int d_shift;   // scroll bar value = offset >> d_shift
+        int d_left;    // horizontal scroll in characters
+        bool d_sdf;
+    };
+
+    // Incremental search covers a limited range in the GUI thread; findStep searches the whole file in the
+    // background and answers NotYetFound until it's done, so the find tool bar polls again.
+    class LargeFileFind : public Core::IFindSupport
+    {
+        Q_OBJECT
+    public:
+        explicit LargeFileFind( LargeFileView* );
+
+        // overrides
+        bool supportsReplace() const Q_DECL_OVERRIDE { return false; }
+        Core::FindFlags supportedFindFlags() const Q_DECL_OVERRIDE;
+        void resetIncrementalSearch() Q_DECL_OVERRIDE;
+        void clearHighlights() Q_DECL_OVERRIDE;
+        QString currentFindString() const Q_DECL_OVERRIDE { return QString(); }
+        QString completedFindString() const Q_DECL_OVERRIDE { return QString(); }
+        Result findIncremental(const QString &txt, Core::FindFlags findFlags) Q_DECL_OVERRIDE;
+        Result findStep(const QString &txt, Core::FindFlags findFlags) Q_DECL_OVERRIDE;
+    private:
+        Result find( const QString &txt, Core::FindFlags, qint64 from, qint64 limit );
+        QPointer<LargeFileView> d_view;
+        qint64 d_incrementalStart;
+        QByteArray d_stepPattern; // of the background search in progress, if any
+        Core::FindFlags d_stepFlags;
+    };
+
+    class LargeFileEditor : public Core::IEditor
+    {
+        Q_OBJECT
+    public:
+        LargeFileEditor();
+        ~LargeFileEditor();
+
+        // overrides
+        Core::IDocument* document() Q_DECL_OVERRIDE { return d_doc; }
+        QByteArray saveState() const Q_DECL_OVERRIDE;
+        bool restoreState(const QByteArray &state) Q_DECL_OVERRIDE;
+        int currentLine() const Q_DECL_OVERRIDE;
+        int currentColumn() const Q_DECL_OVERRIDE { return 0; }
+        void gotoLine(int line, int column = 0, bool centerLine = true) Q_DECL_OVERRIDE;
+        QWidget* toolBar() Q_DECL_OVERRIDE;
+
+    protected slots:
+        void onIndexed();
+        void updateStatus();
+    private:
+        LargeFileDocument* d_doc;
+        LargeFileView* d_view;
+        QToolBar* d_toolBar;
+        QLabel* d_status;
+        int d_pendingLine; // goto line requested before the index was ready
+    };
+
+    class LargeFileEditorFactory : public Core::IEditorFactory
+    {
+        Q_OBJECT
+    public:
+        LargeFileEditorFactory();
+        Core::IEditor* createEditor() Q_DECL_OVERRIDE;
+    };
+}
+
+#endif // VLLARGEFILEVIEWER_H
@@ -0,0 +1,359 @@
+/*
+* Copyright 2019 Rochus Keller <mailto:me@rochus-keller.ch>
+*
+* This file is part of the VerilogCreator plugin.
+*
+* The following is the license that applies to this copy of the
+* plugin. For a license to use the plugin under conditions
+* other than those described here, please email to me@rochus-keller.ch.
+*
+* GNU General Public License Usage
+* This file may be used under the terms of the GNU General Public
+* License (GPL) versions 2.0 or 3.0 as published by the Free Software
+* Foundation and appearing in the file LICENSE.GPL included in
+* the packaging of this file. Please review the following information
+* to ensure GNU General Public Licensing requirements will be met:
+* http://www.fsf.org/licensing/licenses/info/GPLv2.html and
+* http://www.gnu.org/copyleft/gpl.html.
+*/
+
+#include "VlMappedFiles.h"
+#include <QFile>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QVector>
+#include <limits.h>
+#ifdef Q_OS_UNIX
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+using namespace Vl;
+
+// Smaller files are read into memory. A mapped file which is truncated while being read (e.g. regenerated
+// with O_TRUNC) faults with SIGBUS; the copy of a typical source file is cheap compared to that risk, so only
+// large files like netlists are mapped.
+static const qint64 s_mapAbove = 4 * 1024 * 1024;
+
+class MappedFiles::Buffer
+{
+public:
+#ifndef Q_OS_UNIX
+    QFile d_file; // the mapping is only valid while the QFile is open
+#endif
+    QByteArray d_overlay;
+    const char* d_data;
+    qint64 d_size;
+    QDateTime d_modified;
+    QMutex d_lock; // protects d_lines
+    QVector<quint32> d_lines; // start offsets; only built for files below 4 GB
+    bool d_indexed;
+
+    Buffer():d_data(0),d_size(0),d_indexed(false){}
+    ~Buffer()
+    {
+        if( d_data && d_overlay.isNull() )
+#ifdef Q_OS_UNIX
+            ::munmap( (void*)d_data, d_size );
+#else
+            d_file.unmap( (uchar*)d_data );
+#endif
+    }
+    bool map( const QString& path )
+    {
+#ifdef Q_OS_UNIX
+        // a QFile unmaps on close; with mmap the descriptor can be closed right away so that large
+        // projects don't run out of file handles
+        const int fd = ::open( QFile::encodeName(path).constData(), O_RDONLY );
+        if( fd == -1 )
+            return false;
+        struct stat st;
+        if( ::fstat( fd, &st ) != 0 )
+        {
+            ::close(fd);
+            return false;
+        }
+        d_size = st.st_size;
+        if( d_size > s_mapAbove )
+        {
+            void* p = ::mmap( 0, d_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+            if( p != MAP_FAILED )
+                d_data = (const char*)p;
+        }
+        bool ok = true;
+        if( d_data == 0 )
+            ok = copy( fd );
+        ::close(fd);
+        return ok;
+#else
+        d_file.setFileName(path);
+        if( !d_file.open(QIODevice::ReadOnly) )
+            return false;
+        d_size = d_file.size();
+        if( d_size > s_mapAbove )
+            d_data = (const char*)d_file.map( 0, d_size );
+        if( d_data == 0 )
+        {
+            // small, or cannot be mapped (e.g. special file systems); a copy doesn't keep the file open,
+            // which would prevent it from being replaced
+            if( d_size > INT_MAX )
+                return false;
+            d_overlay = d_file.readAll();
+            d_data = d_overlay.constData();
+            d_size = d_overlay.size();
+            d_file.close();
+        }
+        return true;
+#endif
+    }
+#ifdef Q_OS_UNIX
+    bool copy( int fd )
+    {
+        if( d_size > INT_MAX )
+            return false; // a QByteArray cannot hold it
+        d_overlay.resize( d_size );
+        qint64 done = 0;
+        while( done < d_size )
+        {
+            // pread takes what is there if the file shrinks meanwhile
+            const ssize_t n = ::pread( fd, d_overlay.data() + done, d_size - done, done );
+            if( n <= 0 )
+                break;
+            done += n;
+        }
+        d_overlay.resize( done );
+        d_data = d_overlay.constData();
+        d_size = d_overlay.size();
+        return true;
+    }
+#endif
+    void index()
+    {
+        // d_lock held
+        if( d_indexed )
+            return;
+        d_indexed = true;
+        if( d_size >= Q_INT64_C(0xffffffff) )
+            return;
+        int count = 1;
+        for( qint64 i = 0; i < d_size; i++ )
+            if( d_data[i] == '\n' )
+                count++;
+        d_lines.reserve(count);
+        d_lines.append(0);
+        for( qint64 i = 0; i < d_size; i++ )
+            if( d_data[i] == '\n' )
+                d_lines.append( i + 1 );
+    }
+    qint64 resident() const
+    {
+        if( !d_overlay.isNull() || d_data == 0 )
+            return 0;
+#ifdef Q_OS_UNIX
+        const long page = ::sysconf(_SC_PAGESIZE);
+        const quintptr start = quintptr(d_data) & ~quintptr(page - 1);
+        const qint64 len = quintptr(d_data) + d_size - start;
+        const qint64 pages = ( len + page - 1 ) / page;
+#ifdef Q_OS_MAC
+        QVector<char> vec(pages);
+#else
+        QVector<unsigned char> vec(pages);
+#endif
+        if( ::mincore( (void*)start, len, vec.data() ) != 0 )
+            return d_size;
+        qint64 res = 0;
+        for( int i = 0; i < vec.size(); i++ )
+            if( vec[i] & 1 )
+                res += page;
+        return qMin( res, d_size );
+#else
+        return d_size;
+#endif
+    }
+};
+
+QByteArray MappedFiles::Text::bytes() const
+{
+    if( d_buf.isNull() )
+        return QByteArray();
+    if( !d_buf->d_overlay.isNull() )
+        return d_buf->d_overlay;
+    return QByteArray::fromRawData( d_buf->d_data, d_buf->d_size );
+}
+
+const char*MappedFiles::Text::data() const
+{
+    return d_buf.isNull() ? 0 : d_buf->d_data;
+}
+
+qint64 MappedFiles::Text::size() const
+{
+    return d_buf.isNull() ? 0 : d_buf->d_size;
+}
+
+QByteArray MappedFiles::Text::line(quint32 nr) const
+{
+    if( d_buf.isNull() || nr == 0 )
+        return QByteArray();
+    const char* data = d_buf->d_data;
+    const qint64 size = d_buf->d_size;
+    qint64 start = -1;
+    {
+        QMutexLocker lock( &d_buf->d_lock );
+        d_buf->index();
+        if( !d_buf->d_lines.isEmpty() )
+        {
+            if( int(nr) > d_buf->d_lines.size() )
+                return QByteArray();
+            start = d_buf->d_lines[nr-1];
+        }
+    }
+    if( start == -1 )
+    {
+        // too large for the table; scan
+        quint32 l = 1;
+        start = 0;
+        while( l < nr && start < size )
+        {
+            if( data[start++] == '\n' )
+                l++;
+        }
+        if( l != nr )
+            return QByteArray();
+    }
+    qint64 end = start;
+    while( end < size && data[end] != '\n' )
+        end++;
+    if( end > start && data[end-1] == '\r' )
+        end--;
+    return QByteArray( data + start, end - start );
+}
+
+int MappedFiles::Text::lineCount() const
+{
+    if( d_buf.isNull() )
+        return 0;
+    QMutexLocker lock( &d_buf->d_lock );
+    d_buf->index();
+    return d_buf->d_lines.size();
+}
+
+MappedFiles::MappedFiles():d_prune(64)
+{
+}
+
+MappedFiles::~MappedFiles()
+{
+}
+
+MappedFiles::Text MappedFiles::getText(const QString& path)
+{
+    Text res;
+    QMutexLocker lock(&d_lock);
+    res.d_buf = d_overlays.value(path);
+    if( !res.d_buf.isNull() )
+        return res;
+
+    const QFileInfo info(path);
+    QHash<QString,QWeakPointer<Buffer> >::iterator i = d_files.find(path);
+    if( i != d_files.end() )
+    {
+        // only reused while some reader still holds it and the file is unchanged; a mapping doesn't
+        // outlive its readers
+        QSharedPointer<Buffer> buf = i.value().toStrongRef();
+        if( !buf.isNull() && buf->d_size == info.size() && buf->d_modified == info.lastModified() )
+        {
+            res.d_buf = buf;
+            return res;
+        }
+        d_files.erase(i);
+    }
+    // (re)map; readers of the old mapping keep it alive until they are done
+    QSharedPointer<Buffer> b( new Buffer() );
+    b->d_modified = info.lastModified();
+    if( !b->map(path) )
+        return res;
+    if( d_files.size() >= d_prune )
+    {
+        QHash<QString,QWeakPointer<Buffer> >::iterator j = d_files.begin();
+        while( j != d_files.end() )
+        {
+            if( j.value().isNull() )
+                j = d_files.erase(j);
+            else
+                ++j;
+        }
+        d_prune = 2 * d_files.size() + 64;
+    }
+    d_files.insert( path, b );
+    res.d_buf = b;
+    return res;
+}
+
+void MappedFiles::setOverlay(const QString& path, const QByteArray& text)
+{
+    QSharedPointer<Buffer> b( new Buffer() );
+    b->d_overlay = text; // shared with the caller, no copy
+    if( b->d_overlay.isNull() )
+        b->d_overlay = QByteArray("");
+    b->d_data = b->d_overlay.constData();
+    b->d_size = b->d_overlay.size();
+    QMutexLocker lock(&d_lock);
+    d_overlays[path] = b;
+}
+
+void MappedFiles::removeOverlay(const QString& path)
+{
+    QMutexLocker lock(&d_lock);
+    d_overlays.remove(path);
+}
+
+void MappedFiles::clear()
+{
+    QMutexLocker lock(&d_lock);
+    d_files.clear();
+    d_overlays.clear();
+}
+
+MappedFiles::Stats MappedFiles::getStats() const
+{
+    Stats s;
+    QMutexLocker lock(&d_lock);
+    foreach( const QWeakPointer<Buffer>& w, d_files )
+    {
+        const QSharedPointer<Buffer> b = w.toStrongRef();
+        if( b.isNull() )
+            continue;
+        s.d_files++;
+        if( b->d_overlay.isNull() )
+        {
+            s.d_mapped += b->d_size;
+            s.d_resident += b->resident();
+        }else
+            s.d_overlayed += b->d_size;
+        QMutexLocker lock2( &b->d_lock );
+        s.d_lineTables += b->d_lines.capacity() * sizeof(quint32);
+    }
+    foreach( const QSharedPointer<Buffer>& b, d_overlays )
+    {
+        s.d_overlays++;
+        s.d_overlayed += b->d_size;
+        QMutexLocker lock2( &b->d_lock );
+        s.d_lineTables += b->d_lines.capacity() * sizeof(quint32);
+    }
+    return s;
+}
+
+static QString toMb( qint64 bytes )
+{
+    return QString::number( double(bytes) / 1024.0 / 1024.0, 'f', 1 ) + QLatin1String(" MB");
+}
+
+QString MappedFiles::toString(const MappedFiles::Stats& s)
+{
+    return QString("Verilog file cache: %1 files, %2 mapped, %3 resident; "
+                   "%4 edited buffers; %5 copied or edited; line tables %6")
+            .arg(s.d_files).arg(toMb(s.d_mapped)).arg(toMb(s.d_resident))
+            .arg(s.d_overlays).arg(toMb(s.d_overlayed)).arg(toMb(s.d_lineTables));
+}
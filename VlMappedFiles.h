@@ -0,0 +1,83 @@
+#ifndef VLMAPPEDFILES_H
+#define VLMAPPEDFILES_H
+
+/*
+* Copyright 2019 Rochus Keller <mailto:me@rochus-keller.ch>
+*
+* This file is part of the VerilogCreator plugin.
+*
+* The following is the license that applies to this copy of the
+* plugin. For a license to use the plugin under conditions
+* other than those described here, please email to me@rochus-keller.ch.
+*
+* GNU General Public License Usage
+* This file may be used under the terms of the GNU General Public
+* License (GPL) versions 2.0 or 3.0 as published by the Free Software
+* Foundation and appearing in the file LICENSE.GPL included in
+* the packaging of this file. Please review the following information
+* to ensure GNU General Public Licensing requirements will be met:
+* http://www.fsf.org/licensing/licenses/info/GPLv2.html and
+* http://www.gnu.org/copyleft/gpl.html.
+*/
+
+#include <QHash>
+#include <QMutex>
+#include <QSharedPointer>
+#include <QStringList>
+
+namespace Vl
+{
+    // Read access to source files without copying them into memory. Large files on disk are mapped
+    // read-only, small ones are read; the buffers of edited documents are registered as overlays which
+    // share the QByteArray of the editor snapshot. A table of line start offsets is built per file on
+    // first line access. A file stays loaded only as long as some Text of it exists, so keep Texts short
+    // lived; a mapped file which is truncated while being read is fatal. All functions are thread-safe.
+    class MappedFiles
+    {
+    public:
+        class Buffer;
+        class Text
+        {
+        public:
+            bool isNull() const { return d_buf.isNull(); }
+            // the returned array points into the mapping and is only valid as long as this Text exists
+            QByteArray bytes() const;
+            // the same without the 2 GB limit of QByteArray
+            const char* data() const;
+            qint64 size() const;
+            QByteArray line( quint32 nr ) const; // 1-based, without line end; deep copy
+            int lineCount() const; // 0 for files above 4 GB which have no line table
+        private:
+            friend class MappedFiles;
+            QSharedPointer<Buffer> d_buf;
+        };
+
+        MappedFiles();
+        ~MappedFiles();
+
+        Text getText( const QString& path );
+        void setOverlay( const QString& path, const QByteArray& );
+        void removeOverlay( const QString& path );
+        void clear();
+
+        struct Stats
+        {
+            int d_files;
+            int d_overlays;
+            qint64 d_mapped;    // size of all mappings
+            qint64 d_resident;  // part of the mappings currently in physical memory
+            qint64 d_overlayed; // size of all overlay buffers and copied files
+            qint64 d_lineTables;
+            Stats():d_files(0),d_overlays(0),d_mapped(0),d_resident(0),d_overlayed(0),d_lineTables(0){}
+        };
+        Stats getStats() const;
+        static QString toString( const Stats& );
+    private:
+        mutable QMutex d_lock;
+        QHash<QString,QWeakPointer<Buffer> > d_files;
+        int d_prune; // d_files size at which released entries are removed
+        QHash<QString,QSharedPointer<Buffer> > d_overlays;
+    };
+}
+
+#endif // VLMAPPEDFILES_H
@@ -0,0 +1,288 @@
+/*
+* Copyright 2019 Rochus Keller <mailto:me@rochus-keller.ch>
+*
+* This file is part of the VerilogCreator plugin.
+*
+* The following is the license that applies to this copy of the
+* plugin. For a license to use the plugin under conditions
+* other than those described here, please email to me@rochus-keller.ch.
+*
+* GNU General Public License Usage
+* This file may be used under the terms of the GNU General Public
+* License (GPL) versions 2.0 or 3.0 as published by the Free Software
+* Foundation and appearing in the file LICENSE.GPL included in
+* the packaging of this file. Please review the following information
+* to ensure GNU General Public Licensing requirements will be met:
+* http://www.fsf.org/licensing/licenses/info/GPLv2.html and
+* http://www.gnu.org/copyleft/gpl.html.
+*/
+
+
+#include "VlMatrixStep.h"
+#include <projectexplorer/buildconfiguration.h>
+#include <projectexplorer/projectexplorerconstants.h>
+#include <projectexplorer/projectexplorer.h>
+#include <projectexplorer/buildsteplist.h>
+#include <projectexplorer/target.h>
+#include <projectexplorer/task.h>
+#include <utils/qtcprocess.h>
+#include <QDir>
+#include <QFormLayout>
+#include <QPlainTextEdit>
+#include <QSpinBox>
+#include <QSet>
+using namespace Vl;
+
+const char* MatrixStep::ID = "VerilogCreator.MatrixStep";
+
+MatrixStep::MatrixStep(ProjectExplorer::BuildStepList* parent):
+    BuildStep(parent, ID),d_maxJobs(0)
+{
+    setDefaultDisplayName(tr("Matrix") );
+}
+
+bool MatrixStep::init()
+{
+    ProjectExplorer::BuildConfiguration *bc = buildConfiguration();
+    if (!bc)
+        bc = target()->activeBuildConfiguration();
+    if (!bc)
+    {
+        emit addTask(ProjectExplorer::Task::buildConfigurationMissingTask());
+        return false;
+    }
+
+    d_pending.clear();
+    const QString err = parseJobs( bc->macroExpander()->expand(d_jobs), d_pending );
+    if( !err.isEmpty() )
+    {
+        emit addTask(ProjectExplorer::Task(ProjectExplorer::Task::Error, err,
+                       Utils::FileName(), -1,
+                       ProjectExplorer::Constants::TASK_CATEGORY_BUILDSYSTEM) );
+        return false;
+    }
+    if( d_pending.isEmpty() )
+    {
+        emit addTask(ProjectExplorer::Task(ProjectExplorer::Task::Warning,
+                       tr( "No matrix jobs configured"),
+                       Utils::FileName(), -1,
+                       ProjectExplorer::Constants::TASK_CATEGORY_BUILDSYSTEM) );
+        return false;
+    }
+
+    QDir buildDir = bc->buildDirectory().toString();
+    const Utils::Environment env = bc->environment();
+    for( int i = 0; i < d_pending.size(); i++ )
+    {
+        JobRunner::Job& j = d_pending[i];
+        const QString dir = buildDir.absoluteFilePath( j.d_name );
+        if( !buildDir.mkpath( dir ) )
+        {
+            emit addTask(ProjectExplorer::Task(ProjectExplorer::Task::Error,
+                           tr( "Unable to create the directory %1.").arg( QDir::toNativeSeparators(dir)),
+                           Utils::FileName(), -1,
+                           ProjectExplorer::Constants::TASK_CATEGORY_BUILDSYSTEM) );
+            return false;
+        }
+        j.d_workDir = dir;
+        j.d_env = env;
+        const Utils::FileName cmd = env.searchInPath( j.d_cmd );
+        if( !cmd.isEmpty() )
+            j.d_cmd = cmd.toString();
+    }
+    return true;
+}
+
+void MatrixStep::run(QFutureInterface<bool>& fi)
+{
+    // the runner and its processes live in this thread; its signals are delivered directly.
+    // Its local event loop dispatches whatever is posted to this thread, so the runner may be deleted
+    // meanwhile; d_runner then turns null and neither the slots nor the rest of run() touch it anymore.
+    d_runner = new JobRunner();
+    d_runner->setMaxJobs( d_maxJobs );
+    foreach( const JobRunner::Job& j, d_pending )
+        d_runner->add( j );
+    connect( d_runner, SIGNAL(sigStarted(int)), this, SLOT(onJobStarted(int)), Qt::DirectConnection );
+    connect( d_runner, SIGNAL(sigOutput(int,QString,bool)), this, SLOT(onJobOutput(int,QString,bool)),
+             Qt::DirectConnection );
+    connect( d_runner, SIGNAL(sigFinished(int)), this, SLOT(onJobFinished(int)), Qt::DirectConnection );
+
+    emit addOutput( tr("Running %1 jobs, up to %2 at a time").arg( d_runner->getJobCount() )
+                    .arg( d_runner->getMaxJobs() ), BuildStep::MessageOutput );
+    const bool ok = d_runner->run( fi );
+
+    if( d_runner.isNull() )
+    {
+        fi.reportResult(false);
+        emit finished();
+        return;
+    }
+    const JobRunner& runner = *d_runner;
+    if( fi.isCanceled() )
+        emit addOutput( tr("Canceled"), BuildStep::ErrorMessageOutput );
+    else
+    {
+        for( int i = 0; i < runner.getJobCount(); i++ )
+        {
+            const JobRunner::Job& j = runner.getJob(i);
+            if( j.succeeded() )
+                emit addOutput( tr("    %1: passed (%2 s)").arg( j.d_name ).arg( j.d_ms / 1000.0, 0, 'f', 1 ),
+                                BuildStep::MessageOutput );
+            else if( j.d_crashed )
+                emit addOutput( tr("    %1: FAILED (crashed or not started)").arg( j.d_name ),
+                                BuildStep::ErrorMessageOutput );
+            else
+                emit addOutput( tr("    %1: FAILED (exit code %2)").arg( j.d_name ).arg( j.d_exitCode ),
+                                BuildStep::ErrorMessageOutput );
+        }
+        const int failed = runner.getFailedCount();
+        emit addOutput( tr("Matrix: %1 of %2 jobs passed").arg( runner.getJobCount() - failed )
+                        .arg( runner.getJobCount() ),
+                        failed == 0 ? BuildStep::MessageOutput : BuildStep::ErrorMessageOutput );
+    }
+    delete d_runner;
+
+    fi.reportResult(ok);
+
+    emit finished();
+}
+
+void MatrixStep::onJobStarted(int job)
+{
+    if( d_runner.isNull() )
+        return;
+    const JobRunner::Job& j = d_runner->getJob(job);
+    emit addOutput( QString("[%1] %2 %3").arg( j.d_name ).arg( j.d_cmd ).arg( j.d_args ),
+                    BuildStep::MessageOutput );
+}
+
+void MatrixStep::onJobOutput(int job, const QString& line, bool err)
+{
+    if( d_runner.isNull() )
+        return;
+    emit addOutput( QString("[%1] %2").arg( d_runner->getJob(job).d_name ).arg( line ),
+                    err ? BuildStep::ErrorOutput : BuildStep::NormalOutput );
+}
+
+void MatrixStep::onJobFinished(int job)
+{
+    if( d_runner.isNull() )
+        return;
+    const JobRunner::Job& j = d_runner->getJob(job);
+    if( !j.succeeded() )
+        emit addOutput( tr("[%1] failed").arg( j.d_name ), BuildStep::ErrorMessageOutput );
+}
+
+ProjectExplorer::BuildStepConfigWidget* MatrixStep::createConfigWidget()
+{
+    return new MatrixStepWidget(this);
+}
+
+static const char* MATRIX_JOBS_KEY = "VerilogCreator.MatrixStep.Jobs";
+static const char* MATRIX_MAXJOBS_KEY = "VerilogCreator.MatrixStep.MaxJobs";
+
+QVariantMap MatrixStep::toMap() const
+{
+    QVariantMap map(BuildStep::toMap());
+
+    map.insert(QLatin1String(MATRIX_JOBS_KEY), d_jobs);
+    map.insert(QLatin1String(MATRIX_MAXJOBS_KEY), d_maxJobs);
+    return map;
+}
+
+QString MatrixStep::parseJobs(const QString& text, QList<JobRunner::Job>& res)
+{
+    QSet<QString> names;
+    foreach( const QString& l, text.split( QChar('\n') ) )
+    {
+        const QString line = l.trimmed();
+        if( line.isEmpty() || line.startsWith( QChar('#') ) )
+            continue;
+        const int colon = line.indexOf( QChar(':') );
+        if( colon <= 0 )
+            return tr("Matrix job without name: %1").arg( line );
+        JobRunner::Job j;
+        j.d_name = line.left( colon ).trimmed();
+        // the name is a subdirectory of the build directory; "." and ".." would escape it
+        if( j.d_name.contains( QRegExp("[^\\w\\-\\.]") ) || j.d_name.startsWith( QChar('.') ) )
+            return tr("Invalid matrix job name: %1").arg( j.d_name );
+        if( names.contains( j.d_name ) )
+            return tr("Duplicate matrix job name: %1").arg( j.d_name );
+        names.insert( j.d_name );
+        QStringList args = Utils::QtcProcess::splitArgs( line.mid( colon + 1 ).trimmed() );
+        if( args.isEmpty() )
+            return tr("Matrix job without command: %1").arg( j.d_name );
+        j.d_cmd = args.takeFirst();
+        j.d_args = Utils::QtcProcess::joinArgs( args );
+        res.append( j );
+    }
+    return QString();
+}
+
+bool MatrixStep::fromMap(const QVariantMap& map)
+{
+    d_jobs = map.value(QLatin1String(MATRIX_JOBS_KEY)).toString();
+    d_maxJobs = map.value(QLatin1String(MATRIX_MAXJOBS_KEY)).toInt();
+
+    return BuildStep::fromMap(map);
+}
+
+MatrixStepWidget::MatrixStepWidget(MatrixStep* step):d_step(step)
+{
+    QFormLayout *fl = new QFormLayout(this);
+    fl->setContentsMargins(0, -1, 0, -1);
+    fl->setFieldGrowthPolicy(QFormLayout::ExpandingFieldsGrow);
+
+    d_jobs = new QPlainTextEdit(this);
+    d_jobs->setPlainText(step->d_jobs);
+    d_jobs->setToolTip(tr("One job per line: name: command arguments"));
+    fl->addRow( tr("Jobs:"), d_jobs );
+
+    d_maxJobs = new QSpinBox(this);
+    d_maxJobs->setRange( 0, 256 );
+    d_maxJobs->setSpecialValueText(tr("one per core"));
+    d_maxJobs->setValue(step->d_maxJobs);
+    fl->addRow( tr("Parallel jobs:"), d_maxJobs );
+
+    updateDetails();
+
+    connect( d_jobs, SIGNAL(textChanged()), this, SLOT(jobsEdited()) );
+    connect( d_maxJobs, SIGNAL(valueChanged(int)), this, SLOT(maxJobsEdited()) );
+    connect(ProjectExplorer::ProjectExplorerPlugin::instance(), SIGNAL(settingsChanged()),
+            this, SLOT(updateDetails()));
+}
+
+QString MatrixStepWidget::displayName() const
+{
+    return tr("Matrix");
+}
+
+QString MatrixStepWidget::summaryText() const
+{
+    return d_summary;
+}
+
+void MatrixStepWidget::jobsEdited()
+{
+    d_step->d_jobs = d_jobs->toPlainText();
+    updateDetails();
+}
+
+void MatrixStepWidget::maxJobsEdited()
+{
+    d_step->d_maxJobs = d_maxJobs->value();
+    updateDetails();
+}
+
+void MatrixStepWidget::updateDetails()
+{
+    QList<JobRunner::Job> jobs;
+    const QString err = MatrixStep::parseJobs( d_step->d_jobs, jobs );
+    if( !err.isEmpty() )
+        d_summary = tr("<b>Matrix</b>: %1").arg( err.toHtmlEscaped() );
+    else if( d_step->d_maxJobs > 0 )
+        d_summary = tr("<b>Matrix</b>: %1 jobs, up to %2 at a time").arg( jobs.size() ).arg( d_step->d_maxJobs );
+    else
+        d_summary = tr("<b>Matrix</b>: %1 jobs, one per core at a time").arg( jobs.size() );
+    emit updateSummary();
+}
@@ -0,0 +1,87 @@
+#ifndef VLMATRIXSTEP_H
+#define VLMATRIXSTEP_H
+
+/*
+* Copyright 2019 Rochus Keller <mailto:me@rochus-keller.ch>
+*
+* This file is part of the VerilogCreator plugin.
+*
+* The following is the license that applies to this copy of the
+* plugin. For a license to use the plugin under conditions
+* other than those described here, please email to me@rochus-keller.ch.
+*
+* GNU General Public License Usage
+* This file may be used under the terms of the GNU General Public
+* License (GPL) versions 2.0 or 3.0 as published by the Free Software
+* Foundation and appearing in the file LICENSE.GPL included in
+* the packaging of this file. Please review the following information
+* to ensure GNU General Public Licensing requirements will be met:
+* http://www.fsf.org/licensing/licenses/info/GPLv2.html and
+* http://www.gnu.org/copyleft/gpl.html.
+*/
+
+#include <projectexplorer/buildstep.h>
+#include "VlJobRunner.h"
+#include <QPointer>
+
+class QPlainTextEdit;
+class QSpinBox;
+
+namespace Vl
+{
+    // Runs a list of independent tool invocations concurrently, e.g. several testbenches, DEFINES variants
+    // or lint, synthesis and simulation side by side. Each line of the job list reads "name: command args";
+    // every job runs in its own subdirectory of the build directory, so outputs don't collide.
+    class MatrixStep : public ProjectExplorer::BuildStep
+    {
+        Q_OBJECT
+    public:
+        static const char* ID;
+
+        explicit MatrixStep(ProjectExplorer::BuildStepList *parent);
+
+        bool init();
+        void run(QFutureInterface<bool> &fi);
+        bool immutable() const { return false; }
+        ProjectExplorer::BuildStepConfigWidget* createConfigWidget();
+        QVariantMap toMap() const;
+
+        // returns an error message or an empty string
+        static QString parseJobs( const QString& text, QList<JobRunner::Job>& );
+    protected:
+        bool fromMap(const QVariantMap &map);
+    protected slots:
+        void onJobStarted( int );
+        void onJobOutput( int, const QString&, bool );
+        void onJobFinished( int );
+    private:
+        QString d_jobs;
+        int d_maxJobs;
+        QList<JobRunner::Job> d_pending; // prepared by init()
+        QPointer<JobRunner> d_runner;    // only during run()
+        friend class MatrixStepWidget;
+    };
+
+    class MatrixStepWidget : public ProjectExplorer::BuildStepConfigWidget
+    {
+        Q_OBJECT
+
+    public:
+        MatrixStepWidget(MatrixStep *step);
+        QString displayName() const;
+        QString summaryText() const;
+
+    private slots:
+        void jobsEdited();
+        void maxJobsEdited();
+        void updateDetails();
+
+    private:
+        MatrixStep* d_step;
+        QString d_summary;
+        QPlainTextEdit* d_jobs;
+        QSpinBox* d_maxJobs;
+    };
+}
+
+#endif // VLMATRIXSTEP_H
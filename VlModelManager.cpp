@@ -18,29 +18,186 @@
 */
 
 #include "VlModelManager.h"
+#include "VlCodeIndex.h"
+#include "VlMappedFiles.h"
 #include "VlConstants.h"
+#include "VlSdfIndex.h"
 #include <Verilog/VlErrors.h>
 #include <Verilog/VlCrossRefModel.h>
 #include <projectexplorer/projecttree.h>
 #include <projectexplorer/project.h>
 #include <projectexplorer/taskhub.h>
+#include <coreplugin/progressmanager/progressmanager.h>
 #include <utils/fileutils.h>
+#include <QFileInfo>
+#include <QtConcurrent/QtConcurrentRun>
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <algorithm>
 using namespace Vl;
 
 ModelManager* ModelManager::d_inst = 0;
 
-ModelManager::ModelManager(QObject *parent) : QObject(parent),d_lastUsed(0)
+// The worker takes the editor snapshots off the GUI thread, encodes them and hands them to the FileCache.
+// Jobs are coalesced per file, so the queue never holds more entries than there are edited files; a job
+// which is overtaken by a newer snapshot while being encoded is dropped.
+class ModelManager::Worker : public QThread
 {
+public:
+    // the model is referenced by its key in d_models, so a model deleted meanwhile is simply not found
+    struct Job
+    {
+        QString d_mdl;
+        QString d_text;
+        quint32 d_gen;
+        Job():d_gen(0){}
+    };
+    struct Done
+    {
+        QString d_mdl;
+        QString d_file;
+        quint32 d_gen;
+    };
+
+    Worker(ModelManager* mm):d_mm(mm),d_quit(false) {}
+
+    void post( const QString& mdl, const QString& file, const QString& text )
+    {
+        QMutexLocker lock(&d_lock);
+        if( !d_jobs.contains(file) )
+            d_order.append(file);
+        Job& j = d_jobs[file];
+        j.d_mdl = mdl;
+        j.d_text = text;
+        j.d_gen = ++d_gens[file];
+        d_wake.wakeOne();
+    }
+    // returns true if a snapshot of the file was still queued, being encoded or waiting for the GUI thread
+    bool cancel( const QString& file )
+    {
+        QMutexLocker lock(&d_lock);
+        bool pending = d_busy == file;
+        if( d_jobs.remove(file) )
+        {
+            d_order.removeAll(file);
+            pending = true;
+        }
+        foreach( const Done& d, d_done )
+        {
+            if( d.d_file == file )
+                pending = true;
+        }
+        ++d_gens[file];
+        return pending;
+    }
+    bool isCurrent( const QString& file, quint32 gen )
+    {
+        QMutexLocker lock(&d_lock);
+        return d_gens.value(file) == gen;
+    }
+    QList<Done> takeDone()
+    {
+        QMutexLocker lock(&d_lock);
+        QList<Done> res = d_done;
+        d_done.clear();
+        return res;
+    }
+    void stop()
+    {
+        QMutexLocker lock(&d_lock);
+        d_quit = true;
+        d_wake.wakeOne();
+    }
+protected:
+    void run()
+    {
+        forever
+        {
+            QString file;
+            Job job;
+            {
+                QMutexLocker lock(&d_lock);
+                while( !d_quit && d_order.isEmpty() )
+                    d_wake.wait(&d_lock);
+                if( d_quit )
+                    return;
+                file = d_order.takeFirst();
+                job = d_jobs.take(file);
+                d_busy = file;
+            }
+            const QByteArray code = job.d_text.toLatin1();
+            job.d_text.clear();
+            bool notify = false;
+            {
+                QMutexLocker lock(&d_lock);
+                d_busy.clear();
+                if( d_gens.value(file) != job.d_gen )
+                    continue; // superseded while encoding
+                d_mm->getFileCache()->addFile( file, code );
+                d_mm->getMappedFiles()->setOverlay( file, code ); // shares the bytes with the FileCache
+                Done d;
+                d.d_mdl = job.d_mdl;
+                d.d_file = file;
+                d.d_gen = job.d_gen;
+                notify = d_done.isEmpty();
+                d_done.append(d);
+            }
+            if( notify )
+                QMetaObject::invokeMethod( d_mm, "onSnapshotReady", Qt::QueuedConnection );
+        }
+    }
+private:
+    ModelManager* d_mm;
+    QMutex d_lock;
+    QWaitCondition d_wake;
+    QHash<QString,Job> d_jobs;
+    QStringList d_order;
+    QString d_busy; // the file being encoded
+    QHash<QString,quint32> d_gens;
+    QList<Done> d_done;
+    bool d_quit;
+};
+
+ModelManager::ModelManager(QObject *parent) : QObject(parent),d_lastUsed(0),d_issueGen(0),d_issueMdl(0)
+{
+    connect( &d_issueWatcher, SIGNAL(finished()), this, SLOT(onIssuesReady()) );
     d_fcache = new FileCache(this);
+    d_mapped = new MappedFiles();
     d_inst = this;
+    d_worker = new Worker(this);
+    d_worker->start(QThread::LowPriority);
 }
 
 ModelManager::~ModelManager()
 {
+    d_worker->stop();
+    d_worker->wait();
+    delete d_worker;
+    d_issueWatcher.waitForFinished();
+    foreach( const Progress& p, d_progress )
+    {
+        p.d_fi->reportFinished();
+        delete p.d_fi;
+    }
+    foreach( const SdfJob& j, d_sdfJobs )
+    {
+        j.d_fi->cancel();
+        j.d_watcher->waitForFinished();
+        delete j.d_watcher->result();
+        j.d_fi->reportFinished();
+        delete j.d_fi;
+        delete j.d_watcher;
+    }
+    qDeleteAll(d_sdf);
+    for( int i = 0; i < d_mappedJobFis.size(); i++ )
+        d_mappedJobFis[i].cancel();
+    d_mappedJobs.waitForDone();
     // Lösche hier explizit damit nicht FileCache gelöscht wird während noch Threads laufen
     QHash<QString,CrossRefModel*>::const_iterator i;
     for( i = d_models.begin(); i != d_models.end(); ++i )
         delete i.value();
+    delete d_mapped;
     d_inst = 0;
 }
 
@@ -53,7 +210,9 @@ CrossRefModel*ModelManager::getModelForFile(const QString& fileName)
     {
         m = new CrossRefModel(this,d_fcache);
         connect( m, SIGNAL(sigModelUpdated()), this, SLOT(onModelUpdated()) );
+        connect( m, SIGNAL(sigFileUpdated(QString)), this, SLOT(onFileUpdated(QString)) );
         d_paths[m] = fileName;
+        d_indices[m] = new CodeIndex(m);
     }
     d_lastUsed = m;
     return m;
@@ -72,6 +231,7 @@ CrossRefModel*ModelManager::getModelForDir(const QString& dirPath, bool initIfEm
                                                << QString("*.vl"), QDir::Files, QDir::Name );
         for( int i = 0; i < files.size(); i++ )
             files[i] = dir.absoluteFilePath(files[i]);
+        reportProgress( mdl, files.size() );
         mdl->updateFiles(files);
     }
     return mdl;
@@ -96,11 +256,94 @@ CrossRefModel*ModelManager::getModelForCurrentProjectOrDirPath(const QString& di
     return mdl;
 }
 
+void ModelManager::scheduleUpdate(CrossRefModel* mdl, const QString& file, const QString& text)
+{
+    Q_ASSERT( mdl != 0 );
+    d_worker->post( d_paths.value(mdl), file, text );
+}
+
+void ModelManager::startMappedFilesJob(QRunnable* job, const QFutureInterfaceBase& fi)
+{
+    for( int i = d_mappedJobFis.size() - 1; i >= 0; i-- )
+    {
+        if( d_mappedJobFis[i].isFinished() )
+            d_mappedJobFis.removeAt(i);
+    }
+    d_mappedJobFis.append( fi );
+    d_mappedJobs.start( job );
+}
+
+bool ModelManager::cancelUpdate(const QString& file)
+{
+    const bool pending = d_worker->cancel( file );
+    d_mapped->removeOverlay( file );
+    return pending;
+}
+
+void ModelManager::reportProgress(CrossRefModel* mdl, int fileCount)
+{
+    if( fileCount <= 1 )
+        return; // single files are parsed while typing; no need to bother the user
+    Progress& p = d_progress[mdl];
+    if( p.d_fi == 0 )
+    {
+        p.d_fi = new QFutureInterface<void>();
+        p.d_fi->setProgressRange( 0, fileCount );
+        p.d_fi->reportStarted();
+        Core::ProgressManager::addTask( p.d_fi->future(), tr("Parsing Verilog files"), Constants::ParseTaskId );
+    }else
+        p.d_fi->setProgressRange( 0, p.d_count + fileCount );
+    p.d_count += fileCount;
+}
+
+SdfIndex*ModelManager::getSdfIndex(const QString& sdfPath)
+{
+    SdfIndex* idx = d_sdf.value(sdfPath);
+    if( idx )
+        return idx;
+    foreach( const SdfJob& j, d_sdfJobs )
+    {
+        if( j.d_path == sdfPath )
+            return 0;
+    }
+    SdfJob j;
+    j.d_path = sdfPath;
+    j.d_fi = new QFutureInterface<void>();
+    j.d_fi->reportStarted();
+    Core::ProgressManager::addTask( j.d_fi->future(),
+                                    tr("Indexing %1").arg(QFileInfo(sdfPath).fileName()), Constants::SdfIndexTaskId );
+    j.d_watcher = new QFutureWatcher<SdfIndex*>(this);
+    connect( j.d_watcher, SIGNAL(finished()), this, SLOT(onSdfIndexed()) );
+    d_sdfJobs.insert( j.d_watcher, j );
+    j.d_watcher->setFuture( QtConcurrent::run( SdfIndex::open, sdfPath, static_cast<QFutureInterfaceBase*>(j.d_fi) ) );
+    return 0;
+}
+
+void ModelManager::onSdfIndexed()
+{
+    if( !d_sdfJobs.contains( sender() ) )
+        return;
+    const SdfJob j = d_sdfJobs.take( sender() );
+    SdfIndex* idx = j.d_watcher->result();
+    j.d_fi->reportFinished();
+    delete j.d_fi;
+    j.d_watcher->deleteLater();
+    if( idx == 0 )
+        return; // canceled or unreadable; the next request starts over
+    d_sdf.insert( j.d_path, idx );
+    emit sigSdfIndexReady( j.d_path );
+}
+
 QString ModelManager::getPathOf(CrossRefModel* m) const
 {
     return d_paths.value(m);
 }
 
+CodeIndex*ModelManager::getIndex(CrossRefModel* m) const
+{
+    return d_indices.value(m);
+}
+
 ModelManager*ModelManager::instance()
 {
     if( d_inst )
@@ -109,43 +352,154 @@ ModelManager*ModelManager::instance()
     return d_inst;
 }
 
+void ModelManager::onSnapshotReady()
+{
+    QHash<CrossRefModel*,QStringList> todo;
+    foreach( const Worker::Done& d, d_worker->takeDone() )
+    {
+        CrossRefModel* mdl = d_models.value(d.d_mdl);
+        if( mdl == 0 )
+            continue; // the model is gone
+        // a newer snapshot of the same file is on its way; don't let the model parse the old one
+        if( d_worker->isCurrent( d.d_file, d.d_gen ) && !todo[mdl].contains(d.d_file) )
+            todo[mdl].append(d.d_file);
+    }
+    QHash<CrossRefModel*,QStringList>::const_iterator i;
+    for( i = todo.begin(); i != todo.end(); ++i )
+    {
+        // only queues the files; lexing and parsing run on the model's own thread, which publishes the
+        // new scopes under its lock and then emits sigModelUpdated
+        if( !i.value().isEmpty() )
+            i.key()->updateFiles( i.value() );
+    }
+}
+
+void ModelManager::onFileUpdated(const QString&)
+{
+    CrossRefModel* mdl = static_cast<CrossRefModel*>( sender() );
+    QHash<CrossRefModel*,Progress>::iterator i = d_progress.find(mdl);
+    if( i != d_progress.end() )
+        i.value().d_fi->setProgressValue( qMin( ++i.value().d_done, i.value().d_count ) );
+}
+
 void ModelManager::onModelUpdated()
 {
     // TODO: optional ein- oder ausschaltbar
 
     CrossRefModel* mdl = static_cast<CrossRefModel*>( sender() );
 
-    ProjectExplorer::TaskHub::clearTasks( Vl::Constants::TaskId );
+    if( d_progress.contains(mdl) )
+    {
+        Progress p = d_progress.take(mdl);
+        p.d_fi->reportFinished();
+        delete p.d_fi;
+    }
+
+    if( d_issueMdl != mdl )
+    {
+        // another model takes over the Issues pane
+        ProjectExplorer::TaskHub::clearTasks( Vl::Constants::TaskId );
+        d_issues.clear();
+        d_tasks.clear();
+        d_issueMdl = mdl;
+    }
+    // sorting and comparing is done in a worker; the GUI thread only touches the files which changed
+    d_issueWatcher.setFuture( QtConcurrent::run( diffIssues, ++d_issueGen, mdl->getErrs()->getErrors(),
+                                                 mdl->getErrs()->getWarnings(), d_issues ) );
+}
+
+void ModelManager::onIssuesReady()
+{
+    if( d_issueWatcher.isCanceled() || d_issueWatcher.future().resultCount() == 0 )
+        return;
+    const IssueDelta delta = d_issueWatcher.result();
+    if( delta.d_gen != d_issueGen )
+        return; // a newer update is on its way and was compared with the same published state
+
+    const QStringList touched = delta.d_removed + delta.d_changed.keys();
+    if( touched.isEmpty() )
+        return;
+    foreach( const QString& file, delta.d_removed )
+        d_issues.remove(file);
+    IssuesByFile::const_iterator i;
+    for( i = delta.d_changed.begin(); i != delta.d_changed.end(); ++i )
+        d_issues[i.key()] = i.value();
+
+    // TaskHub sortiert nicht selber; the pane shows the tasks in the order they were added and there is no
+    // way to insert in between. So the tasks of the first touched file and of all files after it are
+    // taken down and added again in (file, line) order; the files before it stay as they are.
+    const QString first = *std::min_element( touched.begin(), touched.end() );
+    QMap<QString,QList<ProjectExplorer::Task> >::iterator j = d_tasks.lowerBound( first );
+    while( j != d_tasks.end() )
+    {
+        foreach( const ProjectExplorer::Task& t, j.value() )
+            ProjectExplorer::TaskHub::removeTask( t );
+        j = d_tasks.erase( j );
+    }
+    QStringList files;
+    for( i = d_issues.begin(); i != d_issues.end(); ++i )
+    {
+        if( !( i.key() < first ) )
+            files.append( i.key() );
+    }
+    files.sort();
+    foreach( const QString& file, files )
+    {
+        QList<ProjectExplorer::Task>& tasks = d_tasks[file];
+        const Utils::FileName path = Utils::FileName::fromString(file);
+        foreach( const Issue& e, d_issues.value(file) )
+        {
+            ProjectExplorer::Task t( e.d_err ? ProjectExplorer::Task::Error : ProjectExplorer::Task::Warning,
+                                     e.d_msg, path, e.d_line, Vl::Constants::TaskId );
+            ProjectExplorer::TaskHub::addTask( t );
+            tasks.append( t );
+        }
+    }
+}
 
-    typedef QPair<QString,quint32> FileLine;
-    typedef QPair<QString,bool> Message;
-    typedef QMultiMap<FileLine,Message> Lines;
-    Lines lines;
-    Errors::EntriesByFile errs = mdl->getErrs()->getErrors();
+ModelManager::IssueDelta ModelManager::diffIssues(quint32 gen, const Errors::EntriesByFile& errs,
+                                                  const Errors::EntriesByFile& wrns, const IssuesByFile& published)
+{
+    IssuesByFile cur;
     for( Errors::EntriesByFile::const_iterator j = errs.begin(); j != errs.end(); ++j )
     {
-        foreach (const Errors::Entry& e, j.value() )
+        Issues& l = cur[j.key()];
+        foreach( const Errors::Entry& e, j.value() )
         {
-            lines.insert( qMakePair( j.key(), e.d_line ), qMakePair( e.d_msg, true ) );
+            Issue i;
+            i.d_line = e.d_line;
+            i.d_msg = e.d_msg;
+            i.d_err = true;
+            l.append(i);
         }
     }
-    Errors::EntriesByFile wrns = mdl->getErrs()->getWarnings();
     for( Errors::EntriesByFile::const_iterator j = wrns.begin(); j != wrns.end(); ++j )
     {
-        foreach (const Errors::Entry& e, j.value() )
+        Issues& l = cur[j.key()];
+        foreach( const Errors::Entry& e, j.value() )
         {
-            lines.insert( qMakePair( j.key(), e.d_line ), qMakePair( e.d_msg, false ) );
+            Issue i;
+            i.d_line = e.d_line;
+            i.d_msg = e.d_msg;
+            i.d_err = false;
+            l.append(i);
         }
     }
 
-    for( Lines::const_iterator i = lines.begin(); i != lines.end(); ++i )
+    IssueDelta res;
+    res.d_gen = gen;
+    for( IssuesByFile::iterator i = cur.begin(); i != cur.end(); ++i )
     {
-        // TaskHub sortiert nicht selber
-        ProjectExplorer::TaskHub::addTask( i.value().second ? ProjectExplorer::Task::Error : ProjectExplorer::Task::Warning,
-                                           i.value().first,
-                                           Vl::Constants::TaskId,
-                                           Utils::FileName::fromString(i.key().first),
-                                           i.key().second );
+        if( i.value().isEmpty() )
+            continue;
+        std::stable_sort( i.value().begin(), i.value().end() ); // errors before warnings on the same line
+        if( published.value( i.key() ) != i.value() )
+            res.d_changed.insert( i.key(), i.value() );
     }
+    for( IssuesByFile::const_iterator i = published.begin(); i != published.end(); ++i )
+    {
+        if( cur.value( i.key() ).isEmpty() )
+            res.d_removed.append( i.key() );
+    }
+    return res;
 }
-
@@ -22,11 +22,21 @@
 
 #include <QObject>
 #include <QHash>
+#include <QMap>
+#include <QFutureInterface>
+#include <QFutureWatcher>
+#include <QThreadPool>
+#include <projectexplorer/task.h>
 #include <Verilog/VlFileCache.h>
 #include <Verilog/VlCrossRefModel.h>
+#include <Verilog/VlErrors.h>
 
 namespace Vl
 {
+    class CodeIndex;
+    class MappedFiles;
+    class SdfIndex;
+
     class ModelManager : public QObject
     {
         Q_OBJECT
@@ -40,20 +50,90 @@ namespace Vl
         CrossRefModel* getModelForCurrentProjectOrDirPath(const QString& dirPath , bool initIfEmpty = false);
         CrossRefModel* getLastUsed() const { return d_lastUsed; }
         QString getPathOf(CrossRefModel*) const;
+        CodeIndex* getIndex(CrossRefModel*) const;
 
         FileCache* getFileCache() const { return d_fcache; }
+        MappedFiles* getMappedFiles() const { return d_mapped; }
+        // runs a background job which reads from MappedFiles; the destructor cancels fi and waits for the job
+        // before MappedFiles goes away
+        void startMappedFilesJob( QRunnable*, const QFutureInterfaceBase& fi );
+
+        // hands a snapshot of an editor buffer to the parse worker; per file only the latest snapshot survives
+        void scheduleUpdate( CrossRefModel*, const QString& file, const QString& text );
+        // also drops the edited buffer from MappedFiles; true if a snapshot was still on its way
+        bool cancelUpdate( const QString& file );
+
+        // shows the update in the progress manager until the model reports completion
+        void reportProgress( CrossRefModel*, int fileCount );
+
+        // returns 0 while the index is being built in the background; sigSdfIndexReady tells when it's done
+        SdfIndex* getSdfIndex( const QString& sdfPath );
 
         static ModelManager* instance();
 
+    signals:
+        void sigSdfIndexReady( const QString& sdfPath );
+
     protected slots:
         void onModelUpdated();
+        void onFileUpdated(const QString&);
+        void onSnapshotReady();
+        void onIssuesReady();
+        void onSdfIndexed();
 
     private:
+        class Worker;
+        struct Issue
+        {
+            quint32 d_line;
+            QString d_msg;
+            bool d_err;
+            bool operator==( const Issue& rhs ) const
+                { return d_line == rhs.d_line && d_err == rhs.d_err && d_msg == rhs.d_msg; }
+            bool operator<( const Issue& rhs ) const { return d_line < rhs.d_line; }
+        };
+        typedef QList<Issue> Issues;
+        typedef QHash<QString,Issues> IssuesByFile;
+        struct IssueDelta
+        {
+            quint32 d_gen;
+            IssuesByFile d_changed; // the complete new issue list of each file which differs
+            QStringList d_removed;  // files which have no issues anymore
+            IssueDelta():d_gen(0){}
+        };
+        static IssueDelta diffIssues( quint32 gen, const Errors::EntriesByFile& errs,
+                                      const Errors::EntriesByFile& wrns, const IssuesByFile& published );
+        struct Progress
+        {
+            QFutureInterface<void>* d_fi;
+            int d_count;
+            int d_done;
+            Progress():d_fi(0),d_count(0),d_done(0){}
+        };
+        struct SdfJob
+        {
+            QString d_path;
+            QFutureInterface<void>* d_fi;
+            QFutureWatcher<SdfIndex*>* d_watcher;
+        };
         static ModelManager* d_inst;
         QHash<QString,CrossRefModel*> d_models; // Project File -> Code Model
         QHash<CrossRefModel*,QString> d_paths;
+        QHash<CrossRefModel*,CodeIndex*> d_indices;
         CrossRefModel* d_lastUsed;
         FileCache* d_fcache;
+        MappedFiles* d_mapped;
+        QThreadPool d_mappedJobs;
+        QList<QFutureInterfaceBase> d_mappedJobFis;
+        Worker* d_worker;
+        QHash<CrossRefModel*,Progress> d_progress;
+        QFutureWatcher<IssueDelta> d_issueWatcher;
+        quint32 d_issueGen;
+        CrossRefModel* d_issueMdl; // the model the published tasks belong to
+        IssuesByFile d_issues;     // what the TaskHub currently shows
+        QMap<QString,QList<ProjectExplorer::Task> > d_tasks; // by file, in the order they were added
+        QHash<QString,SdfIndex*> d_sdf;
+        QHash<QObject*,SdfJob> d_sdfJobs; // by watcher
     };
 }
 
@@ -19,11 +19,12 @@
 
 #include "VlModuleLocator.h"
 #include "VlModelManager.h"
+#include "VlCodeIndex.h"
 #include <coreplugin/editormanager/editormanager.h>
 #include <QDir>
 using namespace Vl;
 
-ModuleLocator::ModuleLocator()
+ModuleLocator::ModuleLocator():d_index(false),d_icon(QPixmap(":/verilogcreator/images/block.png"))
 {
     setId("VerilogModules");
     setDisplayName(tr("Verilog modules and UDPs in global namespace"));
@@ -31,32 +32,38 @@ ModuleLocator::ModuleLocator()
     setIncludedByDefault(false);
 }
 
+void ModuleLocator::prepareSearch(const QString&)
+{
+    CrossRefModel* mdl = ModelManager::instance()->getModelForCurrentProject();
+    QMutexLocker lock(&d_lock);
+    d_mdl = mdl;
+    d_codeIndex = ModelManager::instance()->getIndex(mdl);
+    d_path = mdl ? ModelManager::instance()->getPathOf(mdl) : QString();
+}
+
 QList<Core::LocatorFilterEntry> ModuleLocator::matchesFor(QFutureInterface<Core::LocatorFilterEntry>& future,
                                                           const QString& entry)
 {
-    Q_UNUSED(future);
-
     QList<Core::LocatorFilterEntry> res;
 
-    CrossRefModel* mdl = ModelManager::instance()->getModelForCurrentProject();
+    d_lock.lock();
+    CrossRefModel* mdl = d_mdl;
+    CodeIndex* index = d_codeIndex;
+    QDir path( d_path );
+    d_lock.unlock();
     if( mdl == 0 )
         return res;
 
-    QDir path( ModelManager::instance()->getPathOf(mdl) );
-
-    CrossRefModel::IdentDeclRefList l = mdl->getGlobalNames();
-
-    QStringMatcher matcher(entry, Qt::CaseInsensitive); // ByteArrayMatcher is case sensitive instead
+    if( !d_index.update( mdl, index, future ) )
+        return res;
+    const SymbolIndex::EntryList l = d_index.find( entry, QString(), future );
 
-    QPixmap icon(":/verilogcreator/images/block.png");
-    foreach(const CrossRefModel::IdentDeclRef& id, l )
+    foreach(const SymbolIndex::Entry& e, l )
     {
-        const QString name = QString::fromLatin1(id->tok().d_val);
-        if( matcher.indexIn( name ) != -1 )
-        {
-            res << Core::LocatorFilterEntry( this, name, QVariant::fromValue(CrossRefModel::SymRef(id)),icon);
-            res.last().extraInfo = path.relativeFilePath( id->tok().d_sourcePath );
-        }
+        if( future.isCanceled() )
+            break;
+        res << Core::LocatorFilterEntry( this, e.d_name, QVariant::fromValue(e.d_sym), d_icon);
+        res.last().extraInfo = path.relativeFilePath( e.d_file );
     }
     return res;
 }
@@ -70,6 +77,12 @@ void ModuleLocator::accept(Core::LocatorFilterEntry selection) const
 
 void ModuleLocator::refresh(QFutureInterface<void>& future)
 {
-    Q_UNUSED(future);
+    d_lock.lock();
+    CrossRefModel* mdl = d_mdl;
+    CodeIndex* index = d_codeIndex;
+    d_lock.unlock();
+    d_index.clear();
+    if( mdl )
+        d_index.update( mdl, index, future );
 }
 
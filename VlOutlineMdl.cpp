@@ -21,10 +21,11 @@
 #include "VlModelManager.h"
 #include <Verilog/VlSynTree.h>
 #include <QPixmap>
+#include <algorithm>
 #include <QtDebug>
 using namespace Vl;
 
-OutlineMdl1::OutlineMdl1(QObject *parent) : QAbstractItemModel(parent),d_crm(0)
+OutlineMdl1::OutlineMdl1(QObject *parent) : QAbstractItemModel(parent),d_lookupValid(false),d_crm(0)
 {
 
 }
@@ -35,6 +36,7 @@ void OutlineMdl1::setFile(const QString& f)
         return;
     beginResetModel();
     d_rows.clear();
+    d_lookupValid = false;
     if( d_crm )
         disconnect( d_crm, SIGNAL(sigFileUpdated(QString)), this, SLOT( onCrmUpdated(QString) ) );
     d_file = f;
@@ -49,8 +51,8 @@ const CrossRefModel::Symbol*OutlineMdl1::getSymbol(const QModelIndex& index) con
 {
     if( !index.isValid() || d_crm == 0 )
         return 0;
-    const int id = index.internalId();
-    if( id == 0 )
+    const int id = index.row();
+    if( id <= 0 )
         return 0;
     Q_ASSERT( id <= d_rows.size() );
     return d_rows[id-1].d_sym.data();
@@ -61,21 +63,23 @@ QModelIndex OutlineMdl1::findSymbol(const CrossRefModel::Symbol* s)
     if( s == 0 || s->tok().d_sourcePath != d_file )
         return QModelIndex();
 
-    for( int i = 0; i < d_rows.size(); i++ )
-    {
-        if( d_rows[i].d_sym.data() == s )
-            return createIndex( i+1, 0, (quint32)i+1 );
-    }
+    buildLookup();
+    QHash<const CrossRefModel::Symbol*,int>::const_iterator i = d_rowOf.find(s);
+    if( i != d_rowOf.end() )
+        return createIndex( i.value() + 1, 0 );
     return QModelIndex();
 }
 
 QModelIndex OutlineMdl1::findSymbol(quint32 line, quint16 col)
 {
-    for( int i = 0; i < d_rows.size(); i++ )
-    {
-        if( d_rows[i].d_sym->tok().d_lineNr == line && d_rows[i].d_sym->tok().d_colNr <= col )
-            return createIndex( i+1, 0, (quint32)i+1 );
-    }
+    // the closest symbol on the line which starts at or before col
+    buildLookup();
+    Pos p;
+    p.d_line = line;
+    p.d_col = col;
+    QVector<Pos>::const_iterator i = std::upper_bound( d_byPos.constBegin(), d_byPos.constEnd(), p );
+    if( i != d_byPos.constBegin() && (i-1)->d_line == line )
+        return createIndex( (i-1)->d_row + 1, 0 );
     return QModelIndex();
 }
 
@@ -84,7 +88,7 @@ QModelIndex OutlineMdl1::index(int row, int column, const QModelIndex& parent) c
     if( parent.isValid() || row < 0 )
         return QModelIndex();
 
-    return createIndex( row, column, (quint32)row );
+    return createIndex( row, column );
 }
 
 QModelIndex OutlineMdl1::parent(const QModelIndex& index) const
@@ -111,7 +115,7 @@ QVariant OutlineMdl1::data(const QModelIndex& index, int role) const
     if( !index.isValid() || d_crm == 0 )
         return QVariant();
 
-    const int id = index.internalId();
+    const int id = index.row();
     if( id == 0 )
     {
         switch (role)
@@ -162,10 +166,81 @@ void OutlineMdl1::onCrmUpdated(const QString& file)
 {
     if( file != d_file )
         return;
-    beginResetModel();
-    d_rows.clear();
+
+    // Both lists are sorted by name; merge them and only report the rows which actually come or go.
+    // Rows which stay get the new symbol; their display only changes if the instance type changed.
+    QList<Slot> rows;
+    rows.swap( d_rows );
     fillTop();
-    endResetModel();
+    QList<Slot> news;
+    news.swap( d_rows );
+    d_rows.swap( rows );
+
+    const bool wasEmpty = d_rows.isEmpty();
+    int pos = 0;
+    int j = 0;
+    while( pos < d_rows.size() || j < news.size() )
+    {
+        if( pos < d_rows.size() && ( j >= news.size() || d_rows[pos] < news[j] ) )
+        {
+            int end = pos + 1;
+            while( end < d_rows.size() && ( j >= news.size() || d_rows[end] < news[j] ) )
+                end++;
+            beginRemoveRows( QModelIndex(), pos + 1, end ); // +1 wegen <no symbol>
+            d_rows.erase( d_rows.begin() + pos, d_rows.begin() + end );
+            endRemoveRows();
+        }else if( j < news.size() && ( pos >= d_rows.size() || news[j] < d_rows[pos] ) )
+        {
+            int end = j + 1;
+            while( end < news.size() && ( pos >= d_rows.size() || news[end] < d_rows[pos] ) )
+                end++;
+            beginInsertRows( QModelIndex(), pos + 1, pos + end - j );
+            for( int k = j; k < end; k++ )
+                d_rows.insert( pos + k - j, news[k] );
+            endInsertRows();
+            pos += end - j;
+            j = end;
+        }else
+        {
+            Slot& old = d_rows[pos];
+            const bool changed = old.d_name != news[j].d_name ||
+                    old.d_sym->tok().d_type != news[j].d_sym->tok().d_type;
+            old = news[j];
+            if( changed )
+            {
+                const QModelIndex i = createIndex( pos + 1, 0 );
+                emit dataChanged( i, i );
+            }
+            pos++;
+            j++;
+        }
+    }
+    d_lookupValid = false;
+    if( wasEmpty != d_rows.isEmpty() )
+    {
+        const QModelIndex i = createIndex( 0, 0 );
+        emit dataChanged( i, i );
+    }
+    emit sigUpdated();
+}
+
+void OutlineMdl1::buildLookup()
+{
+    if( d_lookupValid )
+        return;
+    d_rowOf.clear();
+    d_rowOf.reserve( d_rows.size() );
+    d_byPos.resize( d_rows.size() );
+    for( int i = 0; i < d_rows.size(); i++ )
+    {
+        const CrossRefModel::Symbol* s = d_rows[i].d_sym.constData();
+        d_rowOf.insert( s, i );
+        d_byPos[i].d_line = s->tok().d_lineNr;
+        d_byPos[i].d_col = s->tok().d_colNr;
+        d_byPos[i].d_row = i;
+    }
+    std::stable_sort( d_byPos.begin(), d_byPos.end() );
+    d_lookupValid = true;
 }
 
 void OutlineMdl1::fillTop()
@@ -196,7 +271,7 @@ void OutlineMdl1::fillTop()
             d_rows.append( s );
         }
     }
-    std::sort( d_rows.begin(), d_rows.end() );
+    std::stable_sort( d_rows.begin(), d_rows.end() ); // equal names keep document order for onCrmUpdated
 }
 
 void OutlineMdl1::fillSubs( const CrossRefModel::Branch* b, const QByteArray& name)
@@ -237,12 +312,14 @@ void OutlineMdl2::setFile(const QString& f)
     if( d_file == f )
         return;
     beginResetModel();
-    d_root = Slot();
+    qDeleteAll( d_root.d_children );
+    d_root.d_children.clear();
+    d_byPos.clear();
     if( d_crm )
         disconnect( d_crm, SIGNAL(sigFileUpdated(QString)), this, SLOT( onCrmUpdated(QString) ) );
     d_file = f;
     d_crm = ModelManager::instance()->getModelForCurrentProjectOrDirPath(f);
-    fillTop();
+    fillTop( &d_root );
     if( d_crm )
         connect( d_crm, SIGNAL(sigFileUpdated(QString)), this, SLOT( onCrmUpdated(QString) ) );
     endResetModel();
@@ -259,7 +336,21 @@ const CrossRefModel::Symbol*OutlineMdl2::getSymbol(const QModelIndex& index) con
 
 QModelIndex OutlineMdl2::findSymbol(quint32 line, quint16 col)
 {
-    return findSymbol( &d_root, line, col );
+    if( d_byPos.isEmpty() )
+    {
+        buildLookup( &d_root );
+        std::stable_sort( d_byPos.begin(), d_byPos.end() );
+    }
+    Pos p;
+    p.d_line = line;
+    p.d_col = col;
+    QVector<Pos>::const_iterator i = std::upper_bound( d_byPos.constBegin(), d_byPos.constEnd(), p );
+    if( i != d_byPos.constBegin() && (i-1)->d_line == line )
+    {
+        Slot* s = (i-1)->d_slot;
+        return createIndex( s->d_parent->d_children.indexOf(s), 0, s );
+    }
+    return QModelIndex();
 }
 
 QVariant OutlineMdl2::data(const QModelIndex& index, int role) const
@@ -348,13 +439,13 @@ void OutlineMdl2::onCrmUpdated(const QString& file)
 {
     if( file != d_file )
         return;
-    beginResetModel();
-    d_root = Slot();
-    fillTop();
-    endResetModel();
+    Slot root;
+    fillTop( &root );
+    merge( QModelIndex(), &d_root, &root );
+    d_byPos.clear();
 }
 
-void OutlineMdl2::fillTop()
+void OutlineMdl2::fillTop(Slot* root)
 {
     if( d_crm == 0 )
         return;
@@ -364,23 +455,95 @@ void OutlineMdl2::fillTop()
 
     foreach( const CrossRefModel::SymRef& sym, globals )
     {
-        fill( &d_root, sym.data(), i );
+        fill( root, sym.data(), i );
     }
 }
 
-QModelIndex OutlineMdl2::findSymbol(OutlineMdl2::Slot* slot, quint32 line, quint16 col) const
+static inline QPair<int,QByteArray> slotKey( const CrossRefModel::Symbol* sym )
+{
+    return qMakePair( int(sym->tok().d_type), sym->tok().d_val );
+}
+
+static inline QByteArray slotType( const CrossRefModel::Symbol* sym )
+{
+    if( sym->tok().d_type == SynTree::R_module_or_udp_instance_ )
+        return sym->toBranch()->super()->tok().d_val;
+    else
+        return QByteArray();
+}
+
+void OutlineMdl2::merge(const QModelIndex& parent, Slot* old, Slot* news)
 {
-    for( int i = 0; i < slot->d_children.size(); i++ )
+    // Children are matched in document order by kind and name. Existing slots (and thus the expansion
+    // and selection state of the view) are kept and get the new symbol; slots without counterpart are
+    // removed and new ones are moved over from the fresh tree. Counting the keys still to come avoids
+    // searching ahead, so the work is linear in the number of children.
+    typedef QPair<int,QByteArray> Key;
+    QHash<Key,int> newLeft;
+    foreach( Slot* s, news->d_children )
+        newLeft[ slotKey( s->d_sym.constData() ) ]++;
+
+    int i = 0;
+    for( int j = 0; j < news->d_children.size(); j++ )
     {
-        Slot* s = slot->d_children[i];
-        if( s->d_sym->tok().d_lineNr == line && s->d_sym->tok().d_colNr <= col )
-            return createIndex( i, 0, s );
-        QModelIndex index = findSymbol( s, line, col );
-        if( index.isValid() )
-            return index;
+        Slot* n = news->d_children[j];
+        const Key nk = slotKey( n->d_sym.constData() );
+        // drop the old slots which are not needed anymore
+        int end = i;
+        while( end < old->d_children.size() )
+        {
+            const Key ok = slotKey( old->d_children[end]->d_sym.constData() );
+            if( ok == nk || newLeft.value(ok) > 0 )
+                break;
+            end++;
+        }
+        if( end > i )
+        {
+            beginRemoveRows( parent, i, end - 1 );
+            for( int k = i; k < end; k++ )
+                delete old->d_children.takeAt(i);
+            endRemoveRows();
+        }
+        newLeft[nk]--;
+        if( i < old->d_children.size() && slotKey( old->d_children[i]->d_sym.constData() ) == nk )
+        {
+            Slot* o = old->d_children[i];
+            const bool changed = slotType( o->d_sym.constData() ) != slotType( n->d_sym.constData() );
+            o->d_sym = n->d_sym;
+            const QModelIndex index = createIndex( i, 0, o );
+            if( changed )
+                emit dataChanged( index, index );
+            merge( index, o, n );
+        }else
+        {
+            beginInsertRows( parent, i, i );
+            news->d_children[j] = 0; // now owned by old
+            n->d_parent = old;
+            old->d_children.insert( i, n );
+            endInsertRows();
+        }
+        i++;
     }
-    return QModelIndex();
+    if( i < old->d_children.size() )
+    {
+        beginRemoveRows( parent, i, old->d_children.size() - 1 );
+        while( old->d_children.size() > i )
+            delete old->d_children.takeLast();
+        endRemoveRows();
+    }
+}
 
+void OutlineMdl2::buildLookup(OutlineMdl2::Slot* slot)
+{
+    foreach( Slot* s, slot->d_children )
+    {
+        Pos p;
+        p.d_line = s->d_sym->tok().d_lineNr;
+        p.d_col = s->d_sym->tok().d_colNr;
+        p.d_slot = s;
+        d_byPos.append( p );
+        buildLookup( s );
+    }
 }
 
 void OutlineMdl2::fill(Slot* super, const CrossRefModel::Symbol* sym , QListIterator<CrossRefModel::Section>& sec)
@@ -21,6 +21,8 @@
 */
 
 #include <QAbstractItemModel>
+#include <QHash>
+#include <QVector>
 #include <Verilog/VlCrossRefModel.h>
 
 namespace Vl
@@ -45,6 +47,9 @@ namespace Vl
         QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const;
         Qt::ItemFlags flags(const QModelIndex &index) const;
 
+    signals:
+        void sigUpdated();
+
     protected slots:
         void onCrmUpdated(const QString&);
 
@@ -59,7 +64,20 @@ namespace Vl
             QByteArray d_name;
             bool operator<( const Slot& rhs ) const { return qstricmp( d_name, rhs.d_name ) < 0; }
         };
+        struct Pos
+        {
+            quint32 d_line;
+            quint16 d_col;
+            int d_row;
+            bool operator<( const Pos& rhs ) const
+                { return d_line < rhs.d_line || ( d_line == rhs.d_line && d_col < rhs.d_col ); }
+        };
+        void buildLookup();
         QList<Slot> d_rows;
+        // lookup indices for the cursor sync; rebuilt on demand after the rows changed
+        QHash<const CrossRefModel::Symbol*,int> d_rowOf;
+        QVector<Pos> d_byPos;
+        bool d_lookupValid;
         QString d_file;
         CrossRefModel* d_crm;
     };
@@ -95,9 +113,19 @@ namespace Vl
             ~Slot() { foreach( Slot* s, d_children ) delete s; }
         };
         void fill(Slot* super, const CrossRefModel::Symbol* sym, QListIterator<CrossRefModel::Section>&);
-        void fillTop();
-        QModelIndex findSymbol(Slot*, quint32 line, quint16 col ) const;
+        void fillTop(Slot* root);
+        void merge(const QModelIndex& parent, Slot* old, Slot* news);
+        struct Pos
+        {
+            quint32 d_line;
+            quint16 d_col;
+            Slot* d_slot;
+            bool operator<( const Pos& rhs ) const
+                { return d_line < rhs.d_line || ( d_line == rhs.d_line && d_col < rhs.d_col ); }
+        };
+        void buildLookup(Slot*);
         Slot d_root;
+        QVector<Pos> d_byPos; // all slots sorted by position; empty if it needs to be rebuilt
         QString d_file;
         CrossRefModel* d_crm;
     };
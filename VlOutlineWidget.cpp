@@ -42,6 +42,7 @@ OutlineWidget::OutlineWidget(EditorWidget1 *parent) : TextEditor::IOutlineWidget
     const QString fileName = parent->textDocument()->filePath().toString();
     d_tree->setModel(d_mdl);
     connect(d_mdl,SIGNAL(modelReset()), d_tree, SLOT(expandAll()) );
+    connect(d_mdl,SIGNAL(rowsInserted(QModelIndex,int,int)), this, SLOT(onRowsInserted(QModelIndex,int,int)) );
     d_mdl->setFile(fileName);
 
     connect(d_tree, SIGNAL(activated(QModelIndex)), this, SLOT(onItemActivated(QModelIndex)));
@@ -99,6 +100,21 @@ void OutlineWidget::onGotoSymbol(quint32 line, quint16 col)
     d_blockCursorSync = false;
 }
 
+void OutlineWidget::onRowsInserted(const QModelIndex& parent, int first, int last)
+{
+    // the model only reports what changed; new subtrees are shown expanded like after a reset
+    for( int i = first; i <= last; i++ )
+        expand( d_mdl->index( i, 0, parent ) );
+}
+
+void OutlineWidget::expand(const QModelIndex& index)
+{
+    d_tree->expand( index );
+    const int count = d_mdl->rowCount( index );
+    for( int i = 0; i < count; i++ )
+        expand( d_mdl->index( i, 0, index ) );
+}
+
 bool OutlineWidgetFactory::supportsEditor(Core::IEditor* editor) const
 {
     if (qobject_cast<Editor1*>(editor))
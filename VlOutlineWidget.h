@@ -50,7 +50,9 @@ namespace Vl
     protected slots:
         void onItemActivated(QModelIndex);
         void onGotoSymbol( quint32 line, quint16 col );
+        void onRowsInserted( const QModelIndex& parent, int first, int last );
     private:
+        void expand( const QModelIndex& );
         EditorWidget1* d_edit;
         OutlineTreeView* d_tree;
         OutlineMdl2* d_mdl;
@@ -23,6 +23,7 @@
 #include "VlVerilogEditor.h"
 #include "VlProjectEditor.h"
 #include "VlSdfEditor.h"
+#include "VlLargeFileViewer.h"
 #include "VlModelManager.h"
 #include "VlConfigurationFactory.h"
 #include "VlProject.h"
@@ -30,12 +31,15 @@
 #include "VlModuleLocator.h"
 #include "VlCompletionAssistProvider.h"
 #include "VlSymbolLocator.h"
+#include "VlHierarchyLocator.h"
+#include "VlMappedFiles.h"
 #include <coreplugin/icore.h>
 #include <coreplugin/icontext.h>
 #include <coreplugin/actionmanager/actionmanager.h>
 #include <coreplugin/actionmanager/command.h>
 #include <coreplugin/actionmanager/actioncontainer.h>
 #include <coreplugin/coreconstants.h>
+#include <coreplugin/messagemanager.h>
 #include <projectexplorer/taskhub.h>
 #include <projectexplorer/projecttree.h>
 #include <texteditor/texteditorsettings.h>
@@ -89,9 +93,11 @@ bool VerilogCreatorPlugin::initialize(const QStringList &arguments, QString *err
     addAutoReleasedObject(new Vl::EditorFactory1);
     addAutoReleasedObject(new Vl::EditorFactory2);
     addAutoReleasedObject(new Vl::EditorFactory3);
+    addAutoReleasedObject(new Vl::LargeFileEditorFactory); // after the others, so it is only the fallback
     addAutoReleasedObject(new Vl::OutlineWidgetFactory);
     addAutoReleasedObject(new Vl::ModuleLocator);
     addAutoReleasedObject(new Vl::SymbolLocator);
+    addAutoReleasedObject(new Vl::HierarchyLocator);
     addAutoReleasedObject(new Vl::ProjectManager);
     addAutoReleasedObject(new Vl::MakeStepFactory);
     addAutoReleasedObject(new Vl::BuildConfigurationFactory);
@@ -130,6 +136,18 @@ bool VerilogCreatorPlugin::initialize(const QStringList &arguments, QString *err
     contextMenu1->addAction(cmd);
     toolsMenu->addAction(cmd);
 
+    d_sdfDelays = new QAction(tr("Show SDF Delays"), this);
+    cmd = Core::ActionManager::registerAction(d_sdfDelays, Vl::Constants::SdfDelaysCmd, context);
+    connect(d_sdfDelays, SIGNAL(triggered()), this, SLOT(onShowSdfDelays()));
+    contextMenu1->addAction(cmd);
+    toolsMenu->addAction(cmd);
+
+    d_cacheStats = new QAction(tr("Show File Cache Statistics"), this);
+    cmd = Core::ActionManager::registerAction(d_cacheStats, Vl::Constants::CacheStatsCmd,
+                                              Core::Context(Core::Constants::C_GLOBAL));
+    connect(d_cacheStats, SIGNAL(triggered()), this, SLOT(onCacheStats()));
+    toolsMenu->addAction(cmd);
+
     Core::Command *sep = contextMenu1->addSeparator();
 
     cmd = Core::ActionManager::command(TextEditor::Constants::AUTO_INDENT_SELECTION);
@@ -185,6 +203,18 @@ void VerilogCreatorPlugin::onReloadProject()
     }
 }
 
+void VerilogCreatorPlugin::onCacheStats()
+{
+    const Vl::MappedFiles::Stats s = Vl::ModelManager::instance()->getMappedFiles()->getStats();
+    Core::MessageManager::write( Vl::MappedFiles::toString(s), Core::MessageManager::ModeSwitch );
+}
+
+void VerilogCreatorPlugin::onShowSdfDelays()
+{
+    if (Vl::EditorWidget1 *editorWidget = currentEditorWidget())
+        editorWidget->onShowSdfDelays();
+}
+
 Vl::EditorWidget1*VerilogCreatorPlugin::currentEditorWidget()
 {
     return qobject_cast<Vl::EditorWidget1*>(Core::EditorManager::currentEditor()->widget());
@@ -49,6 +49,8 @@ namespace VerilogCreator {
             void onFindUsages();
             void onGotoOuterBlock();
             void onReloadProject();
+            void onCacheStats();
+            void onShowSdfDelays();
 
         protected:
             Vl::EditorWidget1* currentEditorWidget();
@@ -58,6 +60,8 @@ namespace VerilogCreator {
             QAction* d_findUsagesAction;
             QAction* d_gotoOuterBlockAction;
             QAction* d_reloadProject;
+            QAction* d_cacheStats;
+            QAction* d_sdfDelays;
         };
 
     } // namespace Internal
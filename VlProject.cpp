@@ -20,12 +20,14 @@
 #include "VlProject.h"
 #include "VlProjectManager.h"
 #include "VlModelManager.h"
+#include "VlCodeIndex.h"
 #include <Verilog/VlProjectConfig.h>
 #include "VlConstants.h"
 #include <Verilog/VlCrossRefModel.h>
 #include <Verilog/VlIncludes.h>
 #include <Verilog/VlPpSymbols.h>
 #include <Verilog/VlErrors.h>
+#include <Verilog/VlSynTree.h>
 #include <texteditor/textdocument.h>
 #include <projectexplorer/projectnodes.h>
 #include <projectexplorer/kit.h>
@@ -34,6 +36,8 @@
 #include <projectexplorer/runconfiguration.h>
 #include <coreplugin/icontext.h>
 #include <utils/mimetypes/mimedatabase.h>
+#include <QSet>
+#include <QFileInfo>
 
 namespace Vl
 {
@@ -111,16 +115,133 @@ QStringList Project::files(Project::FilesMode) const
     return d_config.getSrcFiles() + d_config.getLibFiles();
 }
 
+static void collectInstantiated( const CrossRefModel::Branch* b, QList<QByteArray>& res )
+{
+    foreach( const CrossRefModel::SymRef& sub, b->children() )
+    {
+        const CrossRefModel::Branch* b2 = sub->toBranch();
+        if( sub->tok().d_type == SynTree::R_module_or_udp_instance_ && b2 && b2->super() )
+            res.append( b2->super()->tok().d_val );
+        if( b2 )
+            collectInstantiated( b2, res );
+    }
+}
+
+QStringList Project::getIncludePath() const
+{
+    QStringList dirs;
+    foreach( const QString& d, getIncDirs() )
+        dirs.append( d.trimmed() );
+    foreach( const QString& f, getSrcFiles() + getLibFiles() )
+        dirs.append( QFileInfo(f).path() );
+    QStringList res;
+    QSet<QString> seen;
+    foreach( const QString& d, dirs )
+    {
+        if( !seen.contains(d) )
+        {
+            seen.insert(d);
+            res.append(d);
+        }
+    }
+    return res;
+}
+
+QStringList Project::getSdfFiles() const
+{
+    QStringList res;
+    foreach( const QString& f, d_config.getOtherFiles() )
+    {
+        if( f.endsWith( QLatin1String(".sdf"), Qt::CaseInsensitive ) )
+            res.append(f);
+    }
+    return res;
+}
+
+static QStringList filterUsed( CrossRefModel* mdl, const QSet<QString>& used, const QStringList& files )
+{
+    QStringList res;
+    foreach( const QString& f, files )
+    {
+        if( used.contains(f) )
+        {
+            res.append(f);
+            continue;
+        }
+        // the tree of f also holds what f `includes (transitively); d_sourcePath then names the include
+        bool includesUsed = false;
+        bool hasModule = false;
+        foreach( const CrossRefModel::SymRef& sym, mdl->getGlobalSyms(f) )
+        {
+            if( used.contains( sym->tok().d_sourcePath ) )
+            {
+                includesUsed = true;
+                break;
+            }
+            if( sym->tok().d_type == SynTree::R_module_declaration ||
+                    sym->tok().d_type == SynTree::R_udp_declaration )
+                hasModule = true;
+        }
+        // files without modules (e.g. global defines) are kept, they might be needed in the compilation order
+        if( includesUsed || !hasModule )
+            res.append(f);
+    }
+    return res;
+}
+
+QSet<QString> Project::getUsedDecls(CrossRefModel* mdl) const
+{
+    // the files declaring the modules reachable from the tops
+    QSet<QString> used;
+    QSet<QByteArray> seen;
+    QList<QByteArray> todo;
+    foreach( const QString& top, getTopMod().split( QRegExp("\\s+"), QString::SkipEmptyParts ) )
+        todo.append( top.toLatin1() );
+    while( !todo.isEmpty() )
+    {
+        const QByteArray name = todo.takeLast();
+        if( seen.contains(name) )
+            continue;
+        seen.insert(name);
+        CrossRefModel::SymRef decl = mdl->findGlobal( name );
+        if( decl.constData() == 0 )
+            continue; // primitive or unknown; the tool will tell
+        used.insert( decl->tok().d_sourcePath );
+        if( decl->toBranch() )
+            collectInstantiated( decl->toBranch(), todo );
+    }
+    return used;
+}
+
+QStringList Project::getUsedFiles(const QStringList& files) const
+{
+    CrossRefModel* mdl = ModelManager::instance()->getModelForFile( projectFilePath().toString() );
+    if( mdl == 0 )
+        return files;
+    const QSet<QString> used = getUsedDecls( mdl );
+    if( used.isEmpty() )
+        return files; // TOPMOD not set or not found; don't make it worse
+    return filterUsed( mdl, used, files );
+}
+
+void Project::getUsedFiles(QStringList& srcFiles, QStringList& libFiles) const
+{
+    CrossRefModel* mdl = ModelManager::instance()->getModelForFile( projectFilePath().toString() );
+    if( mdl == 0 )
+        return;
+    const QSet<QString> used = getUsedDecls( mdl );
+    if( used.isEmpty() )
+        return;
+    srcFiles = filterUsed( mdl, used, srcFiles );
+    libFiles = filterUsed( mdl, used, libFiles );
+}
+
 void Project::loadProject(const QString& fileName)
 {
     d_root->removeFolderNodes( d_root->subFolderNodes() );
     d_root->removeFileNodes( d_root->fileNodes() );
 
     CrossRefModel* mdl = ModelManager::instance()->getModelForFile(fileName);
-    mdl->clear();
-    mdl->getIncs()->clear();
-    mdl->getSyms()->clear();
-    mdl->getErrs()->clear();
 
     d_root->addFileNodes(QList<ProjectExplorer::FileNode*>() <<
                          new ProjectExplorer::FileNode(Utils::FileName::fromString(fileName),
@@ -133,7 +254,14 @@ void Project::loadProject(const QString& fileName)
     d_root->addFolderNodes(QList<ProjectExplorer::FolderNode*>() << sourceFolder);
 
     if( !d_config.loadFromFile(fileName) )
+    {
+        mdl->clear();
+        ModelManager::instance()->getIndex(mdl)->clear();
+        mdl->getIncs()->clear();
+        mdl->getSyms()->clear();
+        mdl->getErrs()->clear();
         return; // TODO: Error Message
+    }
 
     const QString oldCur = QDir::currentPath();
     QDir::setCurrent(QFileInfo(fileName).path());
@@ -148,6 +276,13 @@ void Project::loadProject(const QString& fileName)
     }
     QDir::setCurrent(oldCur);
 
+    // everything is parsed again; `included files and other dependencies of the sources may have changed
+    mdl->clear();
+    ModelManager::instance()->getIndex(mdl)->clear();
+    mdl->getIncs()->clear();
+    mdl->getSyms()->clear();
+    mdl->getErrs()->clear();
+    ModelManager::instance()->reportProgress( mdl, d_config.getSrcFiles().size() + d_config.getLibFiles().size() );
     d_config.setup( mdl );
 
     Utils::MimeDatabase db;
@@ -23,6 +23,7 @@
 #include <projectexplorer/project.h>
 
 #include <QFileSystemWatcher>
+#include <QSet>
 #include <Verilog/VlProjectConfig.h>
 
 namespace TextEditor { class TextDocument; }
@@ -32,6 +33,7 @@ namespace Vl
 {
     class ProjectManager;
     class ProjectNode;
+    class CrossRefModel;
 
     class Project : public ProjectExplorer::Project
     {
@@ -45,7 +47,12 @@ namespace Vl
         const QStringList& getLibFiles() const { return d_config.getLibFiles(); }
         QStringList getConfig( const QString& key ) const { return d_config.getConfig(key); }
         QStringList getIncDirs() const { return d_config.getIncDirs(); }
+        QStringList getIncludePath() const; // INCDIRS, then the directories of the source and library files
         QString getTopMod() const { return d_config.getTopMod(); }
+        // the files which declare or `include modules reachable from TOPMOD, or no modules at all; in the given order
+        QStringList getUsedFiles( const QStringList& files ) const;
+        void getUsedFiles( QStringList& srcFiles, QStringList& libFiles ) const; // prunes both in one go
+        QStringList getSdfFiles() const; // the OTHER_FILES with suffix .sdf
         void reload();
 
         // overrides
@@ -57,6 +64,7 @@ namespace Vl
     protected:
         void loadProject( const QString& fileName );
         static void fillNode( const QStringList& files, ProjectExplorer::FolderNode* );
+        QSet<QString> getUsedDecls( CrossRefModel* ) const;
 
         RestoreResult fromMap(const QVariantMap &map, QString *errorMessage) Q_DECL_OVERRIDE;
     protected slots:
@@ -1,8 +1,10 @@
 #include "VlSdfEditor.h"
 #include "VlConstants.h"
 #include "VlIndenter.h"
+#include "VlLargeFileViewer.h"
 #include <Sdf/SdfLexer.h>
 #include <QApplication>
+#include <QFileInfo>
 #include <texteditor/texteditoractionhandler.h>
 #include <texteditor/texteditorsettings.h>
 #include <texteditor/textdocumentlayout.h>
@@ -52,6 +54,19 @@ EditorDocument3::EditorDocument3()
     setId(Constants::EditorId3);
 }
 
+TextEditor::TextDocument::OpenResult EditorDocument3::open(QString* errorString, const QString& fileName,
+                                                           const QString& realFileName)
+{
+    if( LargeFileDocument::isLarge(realFileName) )
+    {
+        if( errorString )
+            *errorString = tr("%1 is too large for the Sdf Editor; open it with the %2.")
+                .arg(QFileInfo(fileName).fileName()).arg(QLatin1String(Constants::LargeFileDisplayName));
+        return OpenResult::CannotHandle;
+    }
+    return TextDocument::open(errorString, fileName, realFileName);
+}
+
 
 void EditorWidget3::contextMenuEvent(QContextMenuEvent* e)
 {
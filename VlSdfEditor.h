@@ -47,6 +47,9 @@ namespace Vl
         Q_OBJECT
     public:
         EditorDocument3();
+
+        // overrides
+        TextDocument::OpenResult open(QString *errorString, const QString &fileName, const QString &realFileName);
     };
 
     class EditorWidget3 : public TextEditor::TextEditorWidget
@@ -0,0 +1,737 @@
+/*
+* Copyright 2019 Rochus Keller <mailto:me@rochus-keller.ch>
+*
+* This file is part of the VerilogCreator plugin.
+*
+* The following is the license that applies to this copy of the
+* plugin. For a license to use the plugin under conditions
+* other than those described here, please email to me@rochus-keller.ch.
+*
+* GNU General Public License Usage
+* This file may be used under the terms of the GNU General Public
+* License (GPL) versions 2.0 or 3.0 as published by the Free Software
+* Foundation and appearing in the file LICENSE.GPL included in
+* the packaging of this file. Please review the following information
+* to ensure GNU General Public Licensing requirements will be met:
+* http://www.fsf.org/licensing/licenses/info/GPLv2.html and
+* http://www.gnu.org/copyleft/gpl.html.
+*/
+
+#include "VlSdfIndex.h"
+#include <QDataStream>
+#include <QDateTime>
+#include <QFile>
+#include <QFileInfo>
+#include <QFutureInterfaceBase>
+#include <QSaveFile>
+#include <QVector>
+#include <QtDebug>
+#include <algorithm>
+#include <limits>
+#ifdef Q_OS_UNIX
+#include <sys/mman.h>
+#endif
+using namespace Vl;
+
+static const quint32 s_magic = 0x53444658; // SDFX
+static const quint16 s_version = 2;
+static const char* s_suffix = ".sdfidx";
+static const int s_progressShift = 20; // progress is reported in MB
+static const qint64 s_checkEvery = 64 * 1024 * 1024;
+static const int s_fan = 64; // entries per block of the range maxima
+
+namespace
+{
+enum Keyword { K_Other, K_Cell, K_CellType, K_Instance, K_Divider, K_Timescale, K_IoPath, K_Interconnect };
+
+static inline bool isSpace( char c )
+{
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f' || c == '\v';
+}
+
+static inline bool is( const char* str, int len, const char* kw )
+{
+    return int(qstrlen(kw)) == len && qstrnicmp( str, kw, len ) == 0;
+}
+
+static Keyword keyword( const char* str, int len )
+{
+    if( is( str, len, "CELL" ) )
+        return K_Cell;
+    if( is( str, len, "CELLTYPE" ) )
+        return K_CellType;
+    if( is( str, len, "INSTANCE" ) )
+        return K_Instance;
+    if( is( str, len, "IOPATH" ) )
+        return K_IoPath;
+    if( is( str, len, "INTERCONNECT" ) )
+        return K_Interconnect;
+    if( is( str, len, "DIVIDER" ) )
+        return K_Divider;
+    if( is( str, len, "TIMESCALE" ) )
+        return K_Timescale;
+    return K_Other;
+}
+
+// The position of the last divider in a path like u1/u2/a or u1/u\/2; -1 if there is none
+static int lastDivider( const char* str, int len, char div )
+{
+    int pos = len - 1;
+    while( pos >= 0 && !( str[pos] == div && ( pos == 0 || str[pos-1] != '\\' ) ) )
+        pos--;
+    return pos;
+}
+
+// The largest number in a delay value like 0.1, 0.1:0.2:0.3 or ::0.3; -1 if there is none
+static float maxValue( const char* str, int len )
+{
+    float res = -1;
+    int start = 0;
+    for( int i = 0; i <= len; i++ )
+    {
+        if( i == len || str[i] == ':' )
+        {
+            if( i > start )
+            {
+                bool ok;
+                const float v = QByteArray::fromRawData( str + start, i - start ).toFloat(&ok);
+                if( ok && v > res )
+                    res = v;
+            }
+            start = i + 1;
+        }
+    }
+    return res;
+}
+
+// Splits the SDF text into parentheses and atoms; strings are returned as atoms without the quotes.
+// Comments are skipped, newlines are counted.
+class Scanner
+{
+public:
+    enum Tok { Eof, Lpar, Rpar, Atom };
+    const char* d_atom;
+    int d_len;
+    qint64 d_pos;
+    quint32 d_line;
+
+    Scanner( const char* data, qint64 size ):d_atom(0),d_len(0),d_pos(0),d_line(1),d_data(data),d_size(size){}
+
+    Tok next()
+    {
+        while( d_pos < d_size )
+        {
+            const char c = d_data[d_pos];
+            if( c == '\n' )
+            {
+                d_line++;
+                d_pos++;
+            }else if( isSpace(c) )
+                d_pos++;
+            else if( c == '(' )
+            {
+                d_pos++;
+                return Lpar;
+            }else if( c == ')' )
+            {
+                d_pos++;
+                return Rpar;
+            }else if( c == '/' && peek(1) == '/' )
+            {
+                while( d_pos < d_size && d_data[d_pos] != '\n' )
+                    d_pos++;
+            }else if( c == '/' && peek(1) == '*' )
+            {
+                d_pos += 2;
+                while( d_pos < d_size && !( d_data[d_pos] == '*' && peek(1) == '/' ) )
+                {
+                    if( d_data[d_pos] == '\n' )
+                        d_line++;
+                    d_pos++;
+                }
+                d_pos += 2;
+            }else if( c == '"' )
+            {
+                const qint64 start = ++d_pos;
+                while( d_pos < d_size && d_data[d_pos] != '"' )
+                {
+                    if( d_data[d_pos] == '\\' )
+                        d_pos++;
+                    else if( d_data[d_pos] == '\n' )
+                        d_line++;
+                    d_pos++;
+                }
+                setAtom( start );
+                d_pos++;
+                return Atom;
+            }else
+            {
+                const qint64 start = d_pos;
+                while( d_pos < d_size && !isSpace(d_data[d_pos]) && d_data[d_pos] != '(' && d_data[d_pos] != ')' )
+                {
+                    if( d_data[d_pos] == '\\' )
+                        d_pos++; // escaped identifier character like \/ or \[
+                    d_pos++;
+                }
+                setAtom( start );
+                return Atom;
+            }
+        }
+        return Eof;
+    }
+private:
+    inline char peek( int off ) const { return d_pos + off < d_size ? d_data[d_pos + off] : 0; }
+    inline void setAtom( qint64 start )
+    {
+        d_atom = d_data + start;
+        d_len = int( qMin( d_pos, d_size ) - start );
+    }
+    const char* d_data;
+    qint64 d_size;
+};
+}
+
+SdfIndex::SdfIndex():d_divider(".")
+{
+
+}
+
+void SdfIndex::clear()
+{
+    d_names.clear();
+    d_types.clear();
+    d_entries.clear();
+    d_byLeaf.clear();
+    d_max.clear();
+}
+
+SdfIndex* SdfIndex::open(const QString& sdfPath, QFutureInterfaceBase* fi)
+{
+    SdfIndex* idx = new SdfIndex();
+    if( idx->load( sdfPath ) )
+        return idx;
+    if( !idx->scan( sdfPath, fi ) )
+    {
+        delete idx;
+        return 0;
+    }
+    if( !idx->save() )
+        qWarning() << "SdfIndex: cannot write" << cachePathFor(sdfPath);
+    return idx;
+}
+
+bool SdfIndex::scan(const QString& sdfPath, QFutureInterfaceBase* fi)
+{
+    clear();
+    d_divider = "."; // the default if there is no DIVIDER in the header
+    d_timescale.clear();
+    d_path = sdfPath;
+
+    QFile f(sdfPath);
+    if( !f.open(QIODevice::ReadOnly) )
+        return false;
+    const qint64 size = f.size();
+    if( size == 0 )
+        return true;
+    uchar* mem = f.map( 0, size );
+    if( mem == 0 )
+        return false; // no fallback; the files in question don't fit into memory
+#ifdef Q_OS_UNIX
+    ::madvise( mem, size, MADV_SEQUENTIAL );
+#endif
+    if( fi )
+        fi->setProgressRange( 0, int( size >> s_progressShift ) );
+
+    Scanner s( (const char*)mem, size );
+    QVector<quint8> stack; // the keyword of each open list
+    bool first = false;    // the next atom is the keyword of the list just opened
+    qint64 lparPos = 0;
+    quint32 lparLine = 0;
+    int cellDepth = -1;
+    Cell cell;
+    QByteArray inst;
+    int entryDepth = -1;   // of the IOPATH or INTERCONNECT being read
+    int argNr = 0;
+    float entryWorst = -1;
+    qint64 entryPos = 0;
+    quint32 entryLine = 0;
+    QByteArray target;
+    Cells cells;
+    Cells interconnects; // by the instance they end at
+    qint64 nextCheck = s_checkEvery;
+    bool canceled = false;
+
+    for(;;)
+    {
+        const Scanner::Tok t = s.next();
+        if( t == Scanner::Eof )
+            break;
+        if( s.d_pos >= nextCheck )
+        {
+            nextCheck += s_checkEvery;
+            if( fi )
+            {
+                fi->setProgressValue( int( s.d_pos >> s_progressShift ) );
+                if( fi->isCanceled() )
+                {
+                    canceled = true;
+                    break;
+                }
+            }
+        }
+        if( t == Scanner::Lpar )
+        {
+            stack.append( K_Other );
+            first = true;
+            lparPos = s.d_pos - 1;
+            lparLine = s.d_line;
+            continue;
+        }
+        if( t == Scanner::Rpar )
+        {
+            first = false;
+            if( stack.isEmpty() )
+                continue; // unbalanced; tolerated
+            const int depth = stack.size() - 1;
+            const quint8 k = stack.takeLast();
+            if( depth == entryDepth )
+            {
+                if( k == K_IoPath )
+                {
+                    cell.d_iopaths++;
+                    cell.d_worst = qMax( cell.d_worst, entryWorst );
+                }else
+                {
+                    // the target port is e.g. u1/u2/a or u1/u2/a[3]; the instance is everything up to the last divider
+                    const int pos = lastDivider( target.constData(), target.size(), divider() );
+                    Cell& c = interconnects[ pos < 0 ? QByteArray() : target.left(pos) ];
+                    if( c.d_line == 0 )
+                    {
+                        c.d_offset = entryPos;
+                        c.d_line = entryLine;
+                    }
+                    c.d_interconnects++;
+                    c.d_worst = qMax( c.d_worst, entryWorst );
+                }
+                entryDepth = -1;
+            }else if( depth == cellDepth )
+            {
+                addCell( cells, inst, cell );
+                cellDepth = -1;
+            }
+            continue;
+        }
+
+        // Atom
+        if( first )
+        {
+            first = false;
+            const Keyword k = keyword( s.d_atom, s.d_len );
+            stack.last() = k;
+            if( entryDepth != -1 )
+                entryWorst = qMax( entryWorst, maxValue( s.d_atom, s.d_len ) ); // e.g. (0.1:0.2:0.3)
+            else if( k == K_Cell )
+            {
+                cellDepth = stack.size() - 1;
+                cell = Cell();
+                cell.d_offset = lparPos;
+                cell.d_line = lparLine;
+                inst.clear();
+            }else if( k == K_IoPath || k == K_Interconnect )
+            {
+                entryDepth = stack.size() - 1;
+                argNr = 0;
+                entryWorst = -1;
+                entryPos = lparPos;
+                entryLine = lparLine;
+                target.clear();
+            }
+            continue;
+        }
+        const int depth = stack.size() - 1;
+        if( entryDepth != -1 )
+        {
+            if( depth == entryDepth )
+            {
+                if( stack[entryDepth] == K_Interconnect && argNr == 1 )
+                    target = QByteArray( s.d_atom, s.d_len );
+                argNr++;
+            }else
+                entryWorst = qMax( entryWorst, maxValue( s.d_atom, s.d_len ) );
+            continue;
+        }
+        switch( depth < 0 ? K_Other : stack.last() )
+        {
+        case K_CellType:
+            cell.d_type = QByteArray( s.d_atom, s.d_len );
+            break;
+        case K_Instance:
+            inst = QByteArray( s.d_atom, s.d_len ); // "*" stands for all instances of the cell type
+            break;
+        case K_Divider:
+            if( s.d_len > 0 )
+                d_divider = QByteArray( s.d_atom, s.d_len );
+            break;
+        case K_Timescale:
+            d_timescale += QByteArray( s.d_atom, s.d_len ); // either "1ns" or "1 ns"
+            break;
+        default:
+            break;
+        }
+    }
+    f.unmap(mem);
+    if( canceled )
+        return false;
+
+    Cells::const_iterator i;
+    for( i = interconnects.begin(); i != interconnects.end(); ++i )
+        addCell( cells, i.key(), i.value() );
+    return build( cells );
+}
+
+void SdfIndex::addCell(Cells& cells, const QByteArray& instPath, const SdfIndex::Cell& cell)
+{
+    Cells::iterator i = cells.find(instPath);
+    if( i == cells.end() )
+    {
+        cells.insert( instPath, cell );
+        return;
+    }
+    // e.g. a separate CELL entry for the timing checks, or interconnects of a cell; the first entry is the location
+    Cell& c = i.value();
+    if( c.d_type.isEmpty() )
+        c.d_type = cell.d_type;
+    if( cell.d_offset < c.d_offset )
+    {
+        c.d_offset = cell.d_offset;
+        c.d_line = cell.d_line;
+    }
+    c.d_iopaths += cell.d_iopaths;
+    c.d_interconnects += cell.d_interconnects;
+    c.d_worst = qMax( c.d_worst, cell.d_worst );
+}
+
+namespace
+{
+// orders entry indices by the last element of their path
+struct LeafLess
+{
+    const char* d_names;
+    const quint32* d_leafs;
+    LeafLess( const char* names, const quint32* leafs ):d_names(names),d_leafs(leafs){}
+    bool operator()( quint32 a, quint32 b ) const
+    {
+        return qstrcmp( d_names + d_leafs[a], d_names + d_leafs[b] ) < 0;
+    }
+};
+}
+
+bool SdfIndex::build(const Cells& cells)
+{
+    QList<QByteArray> paths = cells.keys();
+    std::sort( paths.begin(), paths.end() );
+    qint64 size = 0;
+    foreach( const QByteArray& p, paths )
+        size += p.size() + 1;
+    if( size >= std::numeric_limits<int>::max() )
+    {
+        qWarning() << "SdfIndex: the instance paths of" << d_path << "exceed 2 GB";
+        return false;
+    }
+    d_names.reserve( int(size) );
+    d_entries.resize( paths.size() );
+    QHash<QByteArray,quint32> types;
+    const char div = divider();
+    for( int n = 0; n < paths.size(); n++ )
+    {
+        const QByteArray& p = paths[n];
+        const Cell& c = cells.find(p).value();
+        Entry& e = d_entries[n];
+        e.d_path = d_names.size();
+        e.d_leaf = e.d_path + lastDivider( p.constData(), p.size(), div ) + 1;
+        QHash<QByteArray,quint32>::const_iterator t = types.find( c.d_type );
+        if( t == types.end() )
+        {
+            t = types.insert( c.d_type, d_types.size() );
+            d_types.append( c.d_type );
+        }
+        e.d_type = t.value();
+        e.d_line = c.d_line;
+        e.d_offset = c.d_offset;
+        e.d_iopaths = c.d_iopaths;
+        e.d_interconnects = c.d_interconnects;
+        e.d_worst = c.d_worst;
+        d_names.append( p );
+        d_names.append( char(0) );
+    }
+
+    d_byLeaf.resize( d_entries.size() );
+    QVector<quint32> leafs( d_entries.size() );
+    for( int n = 0; n < d_byLeaf.size(); n++ )
+    {
+        d_byLeaf[n] = n;
+        leafs[n] = d_entries[n].d_leaf;
+    }
+    // stable, so equal names stay in path order
+    std::stable_sort( d_byLeaf.begin(), d_byLeaf.end(), LeafLess( d_names.constData(), leafs.constData() ) );
+    buildMax();
+    return true;
+}
+
+void SdfIndex::buildMax()
+{
+    d_max.clear();
+    const int n = d_entries.size();
+    if( n <= s_fan )
+        return;
+    QVector<float> level( ( n + s_fan - 1 ) / s_fan, -1 );
+    for( int i = 0; i < n; i++ )
+        level[i / s_fan] = qMax( level[i / s_fan], d_entries[i].d_worst );
+    d_max.append( level );
+    while( level.size() > s_fan )
+    {
+        QVector<float> up( ( level.size() + s_fan - 1 ) / s_fan, -1 );
+        for( int i = 0; i < level.size(); i++ )
+            up[i / s_fan] = qMax( up[i / s_fan], level[i] );
+        d_max.append( up );
+        level = up;
+    }
+}
+
+bool SdfIndex::load(const QString& sdfPath)
+{
+    clear();
+    d_path = sdfPath;
+    QFile f( cachePathFor(sdfPath) );
+    if( !f.open(QIODevice::ReadOnly) || f.size() == 0 )
+        return false;
+    const QFileInfo info(sdfPath);
+
+    const qint64 size = f.size();
+    uchar* mem = f.map( 0, size );
+    QByteArray buf;
+    if( mem )
+        buf = QByteArray::fromRawData( (const char*)mem, size );
+    else
+        buf = f.readAll();
+
+    QDataStream in( buf );
+    in.setVersion(QDataStream::Qt_5_0);
+    in.setFloatingPointPrecision(QDataStream::SinglePrecision);
+    quint32 magic;
+    quint16 version;
+    qint64 sdfSize, sdfModified;
+    quint32 count;
+    in >> magic >> version;
+    bool ok = magic == s_magic && version == s_version;
+    if( ok )
+    {
+        in >> sdfSize >> sdfModified;
+        ok = sdfSize == info.size() && sdfModified == info.lastModified().toMSecsSinceEpoch();
+    }
+    if( ok )
+    {
+        in >> d_divider >> d_timescale >> d_types >> d_names >> count;
+        if( d_divider.isEmpty() )
+            d_divider = ".";
+        d_entries.resize( in.status() == QDataStream::Ok ? count : 0 );
+        for( quint32 n = 0; n < quint32(d_entries.size()) && in.status() == QDataStream::Ok; n++ )
+        {
+            Entry& e = d_entries[n];
+            in >> e.d_path >> e.d_leaf >> e.d_type >> e.d_line >> e.d_offset >> e.d_iopaths
+               >> e.d_interconnects >> e.d_worst;
+            if( e.d_path >= quint32(d_names.size()) || e.d_leaf >= quint32(d_names.size()) ||
+                    e.d_type >= quint32(d_types.size()) )
+                in.setStatus( QDataStream::ReadCorruptData );
+        }
+        in >> d_byLeaf;
+        ok = in.status() == QDataStream::Ok && d_byLeaf.size() == d_entries.size();
+        for( int n = 0; ok && n < d_byLeaf.size(); n++ )
+            ok = d_byLeaf[n] < quint32(d_entries.size());
+        if( !ok )
+            qWarning() << "SdfIndex: corrupt index file" << f.fileName();
+    }
+    if( mem )
+        f.unmap(mem);
+    if( ok )
+        buildMax();
+    else
+        clear();
+    return ok;
+}
+
+bool SdfIndex::save() const
+{
+    const QFileInfo info(d_path);
+    QSaveFile f( cachePathFor(d_path) );
+    if( !f.open(QIODevice::WriteOnly) )
+        return false;
+    QDataStream out( &f );
+    out.setVersion(QDataStream::Qt_5_0);
+    out.setFloatingPointPrecision(QDataStream::SinglePrecision);
+    out << s_magic << s_version << qint64(info.size()) << qint64(info.lastModified().toMSecsSinceEpoch())
+        << d_divider << d_timescale << d_types << d_names << quint32(d_entries.size());
+    foreach( const Entry& e, d_entries )
+        out << e.d_path << e.d_leaf << e.d_type << e.d_line << e.d_offset << e.d_iopaths
+            << e.d_interconnects << e.d_worst;
+    out << d_byLeaf;
+    return f.commit();
+}
+
+int SdfIndex::lowerBound(const QByteArray& path) const
+{
+    int from = 0;
+    int to = d_entries.size();
+    while( from < to )
+    {
+        const int mid = from + ( to - from ) / 2;
+        if( qstrcmp( pathOf(mid), path.constData() ) < 0 )
+            from = mid + 1;
+        else
+            to = mid;
+    }
+    return from;
+}
+
+int SdfIndex::find(const QByteArray& path) const
+{
+    const int i = lowerBound( path );
+    if( i < d_entries.size() && qstrcmp( pathOf(i), path.constData() ) == 0 )
+        return i;
+    return -1;
+}
+
+SdfIndex::Cell SdfIndex::getCell(const QByteArray& instPath) const
+{
+    Cell c;
+    const int i = find( instPath );
+    if( i == -1 )
+        return c;
+    const Entry& e = d_entries[i];
+    c.d_type = d_types[e.d_type];
+    c.d_offset = e.d_offset;
+    c.d_line = e.d_line;
+    c.d_iopaths = e.d_iopaths;
+    c.d_interconnects = e.d_interconnects;
+    c.d_worst = e.d_worst;
+    return c;
+}
+
+void SdfIndex::leafRange(const QByteArray& name, int& from, int& to) const
+{
+    // lower and upper bound of the name in d_byLeaf
+    from = 0;
+    int hi = d_byLeaf.size();
+    while( from < hi )
+    {
+        const int mid = from + ( hi - from ) / 2;
+        if( qstrcmp( leafOf( d_byLeaf[mid] ), name.constData() ) < 0 )
+            from = mid + 1;
+        else
+            hi = mid;
+    }
+    to = from;
+    hi = d_byLeaf.size();
+    while( to < hi )
+    {
+        const int mid = to + ( hi - to ) / 2;
+        if( qstrcmp( leafOf( d_byLeaf[mid] ), name.constData() ) <= 0 )
+            to = mid + 1;
+        else
+            hi = mid;
+    }
+}
+
+QList<QByteArray> SdfIndex::findByName(const QByteArray& instName, int max) const
+{
+    QList<QByteArray> res;
+    int from, to;
+    leafRange( instName, from, to );
+    for( int i = from; i < to && res.size() < max; i++ )
+        res.append( QByteArray( pathOf( d_byLeaf[i] ) ) );
+    return res;
+}
+
+QList<QByteArray> SdfIndex::findByPath(const QList<QByteArray>& elements, int max) const
+{
+    QList<QByteArray> res;
+    if( elements.isEmpty() )
+        return res;
+    const char div = divider();
+    QByteArray tail;
+    foreach( const QByteArray& e, elements )
+    {
+        if( !tail.isEmpty() )
+            tail += div;
+        tail += e;
+    }
+    int from, to;
+    leafRange( elements.last(), from, to );
+    for( int i = from; i < to && res.size() < max; i++ )
+    {
+        const char* path = pathOf( d_byLeaf[i] );
+        const int len = int( qstrlen( path ) );
+        const int start = len - tail.size();
+        if( start < 0 || ( start > 0 && path[start-1] != div ) )
+            continue;
+        if( ::memcmp( path + start, tail.constData(), tail.size() ) == 0 )
+            res.append( QByteArray( path, len ) );
+    }
+    return res;
+}
+
+float SdfIndex::valueAt(int level, int i) const
+{
+    return level < 0 ? d_entries[i].d_worst : d_max[level][i];
+}
+
+float SdfIndex::rangeMax(int from, int to) const
+{
+    // the blocks of d_max cover the middle of the range; only the ends are looked at one by one
+    float res = -1;
+    int level = -1;
+    qint64 size = 1;
+    qint64 lo = from;
+    qint64 hi = to;
+    while( lo < hi )
+    {
+        const qint64 next = size * s_fan;
+        const qint64 a = ( lo + next - 1 ) / next * next;
+        const qint64 b = hi / next * next;
+        if( level + 1 < d_max.size() && a < b )
+        {
+            for( ; lo < a; lo += size )
+                res = qMax( res, valueAt( level, int( lo / size ) ) );
+            for( ; hi > b; hi -= size )
+                res = qMax( res, valueAt( level, int( ( hi - size ) / size ) ) );
+            level++;
+            size = next;
+        }else
+        {
+            for( ; lo < hi; lo += size )
+                res = qMax( res, valueAt( level, int( lo / size ) ) );
+        }
+    }
+    return res;
+}
+
+float SdfIndex::getWorstDelay(const QByteArray& instPath) const
+{
+    if( instPath.isEmpty() )
+        return rangeMax( 0, d_entries.size() );
+    float res = -1;
+    const int i = find( instPath );
+    if( i != -1 )
+        res = d_entries[i].d_worst;
+    // the paths below the instance are the ones starting with instPath + divider; they are adjacent
+    QByteArray prefix = instPath + divider();
+    const int from = lowerBound( prefix );
+    prefix[prefix.size()-1] = prefix[prefix.size()-1] + 1;
+    const int to = lowerBound( prefix );
+    return qMax( res, rangeMax( from, to ) );
+}
+
+QString SdfIndex::cachePathFor(const QString& sdfPath)
+{
+    return sdfPath + s_suffix;
+}
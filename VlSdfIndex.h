@@ -0,0 +1,111 @@
+#ifndef VLSDFINDEX_H
+#define VLSDFINDEX_H
+
+/*
+* Copyright 2019 Rochus Keller <mailto:me@rochus-keller.ch>
+*
+* This file is part of the VerilogCreator plugin.
+*
+* The following is the license that applies to this copy of the
+* plugin. For a license to use the plugin under conditions
+* other than those described here, please email to me@rochus-keller.ch.
+*
+* GNU General Public License Usage
+* This file may be used under the terms of the GNU General Public
+* License (GPL) versions 2.0 or 3.0 as published by the Free Software
+* Foundation and appearing in the file LICENSE.GPL included in
+* the packaging of this file. Please review the following information
+* to ensure GNU General Public Licensing requirements will be met:
+* http://www.fsf.org/licensing/licenses/info/GPLv2.html and
+* http://www.gnu.org/copyleft/gpl.html.
+*/
+
+#include <QHash>
+#include <QStringList>
+#include <QVector>
+
+class QFutureInterfaceBase;
+
+namespace Vl
+{
+    // Compact index of a Standard Delay Format file from cell instance path to the location of its CELL entry
+    // and the delays annotated to it. The file is scanned once, straight from the mapping and without building
+    // tokens or a syntax tree, so files of several GB can be indexed; the index is cached in <file>.sdfidx and
+    // reused as long as size and modification time of the SDF file don't change.
+    // The paths are kept sorted in one block of memory; lookups by path, by a path suffix and of the worst
+    // delay below an instance are binary searches, so they are cheap enough for the GUI thread.
+    class SdfIndex
+    {
+    public:
+        struct Cell
+        {
+            QByteArray d_type;      // CELLTYPE
+            quint64 d_offset;       // of the "(CELL"
+            quint32 d_line;         // 1-based line of the "(CELL"
+            quint32 d_iopaths;
+            quint32 d_interconnects; // ending at a port of this instance
+            float d_worst;          // largest IOPATH or INTERCONNECT delay value; -1 if there are none
+            Cell():d_offset(0),d_line(0),d_iopaths(0),d_interconnects(0),d_worst(-1){}
+        };
+
+        SdfIndex();
+
+        // loads the cached index if it is still valid, otherwise scans the file and writes the cache;
+        // returns 0 if the file cannot be read or the future was canceled
+        static SdfIndex* open( const QString& sdfPath, QFutureInterfaceBase* = 0 );
+
+        bool scan( const QString& sdfPath, QFutureInterfaceBase* = 0 );
+        bool load( const QString& sdfPath );
+        bool save() const;
+
+        const QString& getPath() const { return d_path; }
+        const QByteArray& getDivider() const { return d_divider; }
+        const QByteArray& getTimescale() const { return d_timescale; }
+        int getCellCount() const { return d_entries.size(); }
+        bool contains( const QByteArray& instPath ) const { return find(instPath) != -1; }
+        Cell getCell( const QByteArray& instPath ) const;
+        // paths whose last element is the name; sorted, at most max of them
+        QList<QByteArray> findByName( const QByteArray& instName, int max ) const;
+        // paths ending with the elements, e.g. {"u_core","u_alu"} finds "dut/u_core/u_alu"; sorted, at most max
+        QList<QByteArray> findByPath( const QList<QByteArray>& elements, int max ) const;
+        float getWorstDelay( const QByteArray& instPath ) const; // through the instance and all below it
+
+        static QString cachePathFor( const QString& sdfPath );
+    private:
+        struct Entry
+        {
+            quint32 d_path;  // offset in d_names
+            quint32 d_leaf;  // offset of the last path element in d_names
+            quint32 d_type;  // index in d_types
+            quint32 d_line;
+            quint64 d_offset;
+            quint32 d_iopaths;
+            quint32 d_interconnects;
+            float d_worst;
+        };
+        typedef QHash<QByteArray,Cell> Cells;
+        static void addCell( Cells&, const QByteArray& instPath, const Cell& );
+        bool build( const Cells& );
+        void buildMax();
+        char divider() const { return d_divider.isEmpty() ? '.' : d_divider[0]; }
+        const char* pathOf( int i ) const { return d_names.constData() + d_entries[i].d_path; }
+        const char* leafOf( quint32 i ) const { return d_names.constData() + d_entries[i].d_leaf; }
+        int lowerBound( const QByteArray& path ) const;
+        int find( const QByteArray& path ) const;
+        void leafRange( const QByteArray& name, int& from, int& to ) const;
+        float valueAt( int level, int i ) const;
+        float rangeMax( int from, int to ) const;
+        void clear();
+
+        QString d_path;
+        QByteArray d_divider;
+        QByteArray d_timescale;
+        QByteArray d_names;            // all paths in sorted order, each terminated by a 0
+        QList<QByteArray> d_types;     // the distinct CELLTYPEs
+        QVector<Entry> d_entries;      // in the order of d_names
+        QVector<quint32> d_byLeaf;     // indices of d_entries sorted by the last path element, then by path
+        QList<QVector<float> > d_max;  // d_max[l][i] is the largest d_worst of the i-th block of 64^(l+1) entries
+    };
+}
+
+#endif // VLSDFINDEX_H
@@ -0,0 +1,252 @@
+/*
+* Copyright 2019 Rochus Keller <mailto:me@rochus-keller.ch>
+*
+* This file is part of the VerilogCreator plugin.
+*
+* The following is the license that applies to this copy of the
+* plugin. For a license to use the plugin under conditions
+* other than those described here, please email to me@rochus-keller.ch.
+*
+* GNU General Public License Usage
+* This file may be used under the terms of the GNU General Public
+* License (GPL) versions 2.0 or 3.0 as published by the Free Software
+* Foundation and appearing in the file LICENSE.GPL included in
+* the packaging of this file. Please review the following information
+* to ensure GNU General Public Licensing requirements will be met:
+* http://www.fsf.org/licensing/licenses/info/GPLv2.html and
+* http://www.gnu.org/copyleft/gpl.html.
+*/
+
+#include "VlSymbolIndex.h"
+#include "VlCodeIndex.h"
+#include <QSet>
+#include <algorithm>
+using namespace Vl;
+
+SymbolIndex::SymbolIndex(bool withScopes):d_mdl(0),d_generation(0),d_valid(false),d_withScopes(withScopes)
+{
+}
+
+bool SymbolIndex::update(CrossRefModel* mdl, CodeIndex* index, QFutureInterfaceBase& future)
+{
+    QMutexLocker lock(&d_lock);
+    const int gen = index ? index->getGeneration() : 0;
+    if( d_valid && d_mdl == mdl && d_generation == gen )
+        return true;
+
+    QSet<QString> changed;
+    const bool incremental = d_valid && d_mdl == mdl && index != 0 &&
+            index->getUpdatedSince( d_generation, changed );
+    d_valid = false;
+    d_mdl = mdl;
+    d_generation = gen;
+    if( mdl == 0 )
+    {
+        d_parts.clear();
+        return true;
+    }
+
+    QHash<QString,CrossRefModel::IdentDeclRefList> globals;
+    if( incremental )
+    {
+        foreach( const QString& file, changed )
+            globals[file] = mdl->getGlobalNames(file); // empty if the file is gone
+    }else
+    {
+        d_parts.clear();
+        foreach( const CrossRefModel::IdentDeclRef& id, mdl->getGlobalNames() )
+            globals[id->tok().d_sourcePath].append(id);
+    }
+    QHash<QString,CrossRefModel::IdentDeclRefList>::const_iterator i;
+    for( i = globals.begin(); i != globals.end(); ++i )
+    {
+        if( future.isCanceled() )
+            return false; // d_valid stays false, so the next update starts over
+        d_parts.remove( i.key() );
+        if( !i.value().isEmpty() )
+            build( d_parts[i.key()], i.value() );
+    }
+    d_valid = true;
+    return true;
+}
+
+void SymbolIndex::build(SymbolIndex::Part& p, const CrossRefModel::IdentDeclRefList& globals) const
+{
+    foreach( const CrossRefModel::IdentDeclRef& id, globals )
+    {
+        add( p, id.constData(), QString() );
+        const CrossRefModel::Scope* s = d_withScopes ? id->decl()->toScope() : 0;
+        if( s )
+        {
+            const QString scope = p.d_entries.last().d_name;
+            foreach( const CrossRefModel::IdentDeclRef& id2, s->getNames() )
+                add( p, id2.constData(), scope );
+        }
+    }
+    for( int i = 0; i < p.d_lower.size(); i++ )
+    {
+        const QString& l = p.d_lower[i];
+        for( int j = 0; j + 3 <= l.size(); j++ )
+        {
+            QVector<int>& post = p.d_trigrams[ trigram( l.constData() + j ) ];
+            if( post.isEmpty() || post.last() != i ) // a name may contain a trigram more than once
+                post.append(i);
+        }
+        p.d_initials.append( qMakePair( initials( p.d_entries[i].d_name ), i ) );
+    }
+    std::sort( p.d_initials.begin(), p.d_initials.end() );
+}
+
+static bool lessThan( const QPair<int,SymbolIndex::Entry>& lhs, const QPair<int,SymbolIndex::Entry>& rhs )
+{
+    if( lhs.first != rhs.first )
+        return lhs.first < rhs.first;
+    if( lhs.second.d_name.size() != rhs.second.d_name.size() )
+        return lhs.second.d_name.size() < rhs.second.d_name.size();
+    const int c = lhs.second.d_name.compare( rhs.second.d_name, Qt::CaseInsensitive );
+    if( c != 0 )
+        return c < 0;
+    return lhs.second.d_scope.compare( rhs.second.d_scope, Qt::CaseInsensitive ) < 0;
+}
+
+SymbolIndex::EntryList SymbolIndex::find(const QString& query, const QString& file, QFutureInterfaceBase& future) const
+{
+    QMutexLocker lock(&d_lock);
+    const QString q = query.toLower();
+    QList<QPair<int,Entry> > sorted;
+    if( !file.isEmpty() )
+    {
+        QHash<QString,Part>::const_iterator i = d_parts.find(file);
+        if( i != d_parts.end() )
+            find( i.value(), q, sorted );
+    }else
+    {
+        int n = 0;
+        for( QHash<QString,Part>::const_iterator i = d_parts.begin(); i != d_parts.end(); ++i, ++n )
+        {
+            if( ( n & 0xff ) == 0 && future.isCanceled() )
+                return EntryList();
+            find( i.value(), q, sorted );
+        }
+    }
+    std::sort( sorted.begin(), sorted.end(), lessThan );
+    EntryList res;
+    res.reserve( sorted.size() );
+    for( int i = 0; i < sorted.size(); i++ )
+        res.append( sorted[i].second );
+    return res;
+}
+
+void SymbolIndex::find(const SymbolIndex::Part& p, const QString& q, QList<QPair<int,Entry> >& res) const
+{
+    QVector<int> cands;
+    if( q.size() >= 3 )
+    {
+        // intersect the posting lists, shortest first
+        QList<const QVector<int>*> posts;
+        for( int j = 0; j + 3 <= q.size(); j++ )
+        {
+            QHash<quint64,QVector<int> >::const_iterator i = p.d_trigrams.find( trigram( q.constData() + j ) );
+            if( i == p.d_trigrams.end() )
+            {
+                posts.clear();
+                break;
+            }
+            posts.append( &i.value() );
+        }
+        if( !posts.isEmpty() )
+        {
+            std::sort( posts.begin(), posts.end(),
+                       []( const QVector<int>* a, const QVector<int>* b ) { return a->size() < b->size(); } );
+            cands = *posts.first();
+            for( int i = 1; i < posts.size() && !cands.isEmpty(); i++ )
+            {
+                QVector<int> tmp;
+                std::set_intersection( cands.begin(), cands.end(), posts[i]->begin(), posts[i]->end(),
+                                       std::back_inserter(tmp) );
+                cands.swap(tmp);
+            }
+        }
+    }else
+    {
+        cands.reserve( p.d_lower.size() );
+        for( int i = 0; i < p.d_lower.size(); i++ )
+            cands.append(i);
+    }
+
+    QHash<int,int> hits;
+    foreach( int i, cands )
+    {
+        const int s = score( p.d_entries[i].d_name, p.d_lower[i], q );
+        if( s != NoMatch )
+            hits[i] = s;
+    }
+    if( !q.isEmpty() )
+    {
+        QVector<QPair<QString,int> >::const_iterator i =
+                std::lower_bound( p.d_initials.begin(), p.d_initials.end(), qMakePair( q, -1 ) );
+        for( ; i != p.d_initials.end() && i->first.startsWith(q); ++i )
+        {
+            QHash<int,int>::iterator h = hits.find( i->second );
+            if( h == hits.end() )
+                hits.insert( i->second, Initials );
+            else if( h.value() > Initials )
+                h.value() = Initials;
+        }
+    }
+    for( QHash<int,int>::const_iterator i = hits.begin(); i != hits.end(); ++i )
+        res.append( qMakePair( i.value(), p.d_entries[i.key()] ) );
+}
+
+void SymbolIndex::clear()
+{
+    QMutexLocker lock(&d_lock);
+    d_valid = false;
+    d_mdl = 0;
+    d_parts.clear();
+}
+
+void SymbolIndex::add(SymbolIndex::Part& p, const CrossRefModel::IdentDecl* id, const QString& scope) const
+{
+    Entry e;
+    e.d_name = QString::fromLatin1( id->tok().d_val );
+    e.d_scope = scope;
+    e.d_file = id->tok().d_sourcePath;
+    e.d_declType = id->decl()->tok().d_type;
+    e.d_sym = CrossRefModel::SymRef(id);
+    p.d_entries.append(e);
+    p.d_lower.append( e.d_name.toLower() );
+}
+
+QString SymbolIndex::initials(const QString& name)
+{
+    QString res;
+    for( int i = 0; i < name.size(); i++ )
+    {
+        const QChar c = name[i];
+        if( c == '_' || c == '$' )
+            continue;
+        if( i == 0 || name[i-1] == '_' || name[i-1] == '$' || ( c.isUpper() && name[i-1].isLower() ) )
+            res += c.toLower();
+    }
+    return res;
+}
+
+quint64 SymbolIndex::trigram(const QChar* s)
+{
+    return ( quint64(s[0].unicode()) << 32 ) | ( quint64(s[1].unicode()) << 16 ) | quint64(s[2].unicode());
+}
+
+int SymbolIndex::score(const QString& name, const QString& lower, const QString& q)
+{
+    if( q.isEmpty() )
+        return Substring;
+    const int pos = lower.indexOf(q);
+    if( pos == -1 )
+        return NoMatch;
+    if( pos == 0 )
+        return lower.size() == q.size() ? Exact : Prefix;
+    if( name[pos-1] == '_' || name[pos-1] == '$' || ( name[pos].isUpper() && name[pos-1].isLower() ) )
+        return WordStart;
+    return Substring;
+}
@@ -0,0 +1,84 @@
+#ifndef VLSYMBOLINDEX_H
+#define VLSYMBOLINDEX_H
+
+/*
+* Copyright 2019 Rochus Keller <mailto:me@rochus-keller.ch>
+*
+* This file is part of the VerilogCreator plugin.
+*
+* The following is the license that applies to this copy of the
+* plugin. For a license to use the plugin under conditions
+* other than those described here, please email to me@rochus-keller.ch.
+*
+* GNU General Public License Usage
+* This file may be used under the terms of the GNU General Public
+* License (GPL) versions 2.0 or 3.0 as published by the Free Software
+* Foundation and appearing in the file LICENSE.GPL included in
+* the packaging of this file. Please review the following information
+* to ensure GNU General Public Licensing requirements will be met:
+* http://www.fsf.org/licensing/licenses/info/GPLv2.html and
+* http://www.gnu.org/copyleft/gpl.html.
+*/
+
+#include <QMutex>
+#include <QVector>
+#include <QFutureInterfaceBase>
+#include <Verilog/VlCrossRefModel.h>
+
+namespace Vl
+{
+    class CodeIndex;
+
+    // Name index for the locator filters. Substring queries are answered by intersecting the trigram
+    // posting lists of the query; in addition a query matches the word initials of a name, where words
+    // are separated by '_' or a lower/upper case transition (e.g. "cdr" finds clk_div_reg, ClkDivReg).
+    // The index is split per file of the global declarations; after a model update only the parts of the
+    // reparsed files are rebuilt. Thread-safe.
+    class SymbolIndex
+    {
+    public:
+        struct Entry
+        {
+            QString d_name;
+            QString d_scope; // name of the enclosing module, empty for globals
+            QString d_file; // where the name is declared; scope names may come from an included file
+            int d_declType;
+            CrossRefModel::SymRef d_sym;
+        };
+        typedef QList<Entry> EntryList;
+
+        explicit SymbolIndex( bool withScopes );
+
+        // returns false if canceled; the index then stays invalid. The CodeIndex of the model tells which
+        // files were reparsed since the last update; the caller resolves it in the GUI thread.
+        bool update( CrossRefModel*, CodeIndex*, QFutureInterfaceBase& );
+        // sorted by relevance; empty file means all files, otherwise the globals declared in file and their
+        // scope names
+        EntryList find( const QString& query, const QString& file, QFutureInterfaceBase& ) const;
+        void clear();
+    private:
+        enum Score { Exact, Prefix, WordStart, Initials, Substring, NoMatch };
+        struct Part // of one file
+        {
+            QVector<Entry> d_entries;
+            QVector<QString> d_lower;
+            QHash<quint64,QVector<int> > d_trigrams; // posting lists are ascending
+            QVector<QPair<QString,int> > d_initials; // sorted
+        };
+        void build( Part&, const CrossRefModel::IdentDeclRefList& ) const;
+        void add( Part&, const CrossRefModel::IdentDecl*, const QString& scope ) const;
+        void find( const Part&, const QString& q, QList<QPair<int,Entry> >& ) const;
+        static QString initials( const QString& );
+        static quint64 trigram( const QChar* );
+        static int score( const QString& name, const QString& lower, const QString& q );
+
+        mutable QMutex d_lock;
+        CrossRefModel* d_mdl;
+        int d_generation;
+        bool d_valid;
+        bool d_withScopes;
+        QHash<QString,Part> d_parts; // file of the global declaration -> part
+    };
+}
+
+#endif // VLSYMBOLINDEX_H
@@ -19,11 +19,15 @@
 
 #include "VlSymbolLocator.h"
 #include "VlModelManager.h"
+#include "VlCodeIndex.h"
 #include <Verilog/VlSynTree.h>
 #include <coreplugin/editormanager/editormanager.h>
 using namespace Vl;
 
-SymbolLocator::SymbolLocator()
+SymbolLocator::SymbolLocator():d_index(true),
+    d_iMod(QPixmap(":/verilogcreator/images/block.png")),
+    d_iVar(QPixmap(":/verilogcreator/images/var.png")),
+    d_iFunc(QPixmap(":/verilogcreator/images/func.png"))
 {
     setId("VerilogSymbols");
     setDisplayName(tr("Verilog symbols in current document"));
@@ -31,78 +35,58 @@ SymbolLocator::SymbolLocator()
     setIncludedByDefault(false);
 }
 
-static bool lessThan(const Core::LocatorFilterEntry&s1, const Core::LocatorFilterEntry&s2)
+void SymbolLocator::prepareSearch(const QString&)
 {
-    return s1.displayName.compare( s2.displayName, Qt::CaseInsensitive ) < 0 ||
-            ( !(s2.displayName.compare( s1.displayName, Qt::CaseInsensitive ) < 0)
-              && s1.extraInfo.compare( s2.extraInfo, Qt::CaseInsensitive ) < 0 );
+    CrossRefModel* mdl = ModelManager::instance()->getModelForCurrentProject();
+    const QString file = Core::EditorManager::instance()->currentDocument() ?
+            Core::EditorManager::instance()->currentDocument()->filePath().toString() : QString();
+    QMutexLocker lock(&d_lock);
+    d_mdl = mdl;
+    d_codeIndex = ModelManager::instance()->getIndex(mdl);
+    d_file = file;
 }
 
 QList<Core::LocatorFilterEntry> SymbolLocator::matchesFor(QFutureInterface<Core::LocatorFilterEntry>& future, const QString& entry)
 {
-    Q_UNUSED(future);
-
     QList<Core::LocatorFilterEntry> res;
 
-    CrossRefModel* mdl = ModelManager::instance()->getModelForCurrentProject();
-    if( mdl == 0 )
+    d_lock.lock();
+    CrossRefModel* mdl = d_mdl;
+    CodeIndex* index = d_codeIndex;
+    const QString fileName = d_file;
+    d_lock.unlock();
+    if( mdl == 0 || fileName.isEmpty() )
         return res;
 
-    const QString fileName = Core::EditorManager::instance()->currentDocument() ?
-            Core::EditorManager::instance()->currentDocument()->filePath().toString() : QString();
-    if( fileName.isEmpty() )
+    if( !d_index.update( mdl, index, future ) )
         return res;
+    const SymbolIndex::EntryList l = d_index.find( entry, fileName, future );
 
-    CrossRefModel::IdentDeclRefList l = mdl->getGlobalNames();
-
-    QStringMatcher matcher(entry, Qt::CaseInsensitive); // ByteArrayMatcher is case sensitive instead
-
-    QPixmap iMod(":/verilogcreator/images/block.png");
-    QPixmap iVar(":/verilogcreator/images/var.png");
-    QPixmap iFunc(":/verilogcreator/images/func.png");
-
-    foreach(const CrossRefModel::IdentDeclRef& id, l )
+    foreach(const SymbolIndex::Entry& e, l )
     {
-        if( id->tok().d_sourcePath != fileName )
-            continue;
-
-        const QString name = QString::fromLatin1(id->tok().d_val);
-        if( matcher.indexIn( name ) != -1 )
+        if( future.isCanceled() )
+            break;
+        if( e.d_scope.isEmpty() )
         {
-            res << Core::LocatorFilterEntry( this, name, QVariant::fromValue(CrossRefModel::SymRef(id)),iMod);
-            res.back().extraInfo = QString("(%1)").arg( SynTree::rToStr( id->decl()->tok().d_type ) );
-        }
-        const CrossRefModel::Scope* s = id->decl()->toScope();
-        if( s )
+            res << Core::LocatorFilterEntry( this, e.d_name, QVariant::fromValue(e.d_sym), d_iMod);
+            res.back().extraInfo = QString("(%1)").arg( SynTree::rToStr( e.d_declType ) );
+        }else
         {
-            foreach( const CrossRefModel::IdentDeclRef& id2, s->getNames() )
+            QIcon icon;
+            switch(e.d_declType)
             {
-                const QString name2 = QString::fromLatin1(id2->tok().d_val);
-                if( matcher.indexIn( name2 ) != -1 )
-                {
-                    const int type = id2->decl()->tok().d_type;
-                    QPixmap icon;
-                    switch(type)
-                    {
-                    case SynTree::R_task_declaration:
-                    case SynTree::R_function_declaration:
-                        icon = iFunc;
-                        break;
-                    default:
-                        icon = iVar;
-                        break;
-                    }
-                    res << Core::LocatorFilterEntry( this, name2, QVariant::fromValue(CrossRefModel::SymRef(id2)), icon );
-//                    res << Core::LocatorFilterEntry( this, QString("%1.%2").arg(name).arg(name2),
-//                                                     QVariant::fromValue(CrossRefModel::SymRef(id2)), icon );
-                    res.back().extraInfo = QString("%1 (%2)").arg(name).arg( SynTree::rToStr( type ) );
-                    //res.back().extraInfo = QString("(%1)").arg( SynTree::rToStr( type ) );
-                }
+            case SynTree::R_task_declaration:
+            case SynTree::R_function_declaration:
+                icon = d_iFunc;
+                break;
+            default:
+                icon = d_iVar;
+                break;
             }
+            res << Core::LocatorFilterEntry( this, e.d_name, QVariant::fromValue(e.d_sym), icon );
+            res.back().extraInfo = QString("%1 (%2)").arg(e.d_scope).arg( SynTree::rToStr( e.d_declType ) );
         }
-
     }
-    std::sort( res.begin(), res.end(), lessThan );
     return res;
 }
 
@@ -115,6 +99,12 @@ void SymbolLocator::accept(Core::LocatorFilterEntry selection) const
 
 void SymbolLocator::refresh(QFutureInterface<void>& future)
 {
-    Q_UNUSED(future);
+    d_lock.lock();
+    CrossRefModel* mdl = d_mdl;
+    CodeIndex* index = d_codeIndex;
+    d_lock.unlock();
+    d_index.clear();
+    if( mdl )
+        d_index.update( mdl, index, future );
 }
 
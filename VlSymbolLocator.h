@@ -20,7 +20,11 @@
 * http://www.gnu.org/copyleft/gpl.html.
 */
 
+#include "VlSymbolIndex.h"
 #include <coreplugin/locator/ilocatorfilter.h>
+#include <QIcon>
+#include <QPointer>
+#include <QMutex>
 
 namespace Vl
 {
@@ -31,10 +35,19 @@ namespace Vl
         SymbolLocator();
 
         // overrides
+        void prepareSearch(const QString &entry);
         QList<Core::LocatorFilterEntry> matchesFor(QFutureInterface<Core::LocatorFilterEntry> &future,
                                                    const QString &entry);
         void accept(Core::LocatorFilterEntry selection) const;
         void refresh(QFutureInterface<void> &future);
+    private:
+        SymbolIndex d_index;
+        QIcon d_iMod, d_iVar, d_iFunc;
+        // matchesFor and refresh run in a worker; these are taken in prepareSearch in the GUI thread
+        QMutex d_lock; // guards the three below
+        QPointer<CrossRefModel> d_mdl;
+        QPointer<CodeIndex> d_codeIndex;
+        QString d_file;
     };
 }
 
@@ -20,6 +20,7 @@
 #include "VlTclConfiguration.h"
 #include "VlProject.h"
 #include "VlTclEngine.h"
+#include "VlModelManager.h"
 #include <projectexplorer/buildinfo.h>
 #include <projectexplorer/projectexplorerconstants.h>
 #include <projectexplorer/projectexplorer.h>
@@ -35,6 +36,8 @@
 #include <QLabel>
 #include <QLineEdit>
 #include <QPushButton>
+#include <QThread>
+#include <QtConcurrent/QtConcurrentRun>
 using namespace Vl;
 
 const char* TclBuildConfig::ID = "VerilogCreator.Tcl.BuildConfig";
@@ -134,16 +137,24 @@ void TclBuildConfigWidget::environmentChanged()
 }
 
 TclStep::TclStep(ProjectExplorer::BuildStepList* parent):
-    AbstractProcessStep(parent, ID),d_tcl(0)
+    AbstractProcessStep(parent, ID),d_fi(0)
 {
     setDefaultDisplayName(tr("Tcl") );
-    d_tcl = TclEngine::addRef();
+    connect( &d_watcher, SIGNAL(finished()), this, SLOT(onScriptFinished()) );
 }
 
 TclStep::~TclStep()
 {
-    if( d_tcl )
-        TclEngine::release();
+    if( d_fi == 0 )
+        return;
+    d_watcher.disconnect(this);
+    d_fi->cancel();
+    // the script might wait for get_vlpro_var, which is answered in this thread
+    while( d_watcher.isRunning() )
+    {
+        QCoreApplication::sendPostedEvents( this, QEvent::MetaCall );
+        QThread::msleep( 10 );
+    }
 }
 
 bool TclStep::init()
@@ -165,10 +176,10 @@ bool TclStep::init()
     Vl::Project* p = dynamic_cast<Vl::Project*>( project() );
     Q_ASSERT( p != 0 );
 
-    if( !d_tcl->isReady() )
+    if( !TclEngine::isAvailable() )
     {
         emit addTask(ProjectExplorer::Task(ProjectExplorer::Task::Error,
-                       tr( "The Tcl interpreter is not ready."),
+                       tr( "The Tcl library is not available."),
                        Utils::FileName(), -1,
                        ProjectExplorer::Constants::TASK_CATEGORY_BUILDSYSTEM) );
         return false;
@@ -219,31 +230,106 @@ void TclStep::run(QFutureInterface<bool>& fi)
 {
     processStarted();
 
-    Vl::Project* p = dynamic_cast<Vl::Project*>( project() );
-    d_tcl->setWriteLog(writeLog,this);
-    d_tcl->setGetVar(tclGetVar,p);
-    int res = 0;
-    if( !d_tcl->runFile( d_scriptFile ) )
-        res = -1;
-    d_tcl->setWriteLog(0,0);
-    d_tcl->setGetVar(0,0);
+    // The step runs in the GUI thread like every AbstractProcessStep; the script runs in a worker
+    // with a fresh interpreter, which is bound to that thread, and onScriptFinished() reports the result.
+    // Concurrent steps don't see each other's variables and procs.
+    d_fi = &fi;
+    d_watcher.setFuture( QtConcurrent::run( runScript, this, d_scriptFile, &fi ) );
+}
+
+TclStep::Result TclStep::runScript(TclStep* step, const QString& path, QFutureInterface<bool>* fi)
+{
+    Result r;
+    TclEngine tcl;
+    if( !tcl.isReady() )
+        return r;
+    r.d_ready = true;
+    tcl.setWriteLog(writeLog,step);
+    tcl.setGetVar(tclGetVar,step);
+    tcl.setIsCanceled(tclIsCanceled,fi);
+    tcl.setWithModel(tclWithModel,step);
+    if( !tcl.runFile( path ) )
+        r.d_code = -1;
+    r.d_canceled = tcl.wasCanceled();
+    r.d_result = tcl.getResult().trimmed();
+    return r;
+}
+
+void TclStep::onScriptFinished()
+{
+    QFutureInterface<bool>& fi = *d_fi;
+    d_fi = 0;
+    const Result r = d_watcher.result();
+    if( !r.d_ready )
+    {
+        emit addOutput(tr("The Tcl interpreter is not ready."), BuildStep::ErrorMessageOutput);
+        fi.reportResult(false);
+        emit finished();
+        return;
+    }
 
     // AbstractProcessStep::run(fi);
     // startet einen Prozess; wir machen das hier selber
 
     // processFinished( res, QProcess::NormalExit ); // uses m_process
-    QString str = d_tcl->getResult().trimmed();
+    if( r.d_canceled )
+    {
+        emit addOutput(tr("The script \"%1\" was canceled").arg(d_scriptFile), BuildStep::ErrorMessageOutput);
+        fi.reportResult(false);
+        emit finished();
+        return;
+    }
+    QString str = r.d_result;
     if( !str.isEmpty() )
         str = " : " + str;
-    emit addOutput(tr("The script \"%1\" exited with code %2%3").arg(d_scriptFile).arg(res).arg(str),
-                   res == 0 ? BuildStep::MessageOutput : BuildStep::ErrorMessageOutput);
-    const bool returnValue = processSucceeded( res, QProcess::NormalExit );
+    emit addOutput(tr("The script \"%1\" exited with code %2%3").arg(d_scriptFile).arg(r.d_code).arg(str),
+                   r.d_code == 0 ? BuildStep::MessageOutput : BuildStep::ErrorMessageOutput);
+    const bool returnValue = processSucceeded( r.d_code, QProcess::NormalExit );
 
     fi.reportResult(returnValue);
 
     emit finished();
 }
 
+void TclStep::onScriptOutput(const QString& msg, bool err)
+{
+    // the engine forwards chunks of several lines; the output parsers expect one line per call
+    int start = 0;
+    while( start < msg.size() )
+    {
+        int end = msg.indexOf( QChar('\n'), start );
+        end = ( end == -1 ) ? msg.size() : end + 1;
+        const QString line = msg.mid( start, end - start );
+        if( err )
+            stdError(line);
+        else
+            stdOutput(line);
+        start = end;
+    }
+}
+
+QStringList TclStep::getVar(const QByteArray& name) const
+{
+    const QByteArray lower = name.toLower();
+    const Project* p = static_cast<const Project*>( project() );
+    if( lower == "srcfiles" )
+        return p->getSrcFiles();
+    else if( lower == "libfiles" )
+        return p->getLibFiles();
+    else if( lower == "incdirs" )
+        return p->getIncDirs();
+    else
+        return p->getConfig( name );
+}
+
+void TclStep::withModel(void* call) const
+{
+    // the model is looked up on each call; it is deleted when its project is closed
+    const Project* p = static_cast<const Project*>( project() );
+    ModelCall* c = static_cast<ModelCall*>(call);
+    c->d_fun( ModelManager::instance()->getModelForFile( p->projectFilePath().toString() ), c->d_arg );
+}
+
 ProjectExplorer::BuildStepConfigWidget* TclStep::createConfigWidget()
 {
     return new TclMakeStepWidget(this);
@@ -266,28 +352,35 @@ bool TclStep::fromMap(const QVariantMap& map)
     return BuildStep::fromMap(map);
 }
 
+// the callbacks are called in the thread of the script; the step and its project live in the GUI thread
+
 void TclStep::writeLog(const QByteArray& msg, bool err, void* data)
 {
-    TclStep* p = static_cast<TclStep*>(data);
-    if( err )
-        p->stdError(QString::fromUtf8(msg));
-    else
-        p->stdOutput(QString::fromUtf8(msg));
+    QMetaObject::invokeMethod( static_cast<TclStep*>(data), "onScriptOutput", Qt::QueuedConnection,
+                               Q_ARG(QString, QString::fromUtf8(msg)), Q_ARG(bool, err) );
 }
 
 QStringList TclStep::tclGetVar(const QByteArray& name, void* data)
 {
     //qDebug() << "tclGetVar called" << name;
-    const QByteArray lower = name.toLower();
-    Project* p = static_cast<Project*>(data);
-    if( lower == "srcfiles" )
-        return p->getSrcFiles();
-    else if( lower == "libfiles" )
-        return p->getLibFiles();
-    else if( lower == "incdirs" )
-        return p->getIncDirs();
-    else
-        return p->getConfig( name );
+    QStringList res;
+    QMetaObject::invokeMethod( static_cast<TclStep*>(data), "getVar", Qt::BlockingQueuedConnection,
+                               Q_RETURN_ARG(QStringList, res), Q_ARG(QByteArray, name) );
+    return res;
+}
+
+void TclStep::tclWithModel(TclEngine::ModelFun fun, void* arg, void* data)
+{
+    ModelCall c;
+    c.d_fun = fun;
+    c.d_arg = arg;
+    QMetaObject::invokeMethod( static_cast<TclStep*>(data), "withModel", Qt::BlockingQueuedConnection,
+                               Q_ARG(void*, &c) );
+}
+
+bool TclStep::tclIsCanceled(void* data)
+{
+    return static_cast<QFutureInterface<bool>*>(data)->isCanceled();
 }
 
 QString TclStep::makeCommand(const Utils::Environment& ) const
@@ -25,6 +25,8 @@
 #include <projectexplorer/abstractprocessstep.h>
 #include <projectexplorer/localapplicationrunconfiguration.h>
 #include <utils/pathchooser.h>
+#include <QFutureWatcher>
+#include "VlTclEngine.h"
 
 class QLabel;
 class QCheckBox;
@@ -67,8 +69,6 @@ namespace Vl
         TclBuildConfig* d_conf;
     };
 
-    class TclEngine;
-
     class TclStep : public ProjectExplorer::AbstractProcessStep
     {
         Q_OBJECT
@@ -80,6 +80,7 @@ namespace Vl
 
         bool init();
         void run(QFutureInterface<bool> &fi);
+        bool runInGuiThread() const { return true; } // run() only starts the script, see onScriptFinished
         bool immutable() const { return false; }
         ProjectExplorer::BuildStepConfigWidget* createConfigWidget();
         QVariantMap toMap() const;
@@ -88,9 +89,32 @@ namespace Vl
         bool fromMap(const QVariantMap &map);
         static void writeLog(const QByteArray& msg, bool err, void* data);
         static QStringList tclGetVar(const QByteArray& name, void* data);
+        static bool tclIsCanceled(void* data);
+        static void tclWithModel(TclEngine::ModelFun fun, void* arg, void* data);
+        Q_INVOKABLE QStringList getVar( const QByteArray& name ) const;
+        Q_INVOKABLE void withModel( void* call ) const; // call is a ModelCall*
+    protected slots:
+        void onScriptFinished();
+        void onScriptOutput( const QString&, bool err );
     private:
+        struct Result
+        {
+            bool d_ready;
+            bool d_canceled;
+            int d_code;
+            QString d_result;
+            Result():d_ready(false),d_canceled(false),d_code(0){}
+        };
+        struct ModelCall
+        {
+            TclEngine::ModelFun d_fun;
+            void* d_arg;
+        };
+        static Result runScript( TclStep*, const QString& path, QFutureInterface<bool>* );
+
         QString d_scriptFile;
-        TclEngine* d_tcl;
+        QFutureWatcher<Result> d_watcher;
+        QFutureInterface<bool>* d_fi; // only while the script runs
         friend class TclMakeStepWidget;
     };
 
@@ -18,14 +18,22 @@
 */
 
 #include "VlTclEngine.h"
+#include <Verilog/VlCrossRefModel.h>
+#include <Verilog/VlPpSymbols.h>
+#include <Verilog/VlSynTree.h>
 #include <tcl/tcl.h>
 #include <QtDebug>
 #include <QLibrary>
+#include <QVarLengthArray>
+#include <QElapsedTimer>
+#include <QMap>
+#include <algorithm>
 #include <errno.h>
 using namespace Vl;
 
-static TclEngine* s_inst = 0;
-static int s_refCount = 0;
+static const int s_cancelCheck = 1000; // commands between two cancel checks
+static const int s_flushSize = 64 * 1024; // bytes of output collected before they are forwarded
+static const int s_flushMs = 100; // but output is never held back longer than this
 
 // Inspired by https://github.com/JPNaude/Qtilities/blob/master/src/Examples/TclScriptingExample/qtclconsole.cpp
 
@@ -114,10 +122,27 @@ struct TclEngine::Imp
     SetChannelOption d_SetChannelOption;
     typedef char * (*GetStringResult)(Tcl_Interp *interp);
     GetStringResult d_GetStringResult;
+    typedef void (*LimitAddHandler)(Tcl_Interp *interp, int type, Tcl_LimitHandlerProc *handlerProc,
+                                    ClientData clientData, Tcl_LimitHandlerDeleteProc *deleteProc);
+    LimitAddHandler d_LimitAddHandler;
+    typedef void (*LimitSetCommands)(Tcl_Interp *interp, int commandLimit);
+    LimitSetCommands d_LimitSetCommands;
+    typedef int (*LimitGetCommands)(Tcl_Interp *interp);
+    LimitGetCommands d_LimitGetCommands;
+    typedef void (*LimitTypeEnable)(Tcl_Interp *interp, int type);
+    LimitTypeEnable d_LimitTypeEnable;
+    typedef Tcl_Obj* (*NewStringObj)(const char *bytes, int length);
+    NewStringObj d_NewStringObj;
+    typedef Tcl_Obj* (*NewListObj)(int objc, Tcl_Obj *const objv[]);
+    NewListObj d_NewListObj;
+    typedef void (*SetObjResult)(Tcl_Interp *interp, Tcl_Obj *resultObjPtr);
+    SetObjResult d_SetObjResult;
 
-    Imp():d_tcl(0),d_CreateInterp(0),d_DeleteInterp(0),d_Eval(0),d_EvalFile(0),d_TraceVar2(0),d_AppendElement(0),
-        d_WrongNumArgs(0),d_GetString(0),d_SetStdChannel(0),d_RegisterChannel(0),d_SetErrno(0),
-        d_CreateChannel(0),d_SetChannelOption(0),d_GetStringResult(0)
+    Imp():d_tcl(0),d_canceled(false),d_CreateInterp(0),d_DeleteInterp(0),d_Eval(0),d_EvalFile(0),
+        d_TraceVar2(0),d_AppendElement(0),d_WrongNumArgs(0),d_GetString(0),d_SetStdChannel(0),d_RegisterChannel(0),
+        d_SetErrno(0),d_CreateChannel(0),d_SetChannelOption(0),d_GetStringResult(0),
+        d_LimitAddHandler(0),d_LimitSetCommands(0),d_LimitGetCommands(0),d_LimitTypeEnable(0),
+        d_NewStringObj(0),d_NewListObj(0),d_SetObjResult(0)
     {
         d_lib.setFileName("tcl");
         if( !d_lib.load() )
@@ -141,9 +166,31 @@ struct TclEngine::Imp
         d_CreateChannel = (CreateChannel)d_lib.resolve("Tcl_CreateChannel");
         d_SetChannelOption = (SetChannelOption)d_lib.resolve("Tcl_SetChannelOption");
         d_GetStringResult = (GetStringResult)d_lib.resolve("Tcl_GetStringResult");
+        d_LimitAddHandler = (LimitAddHandler)d_lib.resolve("Tcl_LimitAddHandler");
+        d_LimitSetCommands = (LimitSetCommands)d_lib.resolve("Tcl_LimitSetCommands");
+        d_LimitGetCommands = (LimitGetCommands)d_lib.resolve("Tcl_LimitGetCommands");
+        d_LimitTypeEnable = (LimitTypeEnable)d_lib.resolve("Tcl_LimitTypeEnable");
+        d_NewStringObj = (NewStringObj)d_lib.resolve("Tcl_NewStringObj");
+        d_NewListObj = (NewListObj)d_lib.resolve("Tcl_NewListObj");
+        d_SetObjResult = (SetObjResult)d_lib.resolve("Tcl_SetObjResult");
 
         d_tcl = d_CreateInterp();
         d_CreateObjCommand(d_tcl, "get_vlpro_var", get_vlpro_var, this, 0 );
+        d_CreateObjCommand(d_tcl, "vl_modules", vl_modules, this, 0 );
+        d_CreateObjCommand(d_tcl, "vl_ports", vl_ports, this, 0 );
+        d_CreateObjCommand(d_tcl, "vl_instances", vl_instances, this, 0 );
+        d_CreateObjCommand(d_tcl, "vl_hierarchy", vl_hierarchy, this, 0 );
+        d_CreateObjCommand(d_tcl, "vl_defines", vl_defines, this, 0 );
+
+        // Tcl checks the command limit also in byte compiled loops; each time it is reached we either
+        // extend it or let the interpreter unwind the script with an error
+        if( d_LimitAddHandler && d_LimitSetCommands && d_LimitGetCommands && d_LimitTypeEnable )
+        {
+            d_LimitAddHandler( d_tcl, TCL_LIMIT_COMMANDS, checkCanceled, this, 0 );
+            d_LimitSetCommands( d_tcl, s_cancelCheck );
+            d_LimitTypeEnable( d_tcl, TCL_LIMIT_COMMANDS );
+        }else
+            qWarning() << "libtcl has no interpreter limits; Tcl scripts cannot be canceled";
 
         Tcl_Channel outConsoleChannel = d_CreateChannel(&consoleOutputChannelType, "stdout", this, TCL_WRITABLE);
         if( outConsoleChannel )
@@ -168,6 +215,69 @@ struct TclEngine::Imp
             d_DeleteInterp(d_tcl);
     }
 
+    static void checkCanceled(ClientData clientData, Tcl_Interp *interp)
+    {
+        Imp* imp = static_cast<Imp*>(clientData);
+        if( imp->d_lastFlush.hasExpired( s_flushMs ) )
+        {
+            // the script computes instead of writing; don't hold back what it wrote so far
+            imp->flush( false, false );
+            imp->flush( true, false );
+        }
+        if( imp->d_isCanceled.d_cb && imp->d_isCanceled.d_cb( imp->d_isCanceled.d_data ) )
+            imp->d_canceled = true; // limit stays exceeded
+        else
+            imp->d_LimitSetCommands( interp, imp->d_LimitGetCommands(interp) + s_cancelCheck );
+    }
+
+    // The channels are unbuffered on the Tcl side, so each puts arrives here. Forwarding each one is a round
+    // trip to the GUI thread; instead the output is collected and forwarded in chunks of whole lines.
+    void write( const char* buf, int len, bool err )
+    {
+        if( !d_pending[!err].isEmpty() )
+            flush( !err, true ); // keep the order of stdout and stderr
+        d_pending[err].append( buf, len );
+        if( d_pending[err].size() >= s_flushSize || d_lastFlush.hasExpired( s_flushMs ) )
+            flush( err, false );
+    }
+
+    // the length of buf without a trailing incomplete UTF-8 sequence
+    static int utf8Boundary( const QByteArray& buf )
+    {
+        int i = buf.size();
+        while( i > 0 && ( quint8(buf[i-1]) & 0xc0 ) == 0x80 )
+            i--; // continuation bytes
+        if( i == 0 )
+            return buf.size(); // not UTF-8 anyway
+        const quint8 lead = buf[i-1];
+        int n = 1;
+        if( ( lead & 0xe0 ) == 0xc0 )
+            n = 2;
+        else if( ( lead & 0xf0 ) == 0xe0 )
+            n = 3;
+        else if( ( lead & 0xf8 ) == 0xf0 )
+            n = 4;
+        if( buf.size() - ( i - 1 ) < n )
+            return i - 1;
+        return buf.size();
+    }
+
+    void flush( bool err, bool all )
+    {
+        QByteArray& buf = d_pending[err];
+        int len = all ? buf.size() : buf.lastIndexOf('\n') + 1;
+        if( len == 0 && buf.size() >= s_flushSize )
+            len = utf8Boundary( buf ); // one very long line; the receiver decodes each chunk on its own
+        if( len > 0 )
+        {
+            const QByteArray chunk = buf.left(len);
+            if( d_writeLog.d_cb )
+                d_writeLog.d_cb( chunk, err, d_writeLog.d_data );
+            buf.remove( 0, len ); // only an incomplete line remains
+        }
+        d_lastFlush.start();
+    }
+
     static int get_vlpro_var(ClientData clientData, Tcl_Interp *interp,
         int objc, struct Tcl_Obj *const *objv)
     {
@@ -191,8 +301,277 @@ struct TclEngine::Imp
         return TCL_OK;
     }
 
+    // The vl_* commands run in the thread of the script, but the model lives in the GUI thread and goes
+    // away with its project. So the answer is collected by the WithModel callback in the GUI thread, as
+    // plain pairs, and only the Tcl list is built here.
+
+    struct Query;
+    typedef void (*Collect)( CrossRefModel*, Query& );
+    struct Query
+    {
+        Collect d_collect;
+        QByteArray d_arg;
+        QList<QPair<QByteArray,QByteArray> > d_res;
+        QByteArray d_err;
+    };
+
+    Tcl_Obj* str( const QByteArray& s ) const
+    {
+        return d_NewStringObj( s.constData(), s.size() );
+    }
+
+    Tcl_Obj* pair( const QByteArray& a, const QByteArray& b ) const
+    {
+        Tcl_Obj* objs[2] = { str(a), str(b) };
+        return d_NewListObj( 2, objs );
+    }
+
+    static void runQuery( CrossRefModel* mdl, void* arg )
+    {
+        Query* q = static_cast<Query*>(arg);
+        if( mdl == 0 )
+            q->d_err = "no Verilog model available";
+        else
+            q->d_collect( mdl, *q );
+    }
+
+    int query( Tcl_Interp *interp, int objc, struct Tcl_Obj *const *objv, int count, const char* msg,
+               Collect collect, bool pairs ) const
+    {
+        if( objc != count )
+        {
+            d_WrongNumArgs( interp, 1, objv, msg );
+            return TCL_ERROR;
+        }
+        Query q;
+        q.d_collect = collect;
+        if( count > 1 )
+            q.d_arg = d_GetString(objv[1]);
+        if( d_withModel.d_cb )
+            d_withModel.d_cb( runQuery, &q, d_withModel.d_data );
+        else
+            q.d_err = "no Verilog model available";
+        if( !q.d_err.isEmpty() )
+        {
+            d_SetObjResult( interp, str( q.d_err ) );
+            return TCL_ERROR;
+        }
+        QVarLengthArray<Tcl_Obj*,256> objs;
+        for( int i = 0; i < q.d_res.size(); i++ )
+            objs.append( pairs ? pair( q.d_res[i].first, q.d_res[i].second ) : str( q.d_res[i].first ) );
+        d_SetObjResult( interp, d_NewListObj( objs.size(), objs.constData() ) );
+        return TCL_OK;
+    }
+
+    // the collectors below run in the GUI thread
+
+    static bool isModule( const CrossRefModel::Symbol* sym )
+    {
+        return sym && ( sym->tok().d_type == SynTree::R_module_declaration ||
+                        sym->tok().d_type == SynTree::R_udp_declaration );
+    }
+
+    static CrossRefModel::SymRef findModule( CrossRefModel* mdl, Query& q, const QByteArray& name )
+    {
+        CrossRefModel::SymRef sym = mdl->findGlobal( name );
+        if( !isModule( sym.constData() ) )
+        {
+            q.d_err = "unknown module " + name;
+            return CrossRefModel::SymRef();
+        }
+        return sym;
+    }
+
+    static void collectInstances( const CrossRefModel::Branch* b, QList<const CrossRefModel::Branch*>& res )
+    {
+        foreach( const CrossRefModel::SymRef& sub, b->children() )
+        {
+            const CrossRefModel::Branch* b2 = sub->toBranch();
+            if( sub->tok().d_type == SynTree::R_module_or_udp_instance_ && !sub->tok().d_val.isEmpty() &&
+                    b2 && b2->super() )
+                res.append( b2 );
+            if( b2 )
+                collectInstances( b2, res );
+        }
+    }
+
+    static void modules( CrossRefModel* mdl, Query& q )
+    {
+        QList<QByteArray> names;
+        foreach( const CrossRefModel::IdentDeclRef& id, mdl->getGlobalNames() )
+        {
+            if( isModule( id->decl() ) )
+                names.append( id->tok().d_val );
+        }
+        std::sort( names.begin(), names.end() );
+        foreach( const QByteArray& name, names )
+            q.d_res.append( qMakePair( name, QByteArray() ) );
+    }
+
+    static void ports( CrossRefModel* mdl, Query& q )
+    {
+        // {name direction} pairs in declaration order
+        CrossRefModel::SymRef mod = findModule( mdl, q, q.d_arg );
+        if( mod.constData() == 0 )
+            return;
+        QMap<QPair<quint32,quint32>,QPair<QByteArray,QByteArray> > ports;
+        const CrossRefModel::Scope* s = mod->toScope();
+        if( s )
+        {
+            foreach( const CrossRefModel::IdentDeclRef& id, s->getNames() )
+            {
+                if( id->decl() == 0 )
+                    continue;
+                // the grammar names the declarations after the direction (input_declaration etc.)
+                const QByteArray kind = SynTree::rToStr( id->decl()->tok().d_type );
+                QByteArray dir;
+                if( kind.contains("inout") )
+                    dir = "inout";
+                else if( kind.contains("input") )
+                    dir = "input";
+                else if( kind.contains("output") )
+                    dir = "output";
+                else if( kind.contains("port") )
+                    dir = "port";
+                else
+                    continue;
+                ports.insert( QPair<quint32,quint32>( id->tok().d_lineNr, id->tok().d_colNr ),
+                              qMakePair( id->tok().d_val, dir ) );
+            }
+        }
+        q.d_res = ports.values();
+    }
+
+    static void instances( CrossRefModel* mdl, Query& q )
+    {
+        // {instance module} pairs in source order
+        CrossRefModel::SymRef mod = findModule( mdl, q, q.d_arg );
+        if( mod.constData() == 0 )
+            return;
+        QList<const CrossRefModel::Branch*> insts;
+        if( mod->toBranch() )
+            collectInstances( mod->toBranch(), insts );
+        foreach( const CrossRefModel::Branch* i, insts )
+            q.d_res.append( qMakePair( i->tok().d_val, i->super()->tok().d_val ) );
+    }
+
+    static void hierarchy( CrossRefModel* mdl, Query& q )
+    {
+        // {path module} pairs of the elaborated tree, depth first, starting with the top
+        const QByteArray top = q.d_arg;
+        if( findModule( mdl, q, top ).constData() == 0 )
+            return;
+
+        struct Frame
+        {
+            QByteArray d_path;
+            QByteArray d_module;
+            int d_depth;
+        };
+        const int maxNodes = 1000000; // the tree grows exponentially with the depth
+        QHash<QByteArray,QList<const CrossRefModel::Branch*> > insts;
+        QList<QByteArray> onPath; // the modules from the top to the current node
+        QList<Frame> stack;
+        Frame f;
+        f.d_path = top;
+        f.d_module = top;
+        f.d_depth = 0;
+        stack.append(f);
+        while( !stack.isEmpty() )
+        {
+            f = stack.takeLast();
+            if( q.d_res.size() >= maxNodes )
+            {
+                q.d_res.clear();
+                q.d_err = "hierarchy of " + top + " exceeds " + QByteArray::number( maxNodes ) + " instances";
+                return;
+            }
+            q.d_res.append( qMakePair( f.d_path, f.d_module ) );
+            onPath.erase( onPath.begin() + f.d_depth, onPath.end() );
+            // a module instantiating itself, directly or not, is listed once but not expanded again
+            if( onPath.contains( f.d_module ) )
+                continue;
+            onPath.append( f.d_module );
+            if( !insts.contains( f.d_module ) )
+            {
+                QList<const CrossRefModel::Branch*>& l = insts[f.d_module];
+                CrossRefModel::SymRef mod = mdl->findGlobal( f.d_module );
+                if( isModule( mod.constData() ) && mod->toBranch() )
+                    collectInstances( mod->toBranch(), l );
+            }
+            const QList<const CrossRefModel::Branch*>& l = insts[f.d_module];
+            for( int i = l.size() - 1; i >= 0; i-- )
+            {
+                Frame sub;
+                sub.d_path = f.d_path + "." + l[i]->tok().d_val;
+                sub.d_module = l[i]->super()->tok().d_val;
+                sub.d_depth = f.d_depth + 1;
+                stack.append( sub );
+            }
+        }
+    }
+
+    static void defines( CrossRefModel* mdl, Query& q )
+    {
+        // {name value} pairs; the value is the token sequence of the define
+        QList<QByteArray> names = mdl->getSyms()->getNames();
+        std::sort( names.begin(), names.end() );
+        foreach( const QByteArray& name, names )
+        {
+            const PpSymbols::Define d = mdl->getSyms()->getSymbol(name);
+            QByteArray val;
+            foreach( const Token& t, d.d_toks )
+            {
+                if( !val.isEmpty() )
+                    val += " ";
+                if( t.d_type < TT_Specials )
+                    val += t.getName();
+                else if( t.d_type == Tok_Str )
+                    val += "\"" + t.d_val + "\"";
+                else if( t.d_type == Tok_SysName )
+                    val += "$" + t.d_val;
+                else
+                    val += t.d_val;
+            }
+            q.d_res.append( qMakePair( name, val ) );
+        }
+    }
+
+    static int vl_modules(ClientData clientData, Tcl_Interp *interp,
+        int objc, struct Tcl_Obj *const *objv)
+    {
+        return static_cast<Imp*>(clientData)->query( interp, objc, objv, 1, "", modules, false );
+    }
+
+    static int vl_ports(ClientData clientData, Tcl_Interp *interp,
+        int objc, struct Tcl_Obj *const *objv)
+    {
+        return static_cast<Imp*>(clientData)->query( interp, objc, objv, 2, "module", ports, true );
+    }
+
+    static int vl_instances(ClientData clientData, Tcl_Interp *interp,
+        int objc, struct Tcl_Obj *const *objv)
+    {
+        return static_cast<Imp*>(clientData)->query( interp, objc, objv, 2, "module", instances, true );
+    }
+
+    static int vl_hierarchy(ClientData clientData, Tcl_Interp *interp,
+        int objc, struct Tcl_Obj *const *objv)
+    {
+        return static_cast<Imp*>(clientData)->query( interp, objc, objv, 2, "top", hierarchy, true );
+    }
+
+    static int vl_defines(ClientData clientData, Tcl_Interp *interp,
+        int objc, struct Tcl_Obj *const *objv)
+    {
+        return static_cast<Imp*>(clientData)->query( interp, objc, objv, 1, "", defines, true );
+    }
+
     QLibrary d_lib;
     Tcl_Interp* d_tcl;
+    bool d_canceled;
+    QByteArray d_pending[2]; // stdout, stderr
+    QElapsedTimer d_lastFlush;
     struct GetVarCb {
         GetVarCb():d_cb(0),d_data(0){}
         TclEngine::GetVar d_cb;
@@ -203,6 +582,16 @@ struct TclEngine::Imp
         TclEngine::WriteLog d_cb;
         void* d_data;
     } d_writeLog;
+    struct IsCanceledCb{
+        IsCanceledCb():d_cb(0),d_data(0){}
+        TclEngine::IsCanceled d_cb;
+        void* d_data;
+    } d_isCanceled;
+    struct WithModelCb{
+        WithModelCb():d_cb(0),d_data(0){}
+        TclEngine::WithModel d_cb;
+        void* d_data;
+    } d_withModel;
 };
 
 static int writeStdout(ClientData clientData, CONST char * buf, int toWrite, int *errorCode)
@@ -212,7 +601,7 @@ static int writeStdout(ClientData clientData, CONST char * buf, int toWrite, int
     imp->d_SetErrno(0);
     if( imp->d_writeLog.d_cb )
     {
-        imp->d_writeLog.d_cb( QByteArray::fromRawData(buf,toWrite), false, imp->d_writeLog.d_data );
+        imp->write( buf, toWrite, false );
         return toWrite;
     }else
         return 0;
@@ -225,7 +614,7 @@ static int writeStderr(ClientData clientData, CONST char * buf, int toWrite, int
     imp->d_SetErrno(0);
     if( imp->d_writeLog.d_cb )
     {
-        imp->d_writeLog.d_cb( QByteArray::fromRawData(buf,toWrite), true, imp->d_writeLog.d_data );
+        imp->write( buf, toWrite, true );
         return toWrite;
     }else
         return 0;
@@ -258,36 +647,41 @@ void TclEngine::setWriteLog(TclEngine::WriteLog w, void* data)
     d_imp->d_writeLog.d_data = data;
 }
 
+void TclEngine::setIsCanceled(TclEngine::IsCanceled c, void* data)
+{
+    d_imp->d_isCanceled.d_cb = c;
+    d_imp->d_isCanceled.d_data = data;
+}
+
+void TclEngine::setWithModel(TclEngine::WithModel w, void* data)
+{
+    d_imp->d_withModel.d_cb = w;
+    d_imp->d_withModel.d_data = data;
+}
+
 bool TclEngine::runFile(const QString& path)
 {
-    return d_imp->d_EvalFile( d_imp->d_tcl, path.toUtf8().data() ) == TCL_OK;
+    d_imp->d_canceled = false;
+    d_imp->d_lastFlush.start();
+    const bool ok = d_imp->d_EvalFile( d_imp->d_tcl, path.toUtf8().data() ) == TCL_OK;
+    d_imp->flush( false, true );
+    d_imp->flush( true, true );
+    return ok;
 }
 
-QString TclEngine::getResult() const
+bool TclEngine::wasCanceled() const
 {
-    return QString::fromUtf8( d_imp->d_GetStringResult(d_imp->d_tcl) );
+    return d_imp->d_canceled;
 }
 
-TclEngine*TclEngine::addRef()
+QString TclEngine::getResult() const
 {
-    if( s_refCount <= 0 )
-    {
-        //qDebug() << "TCL create";
-        s_refCount = 0;
-        s_inst = new TclEngine();
-    }
-    s_refCount++;
-    return s_inst;
+    return QString::fromUtf8( d_imp->d_GetStringResult(d_imp->d_tcl) );
 }
 
-void TclEngine::release()
+bool TclEngine::isAvailable()
 {
-    s_refCount--;
-    if( s_refCount == 0 )
-    {
-        //qDebug() << "TCL delete";
-        delete s_inst;
-        s_inst = 0;
-    }
+    QLibrary lib("tcl");
+    return lib.load() && lib.resolve("Tcl_CreateInterp") != 0;
 }
 
@@ -24,11 +24,18 @@
 
 namespace Vl
 {
+    class CrossRefModel;
+
+    // Each engine owns its own interpreter, which may only be used by the thread which created the engine.
     class TclEngine : public QObject
     {
     public:
         typedef QStringList (*GetVar)( const QByteArray& name, void* data );
         typedef void (*WriteLog)( const QByteArray& msg, bool err, void* data );
+        typedef bool (*IsCanceled)( void* data );
+        typedef void (*ModelFun)( CrossRefModel*, void* arg );
+        // calls fun with the current model (or null) in the thread owning the model
+        typedef void (*WithModel)( ModelFun fun, void* arg, void* data );
 
         explicit TclEngine(QObject *parent = 0);
         ~TclEngine();
@@ -36,11 +43,13 @@ namespace Vl
         bool isReady() const;
         void setGetVar( GetVar, void* data );
         void setWriteLog( WriteLog, void* data );
+        void setIsCanceled( IsCanceled, void* data ); // polled while the script runs
+        void setWithModel( WithModel, void* data ); // answers the vl_* commands
         bool runFile( const QString& );
+        bool wasCanceled() const;
         QString getResult() const;
 
-        static TclEngine* addRef();
-        static void release();
+        static bool isAvailable();
 
         struct Imp;
     private:
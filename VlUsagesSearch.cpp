@@ -0,0 +1,136 @@
+/*
+* Copyright 2019 Rochus Keller <mailto:me@rochus-keller.ch>
+*
+* This file is part of the VerilogCreator plugin.
+*
+* The following is the license that applies to this copy of the
+* plugin. For a license to use the plugin under conditions
+* other than those described here, please email to me@rochus-keller.ch.
+*
+* GNU General Public License Usage
+* This file may be used under the terms of the GNU General Public
+* License (GPL) versions 2.0 or 3.0 as published by the Free Software
+* Foundation and appearing in the file LICENSE.GPL included in
+* the packaging of this file. Please review the following information
+* to ensure GNU General Public Licensing requirements will be met:
+* http://www.fsf.org/licensing/licenses/info/GPLv2.html and
+* http://www.gnu.org/copyleft/gpl.html.
+*/
+
+#include "VlUsagesSearch.h"
+#include "VlModelManager.h"
+#include "VlMappedFiles.h"
+#include <coreplugin/find/searchresultwindow.h>
+#include <QFutureInterface>
+#include <QRunnable>
+using namespace Vl;
+
+namespace Vl
+{
+    class LineFetchJob : public QRunnable
+    {
+    public:
+        QFutureInterface<UsagesSearch::File> d_fi;
+        QList<UsagesSearch::File> d_files;
+        MappedFiles* d_mapped; // ModelManager waits for the job before deleting it
+
+        void run()
+        {
+            d_fi.setProgressRange( 0, d_files.size() );
+            for( int i = 0; i < d_files.size(); i++ )
+            {
+                if( d_fi.isCanceled() )
+                    break;
+                UsagesSearch::File& f = d_files[i];
+                // edited buffers are overlays in MappedFiles, everything else is mapped from disk
+                MappedFiles::Text text = d_mapped->getText( f.d_path );
+                for( int j = 0; j < f.d_hits.size(); j++ )
+                {
+                    const QByteArray line = text.line( f.d_hits[j].d_line );
+                    if( !line.isEmpty() )
+                        f.d_hits[j].d_text = line;
+                }
+                d_fi.reportResult( f, i );
+                d_fi.setProgressValue( i + 1 );
+            }
+            d_fi.reportFinished();
+        }
+    };
+}
+
+static bool lessThan(const CrossRefModel::SymRef &s1, const CrossRefModel::SymRef &s2)
+{
+    if( s1->tok().d_sourcePath != s2->tok().d_sourcePath )
+        return s1->tok().d_sourcePath < s2->tok().d_sourcePath;
+    return s1->tok().d_lineNr < s2->tok().d_lineNr ||
+            ( !(s2->tok().d_lineNr < s1->tok().d_lineNr) && s1->tok().d_colNr < s2->tok().d_colNr );
+}
+
+void UsagesSearch::start(Core::SearchResult* search, const CrossRefModel::SymRefList& syms)
+{
+    CrossRefModel::SymRefList l = syms;
+    std::sort( l.begin(), l.end(), lessThan );
+
+    LineFetchJob* job = new LineFetchJob();
+    job->d_mapped = ModelManager::instance()->getMappedFiles();
+    foreach( const CrossRefModel::SymRef& sym, l )
+    {
+        const Token& t = sym->tok();
+        if( job->d_files.isEmpty() || job->d_files.last().d_path != t.d_sourcePath )
+        {
+            File f;
+            f.d_path = t.d_sourcePath;
+            job->d_files.append(f);
+        }
+        Hit h;
+        h.d_line = t.d_lineNr;
+        h.d_col = t.d_colNr;
+        h.d_len = t.d_len;
+        h.d_text = t.d_val; // shown if the file cannot be read
+        job->d_files.last().d_hits.append(h);
+    }
+
+    UsagesSearch* us = new UsagesSearch(search);
+    job->d_fi.reportStarted();
+    us->d_watcher.setFuture( job->d_fi.future() );
+    ModelManager::instance()->startMappedFilesJob( job, job->d_fi );
+}
+
+void UsagesSearch::onResults(int from, int to)
+{
+    for( int i = from; i < to; i++ )
+    {
+        const File f = d_watcher.resultAt(i);
+        QList<Core::SearchResultItem> items;
+        foreach( const Hit& h, f.d_hits )
+        {
+            Core::SearchResultItem item;
+            item.path = QStringList() << f.d_path;
+            item.lineNumber = h.d_line;
+            item.text = QString::fromLatin1( h.d_text ); // the columns of the lexer count bytes
+            item.textMarkPos = h.d_col - 1;
+            item.textMarkLength = h.d_len;
+            item.useTextEditorFont = true;
+            items.append(item);
+        }
+        d_search->addResults( items, Core::SearchResult::AddOrdered );
+    }
+}
+
+void UsagesSearch::onFinished()
+{
+    d_search->finishSearch( d_watcher.isCanceled() );
+    deleteLater();
+}
+
+void UsagesSearch::onCancel()
+{
+    d_watcher.cancel();
+}
+
+UsagesSearch::UsagesSearch(Core::SearchResult* search):QObject(search),d_search(search)
+{
+    connect( &d_watcher, SIGNAL(resultsReadyAt(int,int)), this, SLOT(onResults(int,int)) );
+    connect( &d_watcher, SIGNAL(finished()), this, SLOT(onFinished()) );
+    connect( search, SIGNAL(cancelled()), this, SLOT(onCancel()) );
+}
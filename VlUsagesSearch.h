@@ -0,0 +1,66 @@
+#ifndef VLUSAGESSEARCH_H
+#define VLUSAGESSEARCH_H
+
+/*
+* Copyright 2019 Rochus Keller <mailto:me@rochus-keller.ch>
+*
+* This file is part of the VerilogCreator plugin.
+*
+* The following is the license that applies to this copy of the
+* plugin. For a license to use the plugin under conditions
+* other than those described here, please email to me@rochus-keller.ch.
+*
+* GNU General Public License Usage
+* This file may be used under the terms of the GNU General Public
+* License (GPL) versions 2.0 or 3.0 as published by the Free Software
+* Foundation and appearing in the file LICENSE.GPL included in
+* the packaging of this file. Please review the following information
+* to ensure GNU General Public Licensing requirements will be met:
+* http://www.fsf.org/licensing/licenses/info/GPLv2.html and
+* http://www.gnu.org/copyleft/gpl.html.
+*/
+
+#include <QObject>
+#include <QFutureWatcher>
+#include <Verilog/VlCrossRefModel.h>
+
+namespace Core
+{
+    class SearchResult;
+}
+
+namespace Vl
+{
+    // Fills a search result with the text lines of the given hits. The lines are fetched from MappedFiles
+    // in a background thread and added to the result file by file as soon as they are available.
+    class UsagesSearch : public QObject
+    {
+        Q_OBJECT
+    public:
+        struct Hit
+        {
+            quint32 d_line;
+            quint16 d_col;
+            quint16 d_len;
+            QByteArray d_text;
+        };
+        struct File
+        {
+            QString d_path;
+            QList<Hit> d_hits;
+        };
+
+        // hits have to be in the order they should appear; search is finished when all files are done
+        static void start( Core::SearchResult*, const CrossRefModel::SymRefList& );
+    protected slots:
+        void onResults(int from, int to);
+        void onFinished();
+        void onCancel();
+    private:
+        UsagesSearch( Core::SearchResult* );
+        Core::SearchResult* d_search;
+        QFutureWatcher<File> d_watcher;
+    };
+}
+
+#endif // VLUSAGESSEARCH_H
@@ -20,6 +20,7 @@
 #include "VlVerilatorConfiguration.h"
 #include "VlProject.h"
 #include "VlModelManager.h"
+#include "VlBuildFingerprint.h"
 #include <projectexplorer/buildinfo.h>
 #include <projectexplorer/projectexplorerconstants.h>
 #include <projectexplorer/projectexplorer.h>
@@ -33,14 +34,18 @@
 #include <QFormLayout>
 #include <QLabel>
 #include <QLineEdit>
+#include <QSpinBox>
+#include <QThread>
 using namespace Vl;
 
 const char* VerilatorBuildConfig::ID = "VerilogCreator.Verilator.BuildConfig";
 const char* VerilatorMakeStep::ID = "VerilogCreator.Verilator.MakeStep";
 const char* VerilatorCleanStep::ID = "VerilogCreator.Verilator.CleanStep";
+const char* VerilatorCompileStep::ID = "VerilogCreator.Verilator.CompileStep";
 const char* VerilatorBuildConfig::Name = "Verilator";
 static const char* s_cmdFileName = "cmdfile.txt";
 static const char* s_simDir = ".";
+static const char* s_fingerprintFileName = "fingerprint.txt";
 static const char* s_defaultBuildDir = "verilator_build";
 
 VerilatorBuildConfig::VerilatorBuildConfig(ProjectExplorer::Target* parent)
@@ -74,6 +79,8 @@ ProjectExplorer::BuildConfiguration* VerilatorBuildConfig::create(ProjectExplore
     Q_ASSERT(buildSteps);
     VerilatorMakeStep *makeStep = new VerilatorMakeStep(buildSteps);
     buildSteps->insertStep(0, makeStep);
+    VerilatorCompileStep *compileStep = new VerilatorCompileStep(buildSteps);
+    buildSteps->insertStep(1, compileStep);
 
     Q_ASSERT(cleanSteps);
     VerilatorCleanStep *cleanMakeStep = new VerilatorCleanStep(cleanSteps);
@@ -132,7 +139,7 @@ void VerilatorBuildConfigWidget::environmentChanged()
 }
 
 VerilatorMakeStep::VerilatorMakeStep(ProjectExplorer::BuildStepList* parent):
-    AbstractProcessStep(parent, ID)
+    AbstractProcessStep(parent, ID),d_threads(0),d_outputSplit(0),d_prune(false)
 {
     setDefaultDisplayName(tr("verilator") );
     d_args = QLatin1Literal("--cc");
@@ -168,78 +175,88 @@ bool VerilatorMakeStep::init()
             return false;
         }
     }
-    QFile cmdfile( buildDir.absoluteFilePath(s_cmdFileName) );
-    if( !cmdfile.open(QIODevice::WriteOnly) )
-    {
-        emit addTask(ProjectExplorer::Task(ProjectExplorer::Task::Error,
-                       tr("Unable to create the file %1.").arg( QDir::toNativeSeparators(cmdfile.fileName())),
-                       Utils::FileName(), -1,
-                       ProjectExplorer::Constants::TASK_CATEGORY_BUILDSYSTEM) );
-        return false;
-    }
-
+    QByteArray cmd;
+    QStringList files = p->getSrcFiles() + p->getLibFiles();
+    if( d_prune )
+        files = p->getUsedFiles( files ); // verilator finds the modules itself, so less dirs are less to search
     QSet<QString> dirs;
-    foreach( const QString& f, p->getSrcFiles() )
-    {
-        dirs.insert( QFileInfo(f).path() );
-    }
-    foreach( const QString& f, p->getLibFiles() )
+    foreach( const QString& f, files )
     {
         dirs.insert( QFileInfo(f).path() );
     }
-    foreach( const QString& f, dirs )
+    QStringList sorted = dirs.toList();
+    sorted.sort(); // QSet order is arbitrary; keep the file stable between builds
+    foreach( const QString& f, sorted )
     {
-        cmdfile.write( "-y " );
-        cmdfile.write( f.toUtf8() );
-        cmdfile.write( "\n" );
+        cmd += "-y ";
+        cmd += f.toUtf8();
+        cmd += "\n";
     }
     const QSet<QString> undefs = QSet<QString>::fromList(p->getConfig("BUILD_UNDEFS")) +
             QSet<QString>::fromList(p->getConfig("VLTR_UNDEFS"));
     foreach( const QString& f, p->getConfig("DEFINES") )
     {
         const QString def = f.trimmed();
-		const int pos = def.indexOf(QRegExp("\\s"));
-		const QString key = ( pos == -1 ? def : def.left(pos) );
-		const QString val = ( pos == -1 ? QString() : def.mid(pos+1).trimmed() );
+        const int pos = def.indexOf(QRegExp("\\s"));
+        const QString key = ( pos == -1 ? def : def.left(pos) );
+        const QString val = ( pos == -1 ? QString() : def.mid(pos+1).trimmed() );
         if( !undefs.contains(key) )
         {
-        	cmdfile.write( "+define+" );
-		    cmdfile.write(key.toUtf8());
-		    if( !val.isEmpty() )
-		    {
-		        cmdfile.write( "=" );
-		        cmdfile.write(val.toUtf8());
-		    }
-		    cmdfile.write( "\n" );
+            cmd += "+define+";
+            cmd += key.toUtf8();
+            if( !val.isEmpty() )
+            {
+                cmd += "=";
+                cmd += val.toUtf8();
+            }
+            cmd += "\n";
         }
     }
     foreach( const QString& f, p->getIncDirs() )
     {
-        cmdfile.write( "+incdir+" );
-        cmdfile.write( f.trimmed().toUtf8() );
-        cmdfile.write( "\n" );
+        cmd += "+incdir+";
+        cmd += f.trimmed().toUtf8();
+        cmd += "\n";
     }
+    CrossRefModel* mdl = ModelManager::instance()->getModelForFile( p->projectFilePath().toString() );
     const QString topmodule = p->getTopMod().trimmed();
-    if( !topmodule.isEmpty() )
+    if( !topmodule.isEmpty() && mdl )
     {
-        CrossRefModel::SymRef res = ModelManager::instance()->getModelForCurrentProject()->findGlobal( topmodule.toLatin1() );
+        CrossRefModel::SymRef res = mdl->findGlobal( topmodule.toLatin1() );
         if( res.data() )
         {
-            cmdfile.write( res->tok().d_sourcePath.toUtf8() );
-            cmdfile.write( "\n" );
+            cmd += res->tok().d_sourcePath.toUtf8();
+            cmd += "\n";
         }
     }
 
+    // only touch the file if it changed, so the dependency tracking of the generated makefiles still works
+    const QString cmdPath = buildDir.absoluteFilePath(s_cmdFileName);
+    if( !BuildFingerprint::writeIfChanged( cmdPath, cmd ) )
+    {
+        emit addTask(ProjectExplorer::Task(ProjectExplorer::Task::Error,
+                       tr("Unable to create the file %1.").arg( QDir::toNativeSeparators(cmdPath)),
+                       Utils::FileName(), -1,
+                       ProjectExplorer::Constants::TASK_CATEGORY_BUILDSYSTEM) );
+        return false;
+    }
 
     QString args = p->getConfig("VLTR_ARGS").join(QChar(' '));
     args += QString(" --Mdir %1 ").arg( s_simDir );
-    args += QString("-f %1 ").arg( Utils::QtcProcess::quoteArg( cmdfile.fileName() ) );
+    args += QString("-f %1 ").arg( Utils::QtcProcess::quoteArg( cmdPath ) );
     Utils::QtcProcess::addArgs( &args, d_args );
+    Utils::QtcProcess::addArgs( &args, optionArgs() );
 
     pp->setArguments( args );
 
     pp->resolveAll();
 
+    d_fpSources = files;
+    d_fpIncDirs = p->getIncludePath();
+    d_fpConfig = ( pp->effectiveCommand() + " " + pp->effectiveArguments() ).toUtf8() + "\n" + cmd;
+    d_fpFile = buildDir.absoluteFilePath(s_fingerprintFileName);
+    d_mdir = buildDir.absoluteFilePath(s_simDir);
+
     setIgnoreReturnValue(false);
 
     // TODO setOutputParser(new ProjectExplorer::GccParser());
@@ -251,9 +268,47 @@ bool VerilatorMakeStep::init()
 
 void VerilatorMakeStep::run(QFutureInterface<bool>& fi)
 {
+    // nothing to do if neither the sources nor the configuration changed since the last successful run
+    d_fp = BuildFingerprint::compute( d_fpSources, d_fpIncDirs, d_fpConfig );
+    if( !QDir( d_mdir ).entryList( QStringList() << "*.mk", QDir::Files ).isEmpty() &&
+            BuildFingerprint::load( d_fpFile ) == d_fp )
+    {
+        emit addOutput(tr("Nothing changed since the last build; the Verilator output is up to date"),
+                       BuildStep::MessageOutput);
+        fi.reportResult(true);
+        emit finished();
+        return;
+    }
+    QFile::remove( d_fpFile );
+    d_time.start();
     AbstractProcessStep::run(fi);
 }
 
+bool VerilatorMakeStep::processSucceeded(int exitCode, QProcess::ExitStatus status)
+{
+    const bool ok = AbstractProcessStep::processSucceeded( exitCode, status );
+    if( ok )
+        BuildFingerprint::save( d_fpFile, d_fp );
+    return ok;
+}
+
+void VerilatorMakeStep::processFinished(int exitCode, QProcess::ExitStatus status)
+{
+    AbstractProcessStep::processFinished( exitCode, status );
+    emit addOutput( tr("Verilating took %1 s").arg( d_time.elapsed() / 1000.0, 0, 'f', 1 ),
+                    BuildStep::MessageOutput );
+}
+
+QString VerilatorMakeStep::optionArgs() const
+{
+    QString res;
+    if( d_threads > 0 )
+        res += QString("--threads %1 ").arg( d_threads );
+    if( d_outputSplit > 0 )
+        res += QString("--output-split %1 ").arg( d_outputSplit );
+    return res.trimmed();
+}
+
 ProjectExplorer::BuildStepConfigWidget* VerilatorMakeStep::createConfigWidget()
 {
     return new VerilatorMakeStepWidget(this);
@@ -261,6 +316,9 @@ ProjectExplorer::BuildStepConfigWidget* VerilatorMakeStep::createConfigWidget()
 
 static const char* MAKE_ARGUMENTS_KEY = "VerilogCreator.Verilator.MakeStep.Args";
 static const char* MAKE_COMMAND_KEY = "VerilogCreator.Verilator.MakeStep.Cmd";
+static const char* MAKE_PRUNE_KEY = "VerilogCreator.Verilator.MakeStep.Prune";
+static const char* MAKE_THREADS_KEY = "VerilogCreator.Verilator.MakeStep.Threads";
+static const char* MAKE_SPLIT_KEY = "VerilogCreator.Verilator.MakeStep.OutputSplit";
 
 QVariantMap VerilatorMakeStep::toMap() const
 {
@@ -268,6 +326,9 @@ QVariantMap VerilatorMakeStep::toMap() const
 
     map.insert(QLatin1String(MAKE_ARGUMENTS_KEY), d_args);
     map.insert(QLatin1String(MAKE_COMMAND_KEY), d_cmd);
+    map.insert(QLatin1String(MAKE_PRUNE_KEY), d_prune);
+    map.insert(QLatin1String(MAKE_THREADS_KEY), d_threads);
+    map.insert(QLatin1String(MAKE_SPLIT_KEY), d_outputSplit);
     return map;
 }
 
@@ -275,6 +336,9 @@ bool VerilatorMakeStep::fromMap(const QVariantMap& map)
 {
     d_args = map.value(QLatin1String(MAKE_ARGUMENTS_KEY)).toString();
     d_cmd = map.value(QLatin1String(MAKE_COMMAND_KEY)).toString();
+    d_prune = map.value(QLatin1String(MAKE_PRUNE_KEY)).toBool();
+    d_threads = map.value(QLatin1String(MAKE_THREADS_KEY)).toInt();
+    d_outputSplit = map.value(QLatin1String(MAKE_SPLIT_KEY)).toInt();
 
     return BuildStep::fromMap(map);
 }
@@ -302,13 +366,37 @@ VerilatorMakeStepWidget::VerilatorMakeStepWidget(VerilatorMakeStep* makeStep):d_
     d_args->setText(makeStep->d_args);
     fl->addRow( tr("Additional arguments:"), d_args );
 
+    d_prune = new QCheckBox(this);
+    d_prune->setChecked(makeStep->d_prune);
+    d_prune->setToolTip(tr("Only pass the directories of the files used by TOPMOD to -y"));
+    fl->addRow( tr("Only files used by TOPMOD:"), d_prune );
+
+    d_threads = new QSpinBox(this);
+    d_threads->setRange( 0, 1024 );
+    d_threads->setSpecialValueText(tr("off"));
+    d_threads->setValue(makeStep->d_threads);
+    d_threads->setToolTip(tr("Generate a multithreaded model (--threads)"));
+    fl->addRow( tr("Model threads:"), d_threads );
+
+    d_outputSplit = new QSpinBox(this);
+    d_outputSplit->setRange( 0, 1000000 );
+    d_outputSplit->setSingleStep( 1000 );
+    d_outputSplit->setSpecialValueText(tr("off"));
+    d_outputSplit->setValue(makeStep->d_outputSplit);
+    d_outputSplit->setToolTip(tr("Split the generated C++ files into chunks of about this many "
+                                 "statements, so they compile in parallel (--output-split)"));
+    fl->addRow( tr("Output split:"), d_outputSplit );
+
     updateMakeOverrrideLabel();
     updateDetails();
 
+    connect( d_threads, SIGNAL(valueChanged(int)), this, SLOT(optionsChanged()) );
+    connect( d_outputSplit, SIGNAL(valueChanged(int)), this, SLOT(optionsChanged()) );
     connect( d_cmd, &QLineEdit::textEdited,
             this, &VerilatorMakeStepWidget::makeLineEditTextEdited);
     connect( d_args, &QLineEdit::textEdited,
             this, &VerilatorMakeStepWidget::makeArgumentsLineEditTextEdited);
+    connect( d_prune, SIGNAL(toggled(bool)), this, SLOT(pruneToggled(bool)) );
 
     connect(ProjectExplorer::ProjectExplorerPlugin::instance(), SIGNAL(settingsChanged()),
             this, SLOT(updateMakeOverrrideLabel()));
@@ -348,6 +436,19 @@ void VerilatorMakeStepWidget::makeArgumentsLineEditTextEdited()
     updateDetails();
 }
 
+void VerilatorMakeStepWidget::pruneToggled(bool on)
+{
+    d_step->d_prune = on;
+    updateDetails();
+}
+
+void VerilatorMakeStepWidget::optionsChanged()
+{
+    d_step->d_threads = d_threads->value();
+    d_step->d_outputSplit = d_outputSplit->value();
+    updateDetails();
+}
+
 void VerilatorMakeStepWidget::updateMakeOverrrideLabel()
 {
     ProjectExplorer::BuildConfiguration *bc = d_step->buildConfiguration();
@@ -371,10 +472,249 @@ void VerilatorMakeStepWidget::updateDetails()
     param.setWorkingDirectory(bc->buildDirectory().toString());
     param.setEnvironment(bc->environment());
     param.setCommand(d_step->makeCommand(bc->environment()));
-    param.setArguments( QString("%4 --Mdir %2 -f %1 %3").arg(s_cmdFileName)
+    param.setArguments( QString("%4 --Mdir %2 -f %1 %3 %5").arg(s_cmdFileName)
                         .arg(s_simDir).arg(d_step->d_args)
-                        .arg( p->getConfig("VLTR_ARGS").join(QChar(' ')) ));
+                        .arg( p->getConfig("VLTR_ARGS").join(QChar(' ')) ).arg( d_step->optionArgs() ));
+
+    d_summary = param.summary(displayName());
+    emit updateSummary();
+}
+
+
+VerilatorCompileStep::VerilatorCompileStep(ProjectExplorer::BuildStepList* parent):
+    AbstractProcessStep(parent, ID),d_jobs(0),d_ccache(false)
+{
+    setDefaultDisplayName(tr("make") );
+}
+
+bool VerilatorCompileStep::init()
+{
+    ProjectExplorer::BuildConfiguration *bc = buildConfiguration();
+    if (!bc)
+        bc = target()->activeBuildConfiguration();
+    if (!bc)
+        emit addTask(ProjectExplorer::Task::buildConfigurationMissingTask());
+
+    ProjectExplorer::ProcessParameters *pp = processParameters();
+    QDir buildDir = bc->buildDirectory().toString();
+    d_workDir = QDir::cleanPath( buildDir.absoluteFilePath(s_simDir) );
+    pp->setWorkingDirectory( d_workDir );
+    Utils::Environment env = bc->environment();
+    pp->setEnvironment(env);
+    pp->setCommand(makeCommand(env));
+
+    Vl::Project* p = dynamic_cast<Vl::Project*>( project() );
+    Q_ASSERT( p != 0 );
+    d_top = p->getTopMod().split( QRegExp("\\s+"), QString::SkipEmptyParts ).value(0);
+
+    // the makefile is only known after the verilator step has run; see run()
+    QString args = QString("-j%1 ").arg( getJobs() );
+    if( d_ccache )
+    {
+        // verilated.mk prefixes each compiler call with $(OBJCACHE)
+        if( env.searchInPath("ccache").isEmpty() )
+            emit addTask(ProjectExplorer::Task(ProjectExplorer::Task::Warning,
+                           tr("ccache was not found in the PATH; compiling without it"),
+                           Utils::FileName(), -1,
+                           ProjectExplorer::Constants::TASK_CATEGORY_BUILDSYSTEM) );
+        else
+            args += "OBJCACHE=ccache ";
+    }
+    Utils::QtcProcess::addArgs( &args, d_args );
+    pp->setArguments( args );
+
+    setIgnoreReturnValue(false);
+
+    setOutputParser(new ProjectExplorer::GccParser());
+    outputParser()->setWorkingDirectory(d_workDir);
+
+    return AbstractProcessStep::init();
+}
+
+void VerilatorCompileStep::run(QFutureInterface<bool>& fi)
+{
+    const QString mk = findMakefile();
+    if( mk.isEmpty() )
+    {
+        emit addOutput(tr("No Verilator makefile found in %1; the verilator step has to run first")
+                       .arg( QDir::toNativeSeparators(d_workDir) ), BuildStep::ErrorMessageOutput);
+        fi.reportResult(false);
+        emit finished();
+        return;
+    }
+    ProjectExplorer::ProcessParameters *pp = processParameters();
+    pp->setArguments( QString("-f %1 %2").arg( Utils::QtcProcess::quoteArg( mk ) ).arg( pp->arguments() ) );
+    pp->resolveAll();
+    d_time.start();
+    AbstractProcessStep::run(fi);
+}
+
+void VerilatorCompileStep::processFinished(int exitCode, QProcess::ExitStatus status)
+{
+    AbstractProcessStep::processFinished( exitCode, status );
+    emit addOutput( tr("Compiling the model with %1 jobs took %2 s").arg( getJobs() )
+                    .arg( d_time.elapsed() / 1000.0, 0, 'f', 1 ), BuildStep::MessageOutput );
+}
+
+QString VerilatorCompileStep::findMakefile() const
+{
+    QDir dir( d_workDir );
+    const QString mk = QString("V%1.mk").arg( d_top );
+    if( !d_top.isEmpty() && dir.exists( mk ) )
+        return mk;
+    // e.g. with --prefix or without TOPMOD; take the model makefile if it is unique
+    QStringList res;
+    foreach( const QString& f, dir.entryList( QStringList() << "*.mk", QDir::Files ) )
+    {
+        if( !f.endsWith( "_classes.mk" ) )
+            res.append( f );
+    }
+    if( res.size() == 1 )
+        return res.first();
+    return QString();
+}
+
+int VerilatorCompileStep::getJobs() const
+{
+    if( d_jobs > 0 )
+        return d_jobs;
+    return qMax( 1, QThread::idealThreadCount() );
+}
+
+ProjectExplorer::BuildStepConfigWidget* VerilatorCompileStep::createConfigWidget()
+{
+    return new VerilatorCompileStepWidget(this);
+}
+
+static const char* COMPILE_ARGUMENTS_KEY = "VerilogCreator.Verilator.CompileStep.Args";
+static const char* COMPILE_COMMAND_KEY = "VerilogCreator.Verilator.CompileStep.Cmd";
+static const char* COMPILE_JOBS_KEY = "VerilogCreator.Verilator.CompileStep.Jobs";
+static const char* COMPILE_CCACHE_KEY = "VerilogCreator.Verilator.CompileStep.Ccache";
+
+QVariantMap VerilatorCompileStep::toMap() const
+{
+    QVariantMap map(AbstractProcessStep::toMap());
+
+    map.insert(QLatin1String(COMPILE_ARGUMENTS_KEY), d_args);
+    map.insert(QLatin1String(COMPILE_COMMAND_KEY), d_cmd);
+    map.insert(QLatin1String(COMPILE_JOBS_KEY), d_jobs);
+    map.insert(QLatin1String(COMPILE_CCACHE_KEY), d_ccache);
+    return map;
+}
+
+bool VerilatorCompileStep::fromMap(const QVariantMap& map)
+{
+    d_args = map.value(QLatin1String(COMPILE_ARGUMENTS_KEY)).toString();
+    d_cmd = map.value(QLatin1String(COMPILE_COMMAND_KEY)).toString();
+    d_jobs = map.value(QLatin1String(COMPILE_JOBS_KEY)).toInt();
+    d_ccache = map.value(QLatin1String(COMPILE_CCACHE_KEY)).toBool();
+
+    return BuildStep::fromMap(map);
+}
+
+QString VerilatorCompileStep::makeCommand(const Utils::Environment& environment) const
+{
+    QString command = d_cmd;
+    if (command.isEmpty())
+        command = environment.searchInPath("make").toString();
+    return command;
+}
+
+VerilatorCompileStepWidget::VerilatorCompileStepWidget(VerilatorCompileStep* step):d_step(step)
+{
+    QFormLayout *fl = new QFormLayout(this);
+    fl->setContentsMargins(0, -1, 0, -1);
+    fl->setFieldGrowthPolicy(QFormLayout::ExpandingFieldsGrow);
+
+    d_cmd = new QLineEdit(this);
+    d_cmd->setText(step->d_cmd);
+    d_cmdLabel = new QLabel(this);
+    fl->addRow( d_cmdLabel, d_cmd );
+
+    d_args = new QLineEdit(this);
+    d_args->setText(step->d_args);
+    fl->addRow( tr("Additional arguments:"), d_args );
+
+    d_jobs = new QSpinBox(this);
+    d_jobs->setRange( 0, 1024 );
+    d_jobs->setSpecialValueText(tr("one per core"));
+    d_jobs->setValue(step->d_jobs);
+    fl->addRow( tr("Parallel jobs:"), d_jobs );
+
+    d_ccache = new QCheckBox(this);
+    d_ccache->setChecked(step->d_ccache);
+    fl->addRow( tr("Use ccache:"), d_ccache );
+
+    updateMakeOverrrideLabel();
+    updateDetails();
+
+    connect( d_cmd, SIGNAL(textEdited(QString)), this, SLOT(edited()) );
+    connect( d_args, SIGNAL(textEdited(QString)), this, SLOT(edited()) );
+    connect( d_jobs, SIGNAL(valueChanged(int)), this, SLOT(edited()) );
+    connect( d_ccache, SIGNAL(toggled(bool)), this, SLOT(edited()) );
 
+    connect(ProjectExplorer::ProjectExplorerPlugin::instance(), SIGNAL(settingsChanged()),
+            this, SLOT(updateMakeOverrrideLabel()));
+    connect(ProjectExplorer::ProjectExplorerPlugin::instance(), SIGNAL(settingsChanged()),
+            this, SLOT(updateDetails()));
+
+    connect(step->target(), SIGNAL(kitChanged()),
+            this, SLOT(updateMakeOverrrideLabel()));
+
+    connect(step->target()->project(), &ProjectExplorer::Project::environmentChanged,
+            this, &VerilatorCompileStepWidget::updateMakeOverrrideLabel);
+    connect(step->target()->project(), &ProjectExplorer::Project::environmentChanged,
+            this, &VerilatorCompileStepWidget::updateDetails);
+}
+
+QString VerilatorCompileStepWidget::displayName() const
+{
+    return tr("make");
+}
+
+QString VerilatorCompileStepWidget::summaryText() const
+{
+    return d_summary;
+}
+
+void VerilatorCompileStepWidget::edited()
+{
+    d_step->d_cmd = d_cmd->text();
+    d_step->d_args = d_args->text();
+    d_step->d_jobs = d_jobs->value();
+    d_step->d_ccache = d_ccache->isChecked();
+    updateMakeOverrrideLabel();
+    updateDetails();
+}
+
+void VerilatorCompileStepWidget::updateMakeOverrrideLabel()
+{
+    ProjectExplorer::BuildConfiguration *bc = d_step->buildConfiguration();
+    if (!bc)
+        bc = d_step->target()->activeBuildConfiguration();
+
+    d_cmdLabel->setText(tr("Override %1:").arg(QDir::toNativeSeparators(d_step->makeCommand(bc->environment()))));
+}
+
+void VerilatorCompileStepWidget::updateDetails()
+{
+    ProjectExplorer::BuildConfiguration *bc = d_step->buildConfiguration();
+    if (!bc)
+        bc = d_step->target()->activeBuildConfiguration();
+
+    Vl::Project* p = dynamic_cast<Vl::Project*>( d_step->target()->project() );
+    Q_ASSERT( p != 0 );
+    QString top = p->getTopMod().split( QRegExp("\\s+"), QString::SkipEmptyParts ).value(0);
+    if( top.isEmpty() )
+        top = "*";
+
+    ProjectExplorer::ProcessParameters param;
+    param.setMacroExpander(bc->macroExpander());
+    param.setWorkingDirectory(bc->buildDirectory().toString());
+    param.setEnvironment(bc->environment());
+    param.setCommand(d_step->makeCommand(bc->environment()));
+    param.setArguments( QString("-f V%1.mk -j%2 %3%4").arg( top ).arg( d_step->getJobs() )
+                        .arg( d_step->d_ccache ? "OBJCACHE=ccache " : "" ).arg( d_step->d_args ) );
     d_summary = param.summary(displayName());
     emit updateSummary();
 }
@@ -404,6 +744,7 @@ void VerilatorCleanStep::run(QFutureInterface<bool>& fi)
     if( buildDir.exists() )
     {
         QFile::remove( buildDir.absoluteFilePath(s_cmdFileName) );
+        QFile::remove( buildDir.absoluteFilePath(s_fingerprintFileName) );
         //QFile::remove( buildDir.absoluteFilePath(s_simDir) );
     }
     AbstractProcessStep::run(fi);
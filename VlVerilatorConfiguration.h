@@ -25,9 +25,11 @@
 #include <projectexplorer/abstractprocessstep.h>
 #include <projectexplorer/localapplicationrunconfiguration.h>
 #include <utils/pathchooser.h>
+#include <QElapsedTimer>
 
 class QLabel;
 class QCheckBox;
+class QSpinBox;
 
 namespace Vl
 {
@@ -83,9 +85,23 @@ namespace Vl
     protected:
         QString makeCommand(const Utils::Environment &environment) const;
         bool fromMap(const QVariantMap &map);
+        bool processSucceeded(int exitCode, QProcess::ExitStatus status);
+        void processFinished(int exitCode, QProcess::ExitStatus status);
+        QString optionArgs() const;
     private:
         QString d_cmd;
         QString d_args;
+        // the fingerprint is computed in run(), off the GUI thread, from what init() collected
+        QStringList d_fpSources;
+        QStringList d_fpIncDirs;
+        QByteArray d_fpConfig;
+        QString d_fpFile;
+        QByteArray d_fp;
+        QString d_mdir;
+        QElapsedTimer d_time;
+        int d_threads; // --threads, 0 is off
+        int d_outputSplit; // --output-split, 0 is off
+        bool d_prune; // only search the directories of the files used by TOPMOD
         friend class VerilatorMakeStepWidget;
     };
 
@@ -101,6 +117,8 @@ namespace Vl
     private slots:
         void makeLineEditTextEdited();
         void makeArgumentsLineEditTextEdited();
+        void pruneToggled(bool);
+        void optionsChanged();
         void updateMakeOverrrideLabel();
         void updateDetails();
 
@@ -110,6 +128,64 @@ namespace Vl
         QLabel* d_cmdLabel;
         QLineEdit* d_cmd;
         QLineEdit* d_args;
+        QCheckBox* d_prune;
+        QSpinBox* d_threads;
+        QSpinBox* d_outputSplit;
+    };
+
+    // Compiles the C++ model generated by VerilatorMakeStep using the V<top>.mk makefile
+    class VerilatorCompileStep : public ProjectExplorer::AbstractProcessStep
+    {
+        Q_OBJECT
+    public:
+        static const char* ID;
+
+        explicit VerilatorCompileStep(ProjectExplorer::BuildStepList *parent);
+
+        bool init();
+        void run(QFutureInterface<bool> &fi);
+        bool immutable() const { return false; }
+        ProjectExplorer::BuildStepConfigWidget* createConfigWidget();
+        QVariantMap toMap() const;
+        int getJobs() const;
+    protected:
+        QString makeCommand(const Utils::Environment &environment) const;
+        bool fromMap(const QVariantMap &map);
+        void processFinished(int exitCode, QProcess::ExitStatus status);
+        QString findMakefile() const;
+    private:
+        QString d_cmd;
+        QString d_args;
+        QString d_top;
+        QString d_workDir;
+        QElapsedTimer d_time;
+        int d_jobs; // 0 is one per core
+        bool d_ccache;
+        friend class VerilatorCompileStepWidget;
+    };
+
+    class VerilatorCompileStepWidget : public ProjectExplorer::BuildStepConfigWidget
+    {
+        Q_OBJECT
+
+    public:
+        VerilatorCompileStepWidget(VerilatorCompileStep *step);
+        QString displayName() const;
+        QString summaryText() const;
+
+    private slots:
+        void edited();
+        void updateMakeOverrrideLabel();
+        void updateDetails();
+
+    private:
+        VerilatorCompileStep* d_step;
+        QString d_summary;
+        QLabel* d_cmdLabel;
+        QLineEdit* d_cmd;
+        QLineEdit* d_args;
+        QSpinBox* d_jobs;
+        QCheckBox* d_ccache;
     };
 
     class VerilatorCleanStep : public ProjectExplorer::AbstractProcessStep
@@ -26,7 +26,12 @@
 #include "VlAutoCompleter.h"
 #include "VlCompletionAssistProvider.h"
 #include "VlModelManager.h"
+#include "VlCodeIndex.h"
+#include "VlUsagesSearch.h"
 #include "VlOutlineMdl.h"
+#include "VlProject.h"
+#include "VlSdfIndex.h"
+#include "VlLargeFileViewer.h"
 #include <Verilog/VlCrossRefModel.h>
 #include <Verilog/VlPpSymbols.h>
 #include <Verilog/VlIncludes.h>
@@ -47,13 +52,21 @@
 #include <coreplugin/actionmanager/command.h>
 #include <coreplugin/actionmanager/actioncontainer.h>
 #include <coreplugin/editormanager/editormanager.h>
+#include <coreplugin/icore.h>
+#include <coreplugin/messagemanager.h>
 #include <QApplication>
+#include <QFileInfo>
+#include <QScrollBar>
+#include <QSettings>
+#include <QTextCursor>
 #include <QTextBlock>
 #include <QMenu>
 #include <QtDebug>
+#include <algorithm>
 using namespace Vl;
 
 static const int s_processIntervalMs = 150;
+static const int s_maxSdfPaths = 200; // listed per SDF file
 
 Editor1::Editor1()
 {
@@ -87,13 +100,14 @@ EditorFactory1::EditorFactory1()
                             );
 }
 
-EditorDocument1::EditorDocument1():d_opening(false)
+EditorDocument1::EditorDocument1():d_textValid(false),d_opening(false)
 {
     setId(Constants::EditorId1);
     // hier ist der Name noch nicht bekannt:
     // qDebug() << "doc created" << filePath().toString() << displayName();
 
     connect( this, SIGNAL(contentsChanged()), this, SLOT(onChangedContents()) );
+    connect( document(), SIGNAL(contentsChange(int,int,int)), this, SLOT(onContentsChange(int,int,int)) );
     d_processorTimer.setSingleShot(true);
     d_processorTimer.setInterval(s_processIntervalMs);
     connect(&d_processorTimer, SIGNAL(timeout()), this, SLOT(onProcess()));
@@ -104,12 +118,21 @@ EditorDocument1::~EditorDocument1()
 {
     // hier ist der Name bekannt:
     // qDebug() << "doc deleted" << filePath().toString() << displayName() ;
+    ModelManager::instance()->cancelUpdate( filePath().toString() );
     ModelManager::instance()->getFileCache()->removeFile( filePath().toString() );
 }
 
 TextEditor::TextDocument::OpenResult EditorDocument1::open(QString* errorString, const QString& fileName, const QString& realFileName)
 {
     //qDebug() << "before open" << fileName << realFileName;
+    if( LargeFileDocument::isLarge(realFileName) )
+    {
+        // the editor manager then offers the other editors for the type, i.e. the large file viewer
+        if( errorString )
+            *errorString = tr("%1 is too large for the Verilog Editor; open it with the %2.")
+                .arg(QFileInfo(fileName).fileName()).arg(QLatin1String(Constants::LargeFileDisplayName));
+        return OpenResult::CannotHandle;
+    }
     d_opening = true;
     const TextDocument::OpenResult res = TextDocument::open(errorString, fileName, realFileName );
     // wird nach EditorWidget::finalizeInitialization aufgerufen!
@@ -121,8 +144,24 @@ TextEditor::TextDocument::OpenResult EditorDocument1::open(QString* errorString,
 bool EditorDocument1::save(QString* errorString, const QString& fileName, bool autoSave)
 {
     const bool res = TextDocument::save(errorString,fileName, autoSave);
-    if( !autoSave )
-        ModelManager::instance()->getFileCache()->removeFile( filePath().toString() );
+    if( res && !autoSave )
+    {
+        // the file on disk is now the latest state; instead of dropping a snapshot which is still on its way
+        // (or an edit which was not yet handed over) the model parses the saved file
+        const QString file = filePath().toString();
+        bool pending = d_processorTimer.isActive();
+        d_processorTimer.stop();
+        if( ModelManager::instance()->cancelUpdate( file ) )
+            pending = true;
+        ModelManager::instance()->getFileCache()->removeFile( file );
+        if( pending )
+        {
+            CrossRefModel* mdl = ModelManager::instance()->getModelForCurrentProject();
+            if( mdl == 0 )
+                mdl = ModelManager::instance()->getModelForDir(file);
+            mdl->updateFiles( QStringList() << file );
+        }
+    }
     return res;
 }
 
@@ -134,20 +173,60 @@ void EditorDocument1::onChangedContents()
         d_processorTimer.start(s_processIntervalMs);
 }
 
+void EditorDocument1::onContentsChange(int pos, int removed, int added)
+{
+    if( !d_textValid )
+        return;
+    // document positions count one character per block separator, as the plain text does
+    const int size = document()->characterCount() - 1; // without the final separator
+    const int end = qMin( pos + added, size );
+    if( pos < 0 || pos > d_text.size() || pos + removed > d_text.size() + 1 || end < pos )
+    {
+        d_textValid = false;
+        return;
+    }
+    QString text;
+    if( end > pos )
+    {
+        QTextCursor cur( document() );
+        cur.setPosition( pos );
+        cur.setPosition( end, QTextCursor::KeepAnchor );
+        text = cur.selectedText();
+        // same substitutions as QTextDocument::toPlainText
+        for( int i = 0; i < text.size(); i++ )
+        {
+            const ushort c = text[i].unicode();
+            if( c == QChar::ParagraphSeparator || c == QChar::LineSeparator )
+                text[i] = QLatin1Char('\n');
+            else if( c == QChar::Nbsp )
+                text[i] = QLatin1Char(' ');
+        }
+    }
+    d_text.replace( pos, qMin( removed, d_text.size() - pos ), text );
+    if( d_text.size() != size )
+        d_textValid = false; // e.g. a change involving the final separator; start over on the next process
+}
+
 void EditorDocument1::onProcess()
 {
     emit sigStartProcessing();
     const QString file = filePath().toString();
-    ModelManager::instance()->getFileCache()->addFile( file, plainText().toLatin1() );
     CrossRefModel* mdl = ModelManager::instance()->getModelForCurrentProject();
     if( mdl == 0 )
         mdl = ModelManager::instance()->getModelForDir(file);
-    mdl->updateFiles( QStringList() << file );
+    if( !d_textValid )
+    {
+        d_text = plainText();
+        d_textValid = true;
+    }
+    // encoding and cache handover happen on the parse worker; the model is updated when the snapshot is ready.
+    // The worker shares d_text until it has encoded it.
+    ModelManager::instance()->scheduleUpdate( mdl, file, d_text );
 }
 
 typedef QList<QTextEdit::ExtraSelection> ExtraSelections;
 
-EditorWidget1::EditorWidget1():d_outline(0)
+EditorWidget1::EditorWidget1():d_outline(0),d_lazy(false),d_lazyLines(0),d_from(0),d_to(0)
 {
 }
 
@@ -162,6 +241,8 @@ void EditorWidget1::finalizeInitialization()
 
     connect( textDocument(), SIGNAL(filePathChanged(Utils::FileName,Utils::FileName)), this, SLOT(onDocReady()) );
     connect( this, SIGNAL(cursorPositionChanged()), this, SLOT(onCursor()) );
+    connect( verticalScrollBar(), SIGNAL(valueChanged(int)), this, SLOT(onViewportChanged()) );
+    connect( document(), SIGNAL(blockCountChanged(int)), this, SLOT(onBlockCountChanged(int)) );
     connect( qobject_cast<EditorDocument1*>(textDocument()), SIGNAL(sigStartProcessing()),
              this, SLOT(onStartProcessing()) );
 
@@ -182,17 +263,12 @@ void EditorWidget1::finalizeInitialization()
     OutlineMdl1* outline = new OutlineMdl1(this);
     d_outline->setModel(outline);
     connect( outline, SIGNAL(modelReset()), this, SLOT(onCursor()) );
+    connect( outline, SIGNAL(sigUpdated()), this, SLOT(onCursor()) );
 
     insertExtraToolBarWidget(TextEditorWidget::Left, d_outline );
 
 }
 
-static bool lessThan1(const CrossRefModel::SymRef &s1, const CrossRefModel::SymRef &s2)
-{
-    return s1->tok().d_lineNr < s2->tok().d_lineNr ||
-            ( !(s2->tok().d_lineNr < s1->tok().d_lineNr) && s1->tok().d_colNr < s2->tok().d_colNr );
-}
-
 void EditorWidget1::onFindUsages()
 {
     QTextCursor cur = textCursor();
@@ -203,7 +279,7 @@ void EditorWidget1::onFindUsages()
     const int line = cur.blockNumber() + 1;
     const int col = cur.columnNumber() + 1;
 
-    CrossRefModel::TreePath path = mdl->findSymbolBySourcePos( file, line, col );
+    CrossRefModel::TreePath path = ModelManager::instance()->getIndex(mdl)->findSymbolBySourcePos( file, line, col );
     if( path.isEmpty() )
         return;
 
@@ -213,9 +289,8 @@ void EditorWidget1::onFindUsages()
         id = mdl->findDeclarationOfSymbol( path.first().data() ).data();
     if( id == 0 )
         return;
-    CrossRefModel::SymRefList res = mdl->findAllReferencingSymbols( id ); // hier ohne file filter!
+    CrossRefModel::SymRefList res = ModelManager::instance()->getIndex(mdl)->findAllReferencingSymbols( id ); // hier ohne file filter!
     res.append(CrossRefModel::SymRef(id));
-    std::sort(res.begin(), res.end(), lessThan1 );
 
     Core::SearchResult *search = Core::SearchResultWindow::instance()->startNewSearch(tr("Verilog Usages:"),
                                                 QString(),
@@ -224,16 +299,7 @@ void EditorWidget1::onFindUsages()
                                                 Core::SearchResultWindow::PreserveCaseDisabled,
                                                 QLatin1String("VerilogEditor"));
 
-    FileCache* fcache = ModelManager::instance()->getFileCache();
-    foreach( const CrossRefModel::SymRef& st, res )
-    {
-        search->addResult( st->tok().d_sourcePath,
-                          st->tok().d_lineNr,
-                          fcache->fetchTextLineFromFile( st->tok().d_sourcePath, st->tok().d_lineNr, st->tok().d_val ), // TODO: ev. effizienter
-                          st->tok().d_colNr - 1,
-                          st->tok().d_len);
-    }
-    search->finishSearch(false);
+    UsagesSearch::start( search, res );
     connect(search, SIGNAL(activated(Core::SearchResultItem)),
             this, SLOT(onOpenEditor(Core::SearchResultItem)));
 
@@ -241,6 +307,185 @@ void EditorWidget1::onFindUsages()
     search->popup();
 }
 
+static void collectInstances( const CrossRefModel::Branch* b, QList<const CrossRefModel::Branch*>& res )
+{
+    foreach( const CrossRefModel::SymRef& sub, b->children() )
+    {
+        const CrossRefModel::Branch* b2 = sub->toBranch();
+        if( sub->tok().d_type == SynTree::R_module_or_udp_instance_ && !sub->tok().d_val.isEmpty() &&
+                b2 && b2->super() )
+            res.append( b2 );
+        if( b2 )
+            collectInstances( b2, res );
+    }
+}
+
+// The instance names leading from the modules nobody instantiates down to inst in module, e.g.
+// {"u_core","u_alu"}; one list per way the module is reached, at most max of them
+static QList<QList<QByteArray> > instancePaths( CrossRefModel* mdl, const QByteArray& module,
+                                                const QByteArray& inst, int max )
+{
+    QHash<QByteArray,QList<QPair<QByteArray,QByteArray> > > users; // module -> (instantiating module, instance)
+    foreach( const CrossRefModel::IdentDeclRef& id, mdl->getGlobalNames() )
+    {
+        const CrossRefModel::Symbol* decl = id->decl();
+        if( decl == 0 || decl->tok().d_type != SynTree::R_module_declaration || decl->toBranch() == 0 )
+            continue;
+        QList<const CrossRefModel::Branch*> insts;
+        collectInstances( decl->toBranch(), insts );
+        foreach( const CrossRefModel::Branch* b, insts )
+            users[ b->super()->tok().d_val ].append( qMakePair( id->tok().d_val, b->tok().d_val ) );
+    }
+
+    QList<QList<QByteArray> > res;
+    QList<QPair<QByteArray,QList<QByteArray> > > todo; // the module to go up from and the path below it
+    todo.append( qMakePair( module, QList<QByteArray>() << inst ) );
+    while( !todo.isEmpty() && res.size() < max )
+    {
+        const QPair<QByteArray,QList<QByteArray> > cur = todo.takeLast();
+        const QList<QPair<QByteArray,QByteArray> > up = users.value( cur.first );
+        if( up.isEmpty() || cur.second.size() > users.size() ) // a top, or a recursive instantiation
+        {
+            res.append( cur.second );
+            continue;
+        }
+        for( int i = 0; i < up.size(); i++ )
+            todo.append( qMakePair( up[i].first, QList<QByteArray>() << up[i].second << cur.second ) );
+    }
+    return res;
+}
+
+void EditorWidget1::onShowSdfDelays()
+{
+    QTextCursor cur = textCursor();
+    const QString file = textDocument()->filePath().toString();
+    CrossRefModel* mdl = ModelManager::instance()->getModelForCurrentProjectOrDirPath(file);
+    if( mdl == 0 )
+        return;
+
+    const int line = cur.blockNumber() + 1;
+    const int col = cur.columnNumber() + 1;
+
+    CrossRefModel::TreePath path = ModelManager::instance()->getIndex(mdl)->findSymbolBySourcePos( file, line, col );
+    QByteArray inst;
+    foreach( const CrossRefModel::SymRef& sym, path )
+    {
+        if( sym->tok().d_type == SynTree::R_module_or_udp_instance_ && !sym->tok().d_val.isEmpty() )
+        {
+            inst = sym->tok().d_val;
+            break;
+        }
+    }
+    if( inst.isEmpty() )
+    {
+        Core::MessageManager::write( tr("Place the cursor on a module instance to show its SDF delays") );
+        return;
+    }
+    // the module containing the instance, to find the hierarchical paths it is reached by
+    QByteArray module;
+    foreach( const CrossRefModel::IdentDeclRef& id, mdl->getGlobalNames(file) )
+    {
+        foreach( const CrossRefModel::SymRef& sym, path )
+        {
+            if( id->decl() == sym.constData() )
+            {
+                module = id->tok().d_val;
+                break;
+            }
+        }
+        if( !module.isEmpty() )
+            break;
+    }
+    showSdfDelays( inst, module );
+}
+
+void EditorWidget1::showSdfDelays(const QByteArray& instName, const QByteArray& module)
+{
+    Project* pro = dynamic_cast<Project*>( ProjectExplorer::ProjectTree::currentProject() );
+    const QStringList sdfFiles = pro ? pro->getSdfFiles() : QStringList();
+    if( sdfFiles.isEmpty() )
+    {
+        Core::MessageManager::write( tr("The project has no SDF files in OTHER_FILES") );
+        return;
+    }
+    QList<SdfIndex*> indices;
+    foreach( const QString& sdf, sdfFiles )
+    {
+        SdfIndex* idx = ModelManager::instance()->getSdfIndex(sdf);
+        if( idx == 0 )
+        {
+            // still being indexed; try again when it's done
+            d_pendingSdf = instName;
+            d_pendingSdfModule = module;
+            connect( ModelManager::instance(), SIGNAL(sigSdfIndexReady(QString)),
+                     this, SLOT(onSdfIndexReady()), Qt::UniqueConnection );
+            Core::MessageManager::write( tr("Indexing %1, please wait...").arg(sdf) );
+            return;
+        }
+        indices.append(idx);
+    }
+    d_pendingSdf.clear();
+    d_pendingSdfModule.clear();
+
+    QList<QList<QByteArray> > hier;
+    CrossRefModel* mdl = ModelManager::instance()->getModelForFile( pro->projectFilePath().toString() );
+    if( mdl && !module.isEmpty() )
+        hier = instancePaths( mdl, module, instName, s_maxSdfPaths );
+
+    QString firstFile;
+    quint32 firstLine = 0;
+    foreach( SdfIndex* idx, indices )
+    {
+        // prefer the paths the model knows; the SDF may have been written for a testbench above the tops
+        QList<QByteArray> paths;
+        for( int i = 0; i < hier.size() && paths.size() <= s_maxSdfPaths; i++ )
+            paths += idx->findByPath( hier[i], s_maxSdfPaths + 1 - paths.size() );
+        const bool byName = paths.isEmpty();
+        if( byName )
+            paths = idx->findByName( instName, s_maxSdfPaths + 1 );
+        std::sort( paths.begin(), paths.end() );
+        paths.erase( std::unique( paths.begin(), paths.end() ), paths.end() );
+        const bool more = paths.size() > s_maxSdfPaths;
+        if( more )
+            paths = paths.mid( 0, s_maxSdfPaths );
+
+        QString msg = tr("SDF delays of %1 in %2").arg(QString::fromLatin1(instName)).arg(idx->getPath());
+        if( !idx->getTimescale().isEmpty() )
+            msg += tr(" (timescale %1)").arg(QString::fromLatin1(idx->getTimescale()));
+        if( byName && !paths.isEmpty() && !hier.isEmpty() )
+            msg += tr(", matched by the instance name only");
+        msg += QLatin1Char('\n');
+        if( paths.isEmpty() )
+            msg += tr("    no CELL entries\n");
+        foreach( const QByteArray& p, paths )
+        {
+            const SdfIndex::Cell c = idx->getCell(p);
+            const float worst = idx->getWorstDelay(p);
+            msg += tr("    %1 %2 worst %3, %4 IOPATH, %5 INTERCONNECT, line %6\n")
+                    .arg(QString::fromLatin1(p)).arg(QString::fromLatin1(c.d_type))
+                    .arg( worst < 0 ? tr("n/a") : QString::number(worst) )
+                    .arg(c.d_iopaths).arg(c.d_interconnects).arg(c.d_line);
+            if( firstLine == 0 )
+            {
+                firstFile = idx->getPath();
+                firstLine = c.d_line;
+            }
+        }
+        if( more )
+            msg += tr("    only the first %1 paths are shown\n").arg(s_maxSdfPaths);
+        Core::MessageManager::write( msg, Core::MessageManager::ModeSwitch );
+    }
+    if( firstLine != 0 )
+        Core::EditorManager::openEditorAt( firstFile, firstLine, 0, LargeFileDocument::isLarge(firstFile) ?
+                                               Core::Id(Constants::LargeFileEditorId) : Core::Id() );
+}
+
+void EditorWidget1::onSdfIndexReady()
+{
+    if( !d_pendingSdf.isEmpty() )
+        showSdfDelays( d_pendingSdf, d_pendingSdfModule );
+}
+
 void EditorWidget1::onGotoOuterBlock()
 {
     QTextCursor cur = textCursor();
@@ -252,7 +497,7 @@ void EditorWidget1::onGotoOuterBlock()
     const int line = cur.blockNumber() + 1;
     const int col = cur.columnNumber() + 1;
 
-    CrossRefModel::TreePath path = mdl->findSymbolBySourcePos( file, line, col, false );
+    CrossRefModel::TreePath path = ModelManager::instance()->getIndex(mdl)->findSymbolBySourcePos( file, line, col, false );
 //    for( int i = 0; i < path.size(); i++ )
 //        qDebug() << "path" << i << path[i]->getTypeName() << SynTree::rToStr(path[i]->tok().d_type) << path[i]->tok().d_val;
     for( int i = 1; i < path.size(); i++ )
@@ -282,6 +527,7 @@ void EditorWidget1::onFileUpdated(const QString& path)
 
 void EditorWidget1::onStartProcessing()
 {
+    d_uses.clear();
     setExtraSelections( TextEditor::TextEditorWidget::CodeSemanticsSelection, ExtraSelections() );
     setExtraSelections( TextEditor::TextEditorWidget::CodeWarningsSelection, ExtraSelections() );
 }
@@ -312,6 +558,8 @@ void EditorWidget1::onUpdateCodeWarnings()
 
     foreach (const Errors::Entry& e, errs)
     {
+        if( !isInWindow( e.d_line ) )
+            continue;
         QTextCursor c( doc->findBlockByNumber(e.d_line - 1) );
 
         c.setPosition( c.position() + e.d_col - 1 );
@@ -408,7 +656,7 @@ TextEditor::TextEditorWidget::Link EditorWidget1::findLinkAt(const QTextCursor&
             }
         }else if( t.d_type == Tok_Ident )
         {
-            CrossRefModel::IdentDeclRef id = mdl->findDeclarationOfSymbolAtSourcePos( file, line, col );
+            CrossRefModel::IdentDeclRef id = ModelManager::instance()->getIndex(mdl)->findDeclarationOfSymbolAtSourcePos( file, line, col );
             if( id.data() == 0 )
                 return Link();
             Link l( id->tok().d_sourcePath, id->tok().d_lineNr, id->tok().d_colNr - 1 );
@@ -459,8 +707,17 @@ void EditorWidget1::onUpdateIfDefsOut()
             startLine = idol[i];
         else
         {
+            quint32 endLine = idol[i];
+            if( d_lazy )
+            {
+                // clip to the covered lines
+                if( endLine < d_from || startLine > d_to )
+                    continue;
+                startLine = qMax( startLine, d_from );
+                endLine = qMin( endLine, d_to );
+            }
             QTextBlock a = document()->findBlockByNumber(startLine - 1);
-            QTextBlock b = document()->findBlockByNumber(idol[i]);
+            QTextBlock b = document()->findBlockByNumber(endLine);
             ranges.append(TextEditor::BlockRange( a.position(), b.position() ) );
             // funktioniert nicht:
 //            for( int j = startLine; j < idol[i]; j++ )
@@ -475,20 +732,24 @@ void EditorWidget1::onUpdateIfDefsOut()
 }
 
 static ExtraSelections toExtraSelections(const CrossRefModel::SymRefList& uses,
-                                                           TextEditor::TextStyle style, TextEditor::TextDocument* document )
+                                                           TextEditor::TextStyle style, TextEditor::TextDocument* document,
+                                         quint32 from = 0, quint32 to = ~quint32(0) )
 {
     ExtraSelections result;
 
     QTextDocument* doc = document->document();
+    const QTextCharFormat format = document->fontSettings().toTextCharFormat(style);
 
     foreach (const CrossRefModel::SymRef& use, uses)
     {
+        if( use->tok().d_lineNr < from || use->tok().d_lineNr > to )
+            continue;
         const int position = doc->findBlockByNumber(use->tok().d_lineNr - 1).position() +
                 use->tok().d_colNr - 1;
         const int anchor = position + use->tok().d_len;
 
         QTextEdit::ExtraSelection sel; //
-        sel.format = document->fontSettings().toTextCharFormat(style);
+        sel.format = format;
         sel.cursor = QTextCursor(doc);
         sel.cursor.setPosition(anchor);
         sel.cursor.setPosition(position, QTextCursor::KeepAnchor);
@@ -511,7 +772,7 @@ void EditorWidget1::onCursor()
     const int line = cur.blockNumber() + 1;
     const int col = cur.columnNumber() + 1;
 
-    CrossRefModel::TreePath path = mdl->findSymbolBySourcePos( file, line, col );
+    CrossRefModel::TreePath path = ModelManager::instance()->getIndex(mdl)->findSymbolBySourcePos( file, line, col );
     if( !path.isEmpty() )
     {
         // mark all symbol references in text
@@ -521,17 +782,16 @@ void EditorWidget1::onCursor()
             id = mdl->findDeclarationOfSymbol( path.first().data() );
         if( id.data() != 0 )
         {
-            CrossRefModel::SymRefList res = mdl->findReferencingSymbolsByFile( id.data(), file );
+            CrossRefModel::SymRefList res = ModelManager::instance()->getIndex(mdl)->findReferencingSymbolsByFile( id.data(), file );
             if( id->tok().d_sourcePath == file )
                 res.append(id);
             // qDebug() << "******* hit on" << id->tok().d_val;
 //            foreach( const CrossRefModel::SymRef& ref, res )
 //                qDebug() << QFileInfo(ref->tok().d_sourcePath).fileName() << ref->tok().d_lineNr << ref->tok().d_colNr;
-            setExtraSelections(TextEditor::TextEditorWidget::CodeSemanticsSelection,
-                               toExtraSelections(res, TextEditor::C_OCCURRENCES, textDocument() ) );
-
+            d_uses = res;
         }else
-            setExtraSelections(TextEditor::TextEditorWidget::CodeSemanticsSelection, ExtraSelections() );
+            d_uses.clear();
+        updateOccurrences();
     }
 
 //    path = mdl->findSymbolBySourcePos( file, line, col, false, true );
@@ -568,6 +828,40 @@ void EditorWidget1::onCursor()
     }
 }
 
+void EditorWidget1::updateOccurrences()
+{
+    if( d_lazy )
+        setExtraSelections(TextEditor::TextEditorWidget::CodeSemanticsSelection,
+                           toExtraSelections(d_uses, TextEditor::C_OCCURRENCES, textDocument(), d_from, d_to ) );
+    else
+        setExtraSelections(TextEditor::TextEditorWidget::CodeSemanticsSelection,
+                           toExtraSelections(d_uses, TextEditor::C_OCCURRENCES, textDocument() ) );
+}
+
+void EditorWidget1::resizeEvent(QResizeEvent* e)
+{
+    TextEditor::TextEditorWidget::resizeEvent(e);
+    onViewportChanged(); // a taller viewport may show lines beyond the window without any scrolling
+}
+
+void EditorWidget1::onViewportChanged()
+{
+    if( !d_lazy )
+        return;
+    const quint32 first = firstVisibleBlock().blockNumber() + 1;
+    const quint32 last = cursorForPosition( QPoint( 0, viewport()->height() - 1 ) ).blockNumber() + 1;
+    if( d_to != 0 && first >= d_from && last <= d_to )
+        return;
+    // the window moves with the viewport but keeps its size, so each pass covers a bounded number of lines
+    // however far the user scrolls; it is only moved once the visible part leaves it
+    const quint32 margin = qMax( quint32(200), 2 * ( last - first + 1 ) );
+    d_from = first > margin ? first - margin : 1;
+    d_to = last + margin;
+    onUpdateIfDefsOut();
+    onUpdateCodeWarnings();
+    updateOccurrences();
+}
+
 void EditorWidget1::onOpenEditor(const Core::SearchResultItem& item)
 {
     Core::EditorManager::openEditorAt( item.path.first(), item.lineNumber, item.textMarkPos);
@@ -585,10 +879,34 @@ void EditorWidget1::onDocReady()
     OutlineMdl1* outline = static_cast<OutlineMdl1*>( d_outline->model() );
     outline->setFile(fileName);
 
-    if( !mdl->isEmpty() )
+    d_lazyLines = Core::ICore::settings()->value( Constants::LazyLinesKey,
+                                                  Constants::LazyLinesDefault ).toInt();
+    d_lazy = d_lazyLines > 0 && document()->blockCount() > d_lazyLines;
+    d_from = d_to = 0;
+    if( d_lazy )
+        onViewportChanged(); // computes the window and runs the passes
+    else if( !mdl->isEmpty() )
+    {
+        onUpdateIfDefsOut();
+        onUpdateCodeWarnings();
+    }
+}
+
+void EditorWidget1::onBlockCountChanged(int count)
+{
+    // the file may cross the threshold by editing or reloading
+    const bool lazy = d_lazyLines > 0 && count > d_lazyLines;
+    if( lazy == d_lazy )
+        return;
+    d_lazy = lazy;
+    d_from = d_to = 0;
+    if( d_lazy )
+        onViewportChanged();
+    else
     {
         onUpdateIfDefsOut();
         onUpdateCodeWarnings();
+        updateOccurrences();
     }
 }
 
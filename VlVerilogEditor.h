@@ -23,6 +23,7 @@
 #include <texteditor/texteditor.h>
 #include <texteditor/textdocument.h>
 #include <utils/treeviewcombobox.h>
+#include <Verilog/VlCrossRefModel.h>
 #include <QTimer>
 
 namespace Core { class SearchResultItem; }
@@ -61,9 +62,14 @@ namespace Vl
 
     protected slots:
         void onChangedContents();
+        void onContentsChange( int pos, int removed, int added );
         void onProcess();
     private:
         QTimer d_processorTimer;
+        // the plain text of the document, patched with each change, so onProcess doesn't have to extract
+        // the whole document again after each pause in typing; built on first use
+        QString d_text;
+        bool d_textValid;
         bool d_opening;
     };
 
@@ -82,6 +88,7 @@ namespace Vl
     public slots:
         void onFindUsages();
         void onGotoOuterBlock();
+        void onShowSdfDelays();
         void onFileUpdated( const QString& );
         void onStartProcessing();
 
@@ -89,6 +96,7 @@ namespace Vl
         Link findLinkAt(const QTextCursor &, bool resolveTarget = true,
                         bool inNextSplit = false) Q_DECL_OVERRIDE;
         void contextMenuEvent(QContextMenuEvent *e) Q_DECL_OVERRIDE;
+        void resizeEvent(QResizeEvent *e) Q_DECL_OVERRIDE;
 
     protected slots:
         void onUpdateIfDefsOut();
@@ -98,8 +106,22 @@ namespace Vl
         void onDocReady();
         void gotoSymbolInEditor();
         void updateToolTip();
+        void onViewportChanged();
+        void onBlockCountChanged(int);
+        void onSdfIndexReady();
     private:
+        bool isInWindow( quint32 line ) const { return !d_lazy || ( line >= d_from && line <= d_to ); }
+        void updateOccurrences();
+        void showSdfDelays( const QByteArray& instName, const QByteArray& module );
         Utils::TreeViewComboBox* d_outline;
+        // Huge files: the semantic passes (errors, ifdefs, occurrences) only cover the lines d_from..d_to,
+        // i.e. the visible part plus a margin, which moves along while scrolling.
+        bool d_lazy;
+        int d_lazyLines; // threshold from the settings
+        quint32 d_from, d_to;
+        CrossRefModel::SymRefList d_uses; // all occurrences of the symbol under the cursor
+        QByteArray d_pendingSdf; // instance to show as soon as the SDF files are indexed
+        QByteArray d_pendingSdfModule; // the module containing it
     };
 
 }
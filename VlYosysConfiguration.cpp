@@ -132,7 +132,7 @@ void YosysBuildConfigWidget::environmentChanged()
 }
 
 YosysMakeStep::YosysMakeStep(ProjectExplorer::BuildStepList* parent):
-    AbstractProcessStep(parent, ID)
+    AbstractProcessStep(parent, ID),d_prune(false)
 {
     setDefaultDisplayName(tr("yosys") );
     d_args = "-p \"proc; opt; memory; opt; fsm; opt; techmap; opt; write_blif result.blif\"";
@@ -214,13 +214,17 @@ bool YosysMakeStep::init()
         cmdfile.write("\n");
     }
 
-    foreach( const QString& f, p->getLibFiles() )
+    QStringList libFiles = p->getLibFiles();
+    QStringList srcFiles = p->getSrcFiles();
+    if( d_prune )
+        p->getUsedFiles( srcFiles, libFiles );
+    foreach( const QString& f, libFiles )
     {
         cmdfile.write( "read_verilog " );
         cmdfile.write( _path( f.trimmed() ).toUtf8() );
         cmdfile.write( "\n" );
     }
-    foreach( const QString& f, p->getSrcFiles() )
+    foreach( const QString& f, srcFiles )
     {
         cmdfile.write( "read_verilog " );
         cmdfile.write( _path( f.trimmed() ).toUtf8() );
@@ -269,6 +273,7 @@ ProjectExplorer::BuildStepConfigWidget* YosysMakeStep::createConfigWidget()
 
 static const char* MAKE_ARGUMENTS_KEY = "VerilogCreator.Yosys.MakeStep.Args";
 static const char* MAKE_COMMAND_KEY = "VerilogCreator.Yosys.MakeStep.Cmd";
+static const char* MAKE_PRUNE_KEY = "VerilogCreator.Yosys.MakeStep.Prune";
 
 QVariantMap YosysMakeStep::toMap() const
 {
@@ -276,6 +281,7 @@ QVariantMap YosysMakeStep::toMap() const
 
     map.insert(QLatin1String(MAKE_ARGUMENTS_KEY), d_args);
     map.insert(QLatin1String(MAKE_COMMAND_KEY), d_cmd);
+    map.insert(QLatin1String(MAKE_PRUNE_KEY), d_prune);
     return map;
 }
 
@@ -283,6 +289,7 @@ bool YosysMakeStep::fromMap(const QVariantMap& map)
 {
     d_args = map.value(QLatin1String(MAKE_ARGUMENTS_KEY)).toString();
     d_cmd = map.value(QLatin1String(MAKE_COMMAND_KEY)).toString();
+    d_prune = map.value(QLatin1String(MAKE_PRUNE_KEY)).toBool();
 
     return BuildStep::fromMap(map);
 }
@@ -310,6 +317,11 @@ YosysMakeStepWidget::YosysMakeStepWidget(YosysMakeStep* makeStep):d_step(makeSte
     d_args->setText(makeStep->d_args);
     fl->addRow( tr("Additional arguments:"), d_args );
 
+    d_prune = new QCheckBox(this);
+    d_prune->setChecked(makeStep->d_prune);
+    d_prune->setToolTip(tr("Leave out the files of modules not instantiated below TOPMOD"));
+    fl->addRow( tr("Only files used by TOPMOD:"), d_prune );
+
     updateMakeOverrrideLabel();
     updateDetails();
 
@@ -317,6 +329,7 @@ YosysMakeStepWidget::YosysMakeStepWidget(YosysMakeStep* makeStep):d_step(makeSte
             this, &YosysMakeStepWidget::makeLineEditTextEdited);
     connect( d_args, &QLineEdit::textEdited,
             this, &YosysMakeStepWidget::makeArgumentsLineEditTextEdited);
+    connect( d_prune, SIGNAL(toggled(bool)), this, SLOT(pruneToggled(bool)) );
 
     connect(ProjectExplorer::ProjectExplorerPlugin::instance(), SIGNAL(settingsChanged()),
             this, SLOT(updateMakeOverrrideLabel()));
@@ -356,6 +369,12 @@ void YosysMakeStepWidget::makeArgumentsLineEditTextEdited()
     updateDetails();
 }
 
+void YosysMakeStepWidget::pruneToggled(bool on)
+{
+    d_step->d_prune = on;
+    updateDetails();
+}
+
 void YosysMakeStepWidget::updateMakeOverrrideLabel()
 {
     ProjectExplorer::BuildConfiguration *bc = d_step->buildConfiguration();
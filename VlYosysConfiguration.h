@@ -86,6 +86,7 @@ namespace Vl
     private:
         QString d_cmd;
         QString d_args;
+        bool d_prune; // only read the files used by TOPMOD
         friend class YosysMakeStepWidget;
     };
 
@@ -101,6 +102,7 @@ namespace Vl
     private slots:
         void makeLineEditTextEdited();
         void makeArgumentsLineEditTextEdited();
+        void pruneToggled(bool);
         void updateMakeOverrrideLabel();
         void updateDetails();
 
@@ -110,6 +112,7 @@ namespace Vl
         QLabel* d_cmdLabel;
         QLineEdit* d_cmd;
         QLineEdit* d_args;
+        QCheckBox* d_prune;
     };
 
     class YosysCleanStep : public ProjectExplorer::AbstractProcessStep
@@ -0,0 +1,223 @@
+/*
+* Copyright 2019 Rochus Keller <mailto:me@rochus-keller.ch>
+*
+* This file is part of the VerilogCreator plugin.
+*
+* The following is the license that applies to this copy of the
+* plugin. For a license to use the plugin under conditions
+* other than those described here, please email to me@rochus-keller.ch.
+*
+* GNU General Public License Usage
+* This file may be used under the terms of the GNU General Public
+* License (GPL) versions 2.0 or 3.0 as published by the Free Software
+* Foundation and appearing in the file LICENSE.GPL included in
+* the packaging of this file. Please review the following information
+* to ensure GNU General Public Licensing requirements will be met:
+* http://www.fsf.org/licensing/licenses/info/GPLv2.html and
+* http://www.gnu.org/copyleft/gpl.html.
+*/
+
+
+// Standalone timings of the hot paths of the plugin which can run without Qt Creator.
+// Build with qmake in this directory (the Verilog library is expected next to the plugin sources, as for
+// the plugin itself) and run e.g. "VlBench codeindex 50000", "VlBench lexer 50000" or "VlBench tcl 1000000".
+// The tcl mode needs the Tcl library at runtime, like the plugin.
+
+#include "../VlCodeIndex.h"
+#include "../VlTclEngine.h"
+#include <Verilog/VlCrossRefModel.h>
+#include <Verilog/VlFileCache.h>
+#include <Verilog/VlPpLexer.h>
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QFile>
+#include <QTemporaryDir>
+#include <QTextStream>
+#include <stdio.h>
+using namespace Vl;
+
+static QTextStream& out()
+{
+    static QTextStream s(stdout);
+    return s;
+}
+
+// modules of 100 lines each, mostly continuous assignments referencing the previous wire
+static QString writeVerilog( const QString& dir, int lines )
+{
+    const QString path = dir + "/bench.v";
+    QFile f(path);
+    if( !f.open(QIODevice::WriteOnly) )
+        return QString();
+    QTextStream s(&f);
+    int line = 0;
+    for( int m = 0; line < lines; m++ )
+    {
+        s << "module m" << m << "(input clk, input [7:0] a" << m << ", output [7:0] y" << m << ");\n";
+        s << "    wire [7:0] w0 = a" << m << ";\n";
+        line += 2;
+        int w = 1;
+        for( ; w < 96 && line < lines - 2; w++, line++ )
+            s << "    wire [7:0] w" << w << " = a" << m << " + w" << ( w - 1 ) << ";\n";
+        s << "    assign y" << m << " = w" << ( w - 1 ) << ";\n";
+        s << "endmodule\n";
+        line += 2;
+    }
+    return path;
+}
+
+static int benchCodeIndex( int lines )
+{
+    QTemporaryDir dir;
+    const QString path = writeVerilog( dir.path(), lines );
+    if( path.isEmpty() )
+        return -1;
+
+    FileCache fcache(0);
+    CrossRefModel mdl( 0, &fcache );
+    QEventLoop loop;
+    QObject::connect( &mdl, SIGNAL(sigModelUpdated()), &loop, SLOT(quit()) );
+    QElapsedTimer t;
+    t.start();
+    mdl.updateFiles( QStringList() << path );
+    loop.exec();
+    out() << "parsed " << lines << " lines in " << t.elapsed() << " ms" << endl;
+
+    CodeIndex index( &mdl );
+    t.restart();
+    index.findSymbolBySourcePos( path, 1, 1 );
+    out() << "cold index build " << t.nsecsElapsed() / 1000 << " us" << endl;
+
+    // the same pseudo random positions for both; many miss an identifier, like a real cursor does
+    const int count = 10000;
+    QVector<QPair<quint32,quint16> > pos( count );
+    quint32 seed = 42;
+    for( int i = 0; i < count; i++ )
+    {
+        seed = seed * 1103515245 + 12345;
+        pos[i] = qMakePair( quint32( seed % lines ) + 1, quint16( ( seed >> 16 ) % 40 ) + 1 );
+    }
+
+    int mismatches = 0;
+    for( int i = 0; i < count; i++ )
+    {
+        const CrossRefModel::TreePath a = index.findSymbolBySourcePos( path, pos[i].first, pos[i].second );
+        const CrossRefModel::TreePath b = mdl.findSymbolBySourcePos( path, pos[i].first, pos[i].second );
+        if( a.isEmpty() != b.isEmpty() || ( !a.isEmpty() && a.first().data() != b.first().data() ) )
+            mismatches++;
+    }
+    // the variants used by goto outer block and completion; the areas are defined by the index, so
+    // differences to the tree walk are listed but don't fail the run
+    int tokenDiffs = 0;
+    int areaDiffs = 0;
+    for( int i = 0; i < count; i++ )
+    {
+        CrossRefModel::TreePath a = index.findSymbolBySourcePos( path, pos[i].first, pos[i].second, false );
+        CrossRefModel::TreePath b = mdl.findSymbolBySourcePos( path, pos[i].first, pos[i].second, false );
+        if( a.isEmpty() != b.isEmpty() || ( !a.isEmpty() && a.first().data() != b.first().data() ) )
+            tokenDiffs++;
+        a = index.findSymbolBySourcePos( path, pos[i].first, pos[i].second, false, true );
+        b = mdl.findSymbolBySourcePos( path, pos[i].first, pos[i].second, false, true );
+        if( CrossRefModel::closestScope(a) != CrossRefModel::closestScope(b) )
+            areaDiffs++;
+    }
+    out() << "onlyIdents=false: " << tokenDiffs << " differences, hitEmpty: " << areaDiffs
+          << " differences in the closest scope" << endl;
+
+    t.restart();
+    for( int i = 0; i < count; i++ )
+        index.findSymbolBySourcePos( path, pos[i].first, pos[i].second );
+    const qint64 indexed = t.nsecsElapsed();
+    t.restart();
+    for( int i = 0; i < count; i++ )
+        mdl.findSymbolBySourcePos( path, pos[i].first, pos[i].second );
+    const qint64 walked = t.nsecsElapsed();
+
+    out() << "findSymbolBySourcePos, " << count << " positions: index " << indexed / count / 1000.0
+          << " us, tree walk " << walked / count / 1000.0 << " us per lookup, "
+          << mismatches << " mismatches" << endl;
+    return mismatches == 0 ? 0 : 1;
+}
+
+// the per block work of VerilogHighlighter::highlightBlock without the Qt Creator text layout part:
+// a lexer configured like the highlighter's, fresh for every line
+static int benchLexer( int lines )
+{
+    QTemporaryDir dir;
+    const QString path = writeVerilog( dir.path(), lines );
+    QFile f(path);
+    if( path.isEmpty() || !f.open(QIODevice::ReadOnly) )
+        return -1;
+    const QStringList text = QString::fromLatin1( f.readAll() ).split( QChar('\n') );
+
+    QElapsedTimer t;
+    t.start();
+    qint64 tokens = 0;
+    foreach( const QString& line, text )
+    {
+        PpLexer lex;
+        lex.setIgnoreAttrs(false);
+        lex.setPackAttrs(false);
+        lex.setIgnoreComments(false);
+        lex.setPackComments(false);
+        lex.setSendMacroUsage(true);
+        tokens += lex.tokens( line ).size();
+    }
+    const qint64 ns = qMax( t.nsecsElapsed(), qint64(1) );
+    out() << "lexed " << text.size() << " lines, " << tokens << " tokens in " << ns / 1000000 << " ms, "
+          << qint64( text.size() * 1e9 / ns ) << " lines/s" << endl;
+    return 0;
+}
+
+static void countLines( const QByteArray& msg, bool, void* data )
+{
+    *static_cast<qint64*>(data) += msg.count('\n');
+}
+
+// the output path of TclStep up to the callback: puts, the engine's buffering and the chunks forwarded
+static int benchTcl( int lines )
+{
+    if( !TclEngine::isAvailable() )
+    {
+        out() << "the Tcl library is not available" << endl;
+        return -1;
+    }
+    QTemporaryDir dir;
+    const QString path = dir.path() + "/bench.tcl";
+    QFile f(path);
+    if( !f.open(QIODevice::WriteOnly) )
+        return -1;
+    f.write( QString("for {set i 0} {$i < %1} {incr i} { puts \"line $i of the benchmark output\" }\n")
+             .arg( lines ).toUtf8() );
+    f.close();
+
+    TclEngine tcl;
+    if( !tcl.isReady() )
+        return -1;
+    qint64 count = 0;
+    tcl.setWriteLog( countLines, &count );
+    QElapsedTimer t;
+    t.start();
+    const bool ok = tcl.runFile( path );
+    const qint64 ns = qMax( t.nsecsElapsed(), qint64(1) );
+    out() << "tcl printed " << count << " lines in " << ns / 1000000 << " ms, "
+          << qint64( count * 1e9 / ns ) << " lines/s" << endl;
+    return ok && count == lines ? 0 : 1;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    const QStringList args = app.arguments();
+    const QString what = args.value(1);
+    const int lines = qMax( args.value(2).toInt(), 0 );
+    if( what == "codeindex" )
+        return benchCodeIndex( lines ? lines : 50000 );
+    if( what == "lexer" )
+        return benchLexer( lines ? lines : 50000 );
+    if( what == "tcl" )
+        return benchTcl( lines ? lines : 1000000 );
+    out() << "usage: VlBench codeindex|lexer|tcl [lines]" << endl;
+    return -1;
+}
@@ -0,0 +1,43 @@
+#/*
+#* Copyright 2018 Rochus Keller <mailto:me@rochus-keller.ch>
+#*
+#* This file is part of the VerilogCreator plugin.
+#*
+#* The following is the license that applies to this copy of the
+#* plugin. For a license to use the plugin under conditions
+#* other than those described here, please email to me@rochus-keller.ch.
+#*
+#* GNU General Public License Usage
+#* This file may be used under the terms of the GNU General Public
+#* License (GPL) versions 2.0 or 3.0 as published by the Free Software
+#* Foundation and appearing in the file LICENSE.GPL included in
+#* the packaging of this file. Please review the following information
+#* to ensure GNU General Public Licensing requirements will be met:
+#* http://www.fsf.org/licensing/licenses/info/GPLv2.html and
+#* http://www.gnu.org/copyleft/gpl.html.
+#*/
+
+# Standalone benchmark of plugin code which does not depend on Qt Creator; not part of the plugin build
+
+QT += core
+QT -= gui
+
+TARGET = VlBench
+TEMPLATE = app
+CONFIG += console c++11
+CONFIG -= app_bundle
+
+!win32 { QMAKE_CXXFLAGS += -Wno-reorder -Wno-unused-parameter -Wno-unused-function -Wno-unused-variable }
+
+INCLUDEPATH += ../..
+
+SOURCES += \
+    VlBench.cpp \
+    ../VlCodeIndex.cpp \
+    ../VlTclEngine.cpp
+
+HEADERS += \
+    ../VlCodeIndex.h \
+    ../VlTclEngine.h
+
+include (../../Verilog/Verilog.pri )